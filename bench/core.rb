@@ -0,0 +1,140 @@
+# Speed of the core operations on the games of test/pgn_collection. Each
+# benchmark is repeated for at least 0.2 seconds per run, and the runs are
+# interleaved: every round runs each benchmark once, so a machine that slows
+# down during the run slows all of them. The median of the runs is kept with
+# its spread, the median absolute deviation relative to the median.
+#
+# The results are written as JSON and compared against a baseline: the run
+# fails if an operation is slower than the baseline by more than the
+# threshold, or by more than NOISE times the spreads of the two measures if
+# that is larger.
+#
+#   ruby -Iext -Ilib bench/core.rb [options]
+#
+# Use `rake bench`, `rake bench:compare` and `rake bench:baseline` to run it.
+
+require 'json'
+require 'optparse'
+require 'chess'
+
+$stdout.sync = true
+
+NOISE = 3
+
+options = {
+  baseline: File.join(__dir__, 'baseline.json'),
+  output: File.join(__dir__, 'results.json'),
+  threshold: 0.3,
+  runs: 7,
+  save: false
+}
+OptionParser.new do |opts|
+  opts.on('--baseline FILE', 'Baseline to compare with') { |file| options[:baseline] = file }
+  opts.on('--output FILE', 'Where to write the results') { |file| options[:output] = file }
+  opts.on('--threshold RATIO', Float, 'Allowed slowdown, 0.3 by default') { |ratio| options[:threshold] = ratio }
+  opts.on('--runs N', Integer, 'Runs of each benchmark, the median is kept') { |n| options[:runs] = n }
+  opts.on('--save-baseline', 'Write the results as the new baseline') { options[:save] = true }
+end.parse!
+
+collection = File.expand_path('../test/pgn_collection', __dir__)
+files = Dir[File.join(collection, 'valid', '*.pgn')].sort.first(100)
+pgns = files.map { |file| Chess::Pgn.new(file) }
+games = pgns.map { |pgn| Chess::Game.new(pgn.moves) }
+coord_moves = games.map(&:coord_moves)
+square_moves = coord_moves.map do |moves|
+  moves.map do |move|
+    from, to = [move[0, 2], move[2, 2]].map { |coord| ((coord[1].ord - '1'.ord) * 8) + coord[0].ord - 'a'.ord }
+    [from, to, move[4]&.upcase]
+  end
+end
+boards = []
+games.each { |game| game.each { |board| boards << board } }
+fens = boards.map(&:to_fen)
+threefold_games = Dir[File.join(collection, 'threefold_repetition', '*.pgn')].sort.map { |file| Chess::Game.load_pgn(file) }
+
+# name => [operations per run, block]
+benchmarks = {
+  'move_san' => [pgns.sum { |pgn| pgn.moves.size }, -> { pgns.each { |pgn| Chess::Game.new(pgn.moves) } }],
+  'move_coord' => [coord_moves.sum(&:size), -> { coord_moves.each { |moves| Chess::Game.new(moves) } }],
+  'move3' => [
+    square_moves.sum(&:size),
+    lambda do
+      square_moves.each do |moves|
+        game = Chess::Game.new
+        moves.each { |from, to, promotion| game.move3(from, to, promotion) }
+      end
+    end
+  ],
+  'generate_all_moves' => [boards.size, -> { boards.each(&:generate_all_moves) }],
+  'legal_moves' => [boards.size, -> { boards.each(&:legal_moves) }],
+  'legal_move_count' => [boards.size, -> { boards.each(&:legal_move_count) }],
+  'to_fen' => [boards.size, -> { boards.each(&:to_fen) }],
+  'set_fen!' => [
+    fens.size,
+    lambda do
+      game = Chess::Game.new
+      fens.each { |fen| game.set_fen!(fen) }
+    end
+  ],
+  'threefold_repetition?' => [threefold_games.size, -> { threefold_games.each(&:threefold_repetition?) }],
+  'load_pgn' => [files.size, -> { files.each { |file| Chess::Game.load_pgn(file) } }],
+  'perft' => [
+    Chess::Game.new.board.perft(4) + games[0].board.perft(3),
+    lambda do
+      Chess::Game.new.board.perft(4)
+      games[0].board.perft(3)
+    end
+  ]
+}
+
+# Seconds of a call of the block, repeated for at least min_time seconds.
+def measure(block, min_time)
+  GC.start
+  start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+  calls = 0
+  loop do
+    block.call
+    calls += 1
+    elapsed = Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+    return elapsed / calls if elapsed >= min_time
+  end
+end
+
+def median(values)
+  sorted = values.sort
+  (sorted[(sorted.size - 1) / 2] + sorted[sorted.size / 2]) / 2.0
+end
+
+benchmarks.each_value { |(_, block)| block.call } # warm up
+samples = benchmarks.transform_values { [] }
+options[:runs].times do
+  benchmarks.each { |name, (_, block)| samples[name] << measure(block, 0.2) }
+end
+results = benchmarks.to_h do |name, (operations, _)|
+  seconds = median(samples[name])
+  spread = median(samples[name].map { |s| (s - seconds).abs }) / seconds
+  [name, { 'operations' => operations, 'seconds' => seconds.round(6),
+           'operations_per_second' => (operations / seconds).round(1), 'spread' => spread.round(4) }]
+end
+
+report = { 'ruby' => RUBY_DESCRIPTION, 'threshold' => options[:threshold], 'results' => results }
+File.write(options[:output], "#{JSON.pretty_generate(report)}\n")
+baseline = !options[:save] && File.exist?(options[:baseline]) ? JSON.parse(File.read(options[:baseline]))['results'] : {}
+
+puts format('%-24s %14s %7s %14s %9s %7s', 'benchmark', 'ops/s', 'spread', 'baseline', 'change', 'limit')
+regressions = results.select do |name, result|
+  base = baseline.dig(name, 'operations_per_second')
+  change = base ? (result['operations_per_second'] / base) - 1 : nil
+  limit = [options[:threshold], NOISE * (result['spread'] + baseline.dig(name, 'spread').to_f)].max
+  puts format('%-24s %14.1f %6.1f%% %14s %9s %7s', name, result['operations_per_second'], result['spread'] * 100,
+              base ? format('%.1f', base) : '-', change ? format('%+.1f%%', change * 100) : '-',
+              base ? format('%.0f%%', limit * 100) : '-')
+  change && change < -limit
+end
+
+if options[:save]
+  File.write(options[:baseline], "#{JSON.pretty_generate(report)}\n")
+  puts "Baseline written to #{options[:baseline]}"
+elsif regressions.any?
+  abort "Slower than the baseline beyond the threshold and the noise: #{regressions.keys.join(', ')}"
+end
@@ -0,0 +1,31 @@
+# Time to depth of Board#best_move with 1 to N threads (Lazy SMP).
+#
+#   ruby -Iext -Ilib bench/search_threads.rb [depth] [max_threads]
+
+require 'etc'
+require 'chess'
+
+depth = Integer(ARGV[0] || 7)
+max_threads = Integer(ARGV[1] || Etc.nprocessors)
+positions = [
+  [],
+  %w[e4 e5 Nf3 Nc6 Bb5 a6 Ba4 Nf6 O-O Be7],
+  %w[d4 Nf6 c4 e6 Nc3 Bb4 e3 O-O Bd3 d5],
+  %w[e4 c5 Nf3 d6 d4 cxd4 Nxd4 Nf6 Nc3 a6]
+].map { |moves| Chess::Game.new(moves).board }
+
+puts format('%-8s %10s %8s', 'threads', 'time (s)', 'speedup')
+base = nil
+threads = 1
+while threads <= max_threads
+  Chess::Engine.threads = threads
+  elapsed = positions.sum do |board|
+    Chess::Engine.clear
+    start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    board.best_move(depth: depth)
+    Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+  end
+  base ||= elapsed
+  puts format('%-8d %10.3f %7.2fx', threads, elapsed, base / elapsed)
+  threads = threads == max_threads || threads * 2 <= max_threads ? threads * 2 : max_threads
+end
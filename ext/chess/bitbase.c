@@ -0,0 +1,219 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+// Bitbases of the endings king and queen, king and rook and king and pawn
+// against king. The strong side can only win or draw, so one bit per position
+// is enough: set if the strong side wins. Positions are seen from the strong
+// side as white and are indexed by the side to move, the white king, the black
+// king and the piece. The bitbases are generated on the first probe by
+// retrograde analysis, the positions that are not won are draws.
+
+// pthread_once is POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
+#include "bitbase.h"
+
+#define KQK 0
+#define KRK 1
+#define KPK 2
+#define BITBASES 3
+
+#define BITBASE_SIZE (2 * 64 * 64 * 64)
+#define INDEX(color, wk, bk, piece) ((((color) * 64 + (wk)) * 64 + (bk)) * 64 + (piece))
+
+static uint8_t bitbases[BITBASES][BITBASE_SIZE / 8];
+static pthread_once_t generated = PTHREAD_ONCE_INIT;
+static bool available;
+
+// Queen and rook attacks from a square with a single blocker. The attacks with
+// more blockers are the intersection of the attacks with each of them.
+static bboard queen_attacks[64][64];
+static bboard rook_attacks[64][64];
+
+static bool
+won (int bitbase, int index)
+{
+  return (bitbases[bitbase][index >> 3] >> (index & 7)) & 1;
+}
+
+// Squares attacked by the white piece on square p with the pieces on squares a
+// and b as blockers.
+static bboard
+piece_attacks (int bitbase, int p, int a, int b)
+{
+  switch (bitbase)
+    {
+    case KQK: return queen_attacks[p][a] & queen_attacks[p][b];
+    case KRK: return rook_attacks[p][a] & rook_attacks[p][b];
+    default: return xray_attack_white_pawn (p);
+    }
+}
+
+static bool
+legal_position (int bitbase, int color, int wk, int bk, int p)
+{
+  if (wk == bk || wk == p || bk == p || (xray_king (wk) & (1ULL << bk)))
+    return FALSE;
+  if (bitbase == KPK && (p < A2 || p > H7))
+    return FALSE;
+  // With white to move black can not be in check
+  return color == BLACK || !(piece_attacks (bitbase, p, wk, bk) & (1ULL << bk));
+}
+
+static void
+set_won (int bitbase, int index)
+{
+  bitbases[bitbase][index >> 3] |= 1 << (index & 7);
+}
+
+// Squares to which the black king can move.
+static bboard
+black_king_moves (int bitbase, int wk, int bk, int p)
+{
+  // Black king removed from the blockers, it can not escape along a line
+  return xray_king (bk) & ~xray_king (wk) & ~piece_attacks (bitbase, p, wk, wk);
+}
+
+// Generates the bitbase from the mates (and for the king and pawn bitbase from
+// the won promotions) going backwards: the white positions that can move to a
+// won position are won, the black positions are won when all their moves lead
+// to won positions. count holds the moves of each black position not yet known
+// to lose. Returns false if the memory can not be allocated.
+static bool
+generate_bitbase (int bitbase)
+{
+  unsigned char *count = (unsigned char *) malloc (BITBASE_SIZE / 2);
+  int *queue = (int *) malloc (BITBASE_SIZE * sizeof (int));
+  if (!count || !queue)
+    {
+      free (count);
+      free (queue);
+      return FALSE;
+    }
+  int head = 0, tail = 0;
+  for (int wk = 0; wk < 64; wk++)
+    for (int bk = 0; bk < 64; bk++)
+      for (int p = 0; p < 64; p++)
+        {
+          if (legal_position (bitbase, BLACK, wk, bk, p))
+            {
+              int index = INDEX (BLACK, wk, bk, p);
+              bboard moves = black_king_moves (bitbase, wk, bk, p);
+              count[index - BITBASE_SIZE / 2] = __builtin_popcountll (moves);
+              // Checkmate
+              if (!moves && ((xray_king (wk) | piece_attacks (bitbase, p, wk, wk)) & (1ULL << bk)))
+                {
+                  set_won (bitbase, index);
+                  queue[tail++] = index;
+                }
+            }
+          // Promotion in queen or, to avoid a stalemate, in rook
+          if (bitbase == KPK && p >= A7 && p <= H7 && p + 8 != wk && p + 8 != bk
+              && legal_position (KPK, WHITE, wk, bk, p)
+              && (won (KQK, INDEX (BLACK, wk, bk, p + 8)) || won (KRK, INDEX (BLACK, wk, bk, p + 8))))
+            {
+              set_won (bitbase, INDEX (WHITE, wk, bk, p));
+              queue[tail++] = INDEX (WHITE, wk, bk, p);
+            }
+        }
+  while (head < tail)
+    {
+      int index = queue[head++];
+      int wk = (index >> 12) & 63;
+      int bk = (index >> 6) & 63;
+      int p = index & 63;
+      bboard occupied = (1ULL << wk) | (1ULL << bk) | (1ULL << p);
+      if ((index >> 18) == WHITE)
+        {
+          // Black moves that lead here
+          for (bboard from = xray_king (bk) & ~occupied & ~xray_king (wk); from; from &= from - 1)
+            {
+              int previous = INDEX (BLACK, wk, __builtin_ctzll (from), p);
+              if (!won (bitbase, previous) && --count[previous - BITBASE_SIZE / 2] == 0)
+                {
+                  set_won (bitbase, previous);
+                  queue[tail++] = previous;
+                }
+            }
+          continue;
+        }
+      // White moves that lead here
+      int previous[64];
+      int n = 0;
+      for (bboard from = xray_king (wk) & ~occupied; from; from &= from - 1)
+        previous[n++] = INDEX (WHITE, __builtin_ctzll (from), bk, p);
+      if (bitbase != KPK)
+        for (bboard from = piece_attacks (bitbase, p, wk, bk) & ~occupied; from; from &= from - 1)
+          previous[n++] = INDEX (WHITE, wk, bk, __builtin_ctzll (from));
+      else if (p >= A3 && !(occupied & (1ULL << (p - 8))))
+        {
+          previous[n++] = INDEX (WHITE, wk, bk, p - 8);
+          if (p >= A4 && p <= H4 && !(occupied & (1ULL << (p - 16))))
+            previous[n++] = INDEX (WHITE, wk, bk, p - 16);
+        }
+      for (int i = 0; i < n; i++)
+        if (!won (bitbase, previous[i])
+            && legal_position (bitbase, WHITE, (previous[i] >> 12) & 63, (previous[i] >> 6) & 63, previous[i] & 63))
+          {
+            set_won (bitbase, previous[i]);
+            queue[tail++] = previous[i];
+          }
+    }
+  free (count);
+  free (queue);
+  return TRUE;
+}
+
+// The king and pawn bitbase looks up the others for the promotions.
+static void
+generate_bitbases (void)
+{
+  for (int i = 0; i < 64; i++)
+    for (int j = 0; j < 64; j++)
+      {
+        queen_attacks[i][j] = xray_queen (1ULL << j, i);
+        rook_attacks[i][j] = xray_rook (1ULL << j, i);
+      }
+  available = generate_bitbase (KQK) && generate_bitbase (KRK) && generate_bitbase (KPK);
+}
+
+// Returns the result of the position with best play (WHITE_WON, BLACK_WON or
+// DRAW) if there are only the kings and a queen, a rook or a pawn, IN_PROGRESS
+// otherwise, for illegal positions or if the bitbases can not be generated.
+// The fifty-move rule is not taken into account. The bitbases are generated by
+// the first call, it is safe to call this function from many threads.
+int
+probe_bitbase (Board *board)
+{
+  if (__builtin_popcountll (board->occupied) != 3 || board->castling)
+    return IN_PROGRESS;
+  int strong = (board->pieces[WHITE] & (board->pieces[WHITE] - 1)) ? WHITE : BLACK;
+  int bitbase;
+  bboard piece;
+  if (board->queens[strong])
+    bitbase = KQK, piece = board->queens[strong];
+  else if (board->rooks[strong])
+    bitbase = KRK, piece = board->rooks[strong];
+  else if (board->pawns[strong])
+    bitbase = KPK, piece = board->pawns[strong];
+  else
+    return IN_PROGRESS;
+  pthread_once (&generated, generate_bitbases);
+  if (!available)
+    return IN_PROGRESS;
+  // Black is the strong side: flip the board
+  int flip = strong == WHITE ? 0 : 56;
+  int color = board->active_color == strong ? WHITE : BLACK;
+  int wk = __builtin_ctzll (board->king[strong]) ^ flip;
+  int bk = __builtin_ctzll (board->king[!strong]) ^ flip;
+  int p = __builtin_ctzll (piece) ^ flip;
+  if (!legal_position (bitbase, color, wk, bk, p))
+    return IN_PROGRESS;
+  return won (bitbase, INDEX (color, wk, bk, p)) ? (strong == WHITE ? WHITE_WON : BLACK_WON) : DRAW;
+}
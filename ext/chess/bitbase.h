@@ -0,0 +1,16 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+#ifndef BITBASE_H
+#define BITBASE_H
+
+#include "common.h"
+#include "board.h"
+
+int probe_bitbase (Board *board);
+
+#endif
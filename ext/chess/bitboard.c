@@ -7,11 +7,9 @@
 
 #include "bitboard.h"
 
-// Pre-calculate variables
-bboard ALL_XRAY_ATTACK_WHITE_PAWN[64];
-bboard ALL_XRAY_ATTACK_BLACK_PAWN[64];
-bboard ALL_XRAY_KNIGHT[64];
-bboard ALL_XRAY_KING[64];
+// The attack tables, generated at build time by gen_tables.c. They are const,
+// so they can be shared between threads, Ractors and forked processes.
+#include "tables.h"
 
 /*
   Shift by direction
@@ -81,17 +79,11 @@ square (int file, int rank)
   return 8 * rank + file;
 }
 
-// Given a bitboard returns the first square (0..63) with a piece.
+// Given a bitboard returns the last square (0..63) with a piece.
 int
 square2 (bboard b)
 {
-  int pos = -1;
-  while (b)
-    {
-      b >>= 1;
-      pos++;
-    }
-  return pos;
+  return b ? 63 - __builtin_clzll (b) : -1;
 }
 
 // Returns the array and its size (n) with pieces in the bitboard.
@@ -99,12 +91,12 @@ void
 squares (bboard b, int *array, int *n)
 {
   *n = 0;
-  for (int i = 0; i < 64; i++)
-    if (b & 1ULL << i)
-      {
-        array[*n] = i;
-        (*n)++;
-      }
+  while (b)
+    {
+      array[*n] = __builtin_ctzll (b);
+      (*n)++;
+      b &= b - 1;
+    }
 }
 
 // Given a square returns the corresponding file.
@@ -244,67 +236,24 @@ sliding_attacks (bboard slider, bboard propagator, int dir)
   return shift_one (fill, dir);
 }
 
-// Pre-calculators
-
-void
-precalculate_xray_attack_white_pawn (bboard xray[64])
-{
-  for (int i = 0; i < 64; i++)
-    {
-      xray[i] = EMPTY_BOARD;
-      xray[i] = shift_one (1ULL << i, 7) | shift_one (1ULL << i, 1);
-    }
-}
-
-void
-precalculate_xray_attack_black_pawn (bboard xray[64])
-{
-  for (int i = 0; i < 64; i++)
-    {
-      xray[i] = EMPTY_BOARD;
-      xray[i] = shift_one (1ULL << i, 5) | shift_one (1ULL << i, 3);
-    }
-}
-
-void
-precalculate_xray_knight (bboard xray[64])
-{
-  for (int i = 0; i < 64; i++)
-    {
-      xray[i] = 1ULL << i;
-      xray[i] = ((xray[i] << 17) & NOT_FILE_A)
-        | ((xray[i] << 10) & NOT_FILE_AB)
-        | ((xray[i] >>  6) & NOT_FILE_AB)
-        | ((xray[i] >> 15) & NOT_FILE_A)
-        | ((xray[i] << 15) & NOT_FILE_H)
-        | ((xray[i] <<  6) & NOT_FILE_GH)
-        | ((xray[i] >> 10) & NOT_FILE_GH)
-        | ((xray[i] >> 17) & NOT_FILE_H);
-    }
-}
+// XRay generators
 
-void
-precalculate_xray_king (bboard xray[64])
+// Returns the squares of the ray from a square in a direction up to the first
+// occupied square, included. The directions 0, 1, 2 and 7 go to higher
+// squares, so their first occupied square is the lowest one.
+static inline bboard
+ray_attacks (bboard occupied_square, int square, int dir)
 {
-  for (int i = 0; i < 64; i++)
+  bboard xray = RAYS[dir][square];
+  bboard collision = xray & occupied_square;
+  if (collision)
     {
-      xray[i] = EMPTY_BOARD;
-      for (int j = 0; j < 8; j++)
-        xray[i] = sliding_attacks (1ULL << i, EMPTY_BOARD, j) | xray[i];
+      int first = (dir < 3 || dir == 7) ? __builtin_ctzll (collision) : 63 - __builtin_clzll (collision);
+      xray ^= RAYS[dir][first];
     }
+  return xray;
 }
 
-void
-precalculate_all_xray ()
-{
-  precalculate_xray_attack_white_pawn (ALL_XRAY_ATTACK_WHITE_PAWN);
-  precalculate_xray_attack_black_pawn (ALL_XRAY_ATTACK_BLACK_PAWN);
-  precalculate_xray_knight (ALL_XRAY_KNIGHT);
-  precalculate_xray_king (ALL_XRAY_KING);
-}
-
-// XRay generators
-
 bboard
 xray_white_pawn (bboard occupied_square, int square)
 {
@@ -346,16 +295,10 @@ xray_attack_black_pawn (int square)
 bboard
 xray_rook (bboard occupied_square, int square)
 {
-  bboard xray[4];
-  bboard collision, shielded_square;
-  for (int i = 0, dir = 0; i < 4; i++, dir+=2)
-    {
-      xray[i] = sliding_attacks (1ULL << square, FULL_BOARD, dir);
-      collision = xray[i] & occupied_square;
-      shielded_square = sliding_attacks (collision, FULL_BOARD, dir);
-      xray[i] ^= shielded_square;
-    }
-  return xray[0] | xray[1] | xray[2] | xray[3];
+  return ray_attacks (occupied_square, square, 0)
+    | ray_attacks (occupied_square, square, 2)
+    | ray_attacks (occupied_square, square, 4)
+    | ray_attacks (occupied_square, square, 6);
 }
 
 bboard
@@ -367,16 +310,10 @@ xray_knight (int square)
 bboard
 xray_bishop (bboard occupied_square, int square)
 {
-  bboard xray[4];
-  bboard collision, shielded_square;
-  for (int i = 0, dir = 1; i < 4; i++, dir+=2)
-    {
-      xray[i] = sliding_attacks (1ULL << square, FULL_BOARD, dir);
-      collision = xray[i] & occupied_square;
-      shielded_square = sliding_attacks (collision, FULL_BOARD, dir);
-      xray[i] ^= shielded_square;
-    }
-  return xray[0] | xray[1] | xray[2] | xray[3];
+  return ray_attacks (occupied_square, square, 1)
+    | ray_attacks (occupied_square, square, 3)
+    | ray_attacks (occupied_square, square, 5)
+    | ray_attacks (occupied_square, square, 7);
 }
 
 bboard
@@ -44,12 +44,6 @@ bboard rotate_right (bboard b, int s);
 bboard occluded_fill (bboard gen, bboard pro, int dir);
 bboard shift_one (bboard b, int dir);
 bboard sliding_attacks (bboard slider, bboard propagator, int dir);
-// Pre-calculators
-void precalculate_xray_attack_white_pawn (bboard xray[64]);
-void precalculate_xray_attack_black_pawn (bboard xray[64]);
-void precalculate_xray_knight (bboard xray[64]);
-void precalculate_xray_king (bboard xray[64]);
-void precalculate_all_xray ();
 // XRay generators
 bboard xray_white_pawn (bboard occupied_square, int square);
 bboard xray_black_pawn (bboard occupied_square, int square);
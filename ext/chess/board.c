@@ -7,30 +7,34 @@
 
 #include "board.h"
 
+// The board of a new game. Never modified, so it can be shared between threads
+// and Ractors.
+const Board STARTING_BOARD =
+{
+  .placement = "RNBQKBNRPPPPPPPP\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0pppppppprnbqkbnr",
+  .active_color = WHITE,
+  .castling = 0x1111,
+  .en_passant = -1,
+  .halfmove_clock = 0,
+  .fullmove_number = 1,
+  .mg_score = 0,
+  .eg_score = 0,
+  .phase = MAX_PHASE,
+  .pawns   = { 0x000000000000ff00, 0x00ff000000000000 },
+  .rooks   = { 0x0000000000000081, 0x8100000000000000 },
+  .knights = { 0x0000000000000042, 0x4200000000000000 },
+  .bishops = { 0x0000000000000024, 0x2400000000000000 },
+  .queens  = { 0x0000000000000008, 0x0800000000000000 },
+  .king    = { 0x0000000000000010, 0x1000000000000000 },
+  .pieces  = { 0x000000000000ffff, 0xffff000000000000 },
+  .occupied = 0xffff00000000ffff
+};
+
 // Initialize the board
 void
 init_board (Board *board)
 {
-  memcpy (board->placement, "RNBQKBNRPPPPPPPP\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0pppppppprnbqkbnr", 64);
-  board->active_color = WHITE;
-  board->castling = 0x1111;
-  board->en_passant = -1;
-  board->halfmove_clock = 0;
-  board->fullmove_number = 1;
-  // initialize bitboards
-  board->pawns[WHITE]   = 0x000000000000ff00;
-  board->pawns[BLACK]   = 0x00ff000000000000;
-  board->rooks[WHITE]   = 0x0000000000000081;
-  board->rooks[BLACK]   = 0x8100000000000000;
-  board->knights[WHITE] = 0x0000000000000042;
-  board->knights[BLACK] = 0x4200000000000000;
-  board->bishops[WHITE] = 0x0000000000000024;
-  board->bishops[BLACK] = 0x2400000000000000;
-  board->queens[WHITE]  = 0x0000000000000008;
-  board->queens[BLACK]  = 0x0800000000000000;
-  board->king[WHITE]    = 0x0000000000000010;
-  board->king[BLACK]    = 0x1000000000000000;
-  set_occupied (board);
+  COPY_BOARD (board, &STARTING_BOARD);
 }
 
 // Set helpers bitboards (white pieces, black pieces, occupied squares).
@@ -112,6 +116,27 @@ get_piece_bitboard (Board *board, char piece)
     }
 }
 
+// Given a piece returns its 4 bits code: 1..6 for 'P', 'N', 'B', 'R', 'Q', 'K'
+// with the bit 3 set if the piece is black. Returns 0 for an empty square.
+int
+piece_to_nibble (char piece)
+{
+  const char *p = piece ? strchr (PIECES, toupper (piece)) : NULL;
+  if (!p)
+    return 0;
+  return (p - PIECES + 1) | (islower (piece) ? 8 : 0);
+}
+
+// Given a 4 bits code returns the piece. Returns '\0' for an empty square.
+char
+nibble_to_piece (int nibble)
+{
+  int i = (nibble & 7) - 1;
+  if (i < 0 || i > 5)
+    return '\0';
+  return nibble & 8 ? tolower (PIECES[i]) : PIECES[i];
+}
+
 // Given a square (0..63) retuns the piece's bitboard in that square.
 bboard*
 get_bitboard (Board *board, int square)
@@ -153,6 +178,7 @@ xray (Board *board, int from, bool only_attack)
 bboard
 all_xray (Board *board, int color, bool only_attack)
 {
+  COUNT (STAT_ALL_XRAY, 1);
   bboard x = EMPTY_BOARD; // xray for all pieces
   for (int i = 0; i < 64; i++)
     {
@@ -176,10 +202,11 @@ all_xray_without_friends (Board *board, int color, bool only_attack)
 void
 remove_piece (Board *board, int square, Board *new_board)
 {
-  memcpy (new_board, board, sizeof (Board));
+  COPY_BOARD (new_board, board);
   if (board->placement[square])
     {
       *(get_bitboard (new_board, square)) = EMPTY_BOARD;
+      remove_piece_score (new_board, board->placement[square], square);
       new_board->placement[square] = 0;
       set_occupied (new_board);
     }
@@ -207,11 +234,24 @@ same_pieces_that_can_capture_a_square (Board *board, int color, int square, int
   return index;
 }
 
+// Returns true if square is attacked by color pieces. Instead of computing the
+// xray of all pieces, look from the square with each kind of piece.
+bool
+attacked (Board *board, int color, int square)
+{
+  bboard pawn_attack = color == WHITE ? xray_attack_black_pawn (square) : xray_attack_white_pawn (square);
+  return (pawn_attack & board->pawns[color])
+    || (xray_knight (square) & board->knights[color])
+    || (xray_king (square) & board->king[color])
+    || (xray_bishop (board->occupied, square) & (board->bishops[color] | board->queens[color]))
+    || (xray_rook (board->occupied, square) & (board->rooks[color] | board->queens[color]));
+}
+
 // Returns true if square can be captured from color pieces.
 bool
 capture (Board *board, int color, int square)
 {
-  return all_xray_without_friends (board, color, FALSE) & (1ULL << square) ? TRUE : FALSE;
+  return !(board->pieces[color] & (1ULL << square)) && attacked (board, color, square);
 }
 
 // Returns true if there is a piece that can capture the square without put its
@@ -227,7 +267,8 @@ pieces_can_safe_capture (Board *board, int color, int square)
 bool
 king_in_check (Board *board, int color)
 {
-  return all_xray_without_friends (board, !color, TRUE) & board->king[color] ? TRUE : FALSE;
+  COUNT (STAT_KING_IN_CHECK, 1);
+  return board->king[color] && attacked (board, !color, square2 (board->king[color]));
 }
 
 // Returns true if the king color is in check. Assumes that the king is in
@@ -235,6 +276,7 @@ king_in_check (Board *board, int color)
 bool
 king_in_checkmate (Board *board, int color)
 {
+  COUNT (STAT_KING_IN_CHECKMATE, 1);
   int king_square = square2 (board->king[color]);
   bboard king = xray_king (king_square) & ~board->pieces[color];
   Board board_without_king;
@@ -284,6 +326,7 @@ king_in_checkmate (Board *board, int color)
 bool
 stalemate (Board *board, int color)
 {
+  COUNT (STAT_STALEMATE, 1);
   int s[64];
   int n;
   Board new_board;
@@ -437,23 +480,29 @@ get_coord (Board *board, char piece, const char *disambiguating, const char *to_
 bool
 try_move (Board *board, int from, int to, char promote_in, Board *new_board, char **move_done, char *capture)
 {
-  memcpy (new_board, board, sizeof (Board));
+  COUNT (STAT_TRY_MOVE, 1);
+  COPY_BOARD (new_board, board);
   *(get_bitboard (new_board, from)) ^= 1ULL << from;
   *(get_bitboard (new_board, from)) ^= 1ULL << to;
   if (capture)
     *capture = new_board->placement[to];
   int ep = have_en_passant (new_board, from, to);
   if (new_board->placement[to])
-    *(get_bitboard (new_board, to)) ^= 1ULL << to;
+    {
+      *(get_bitboard (new_board, to)) ^= 1ULL << to;
+      remove_piece_score (new_board, new_board->placement[to], to);
+    }
   // En passant check
   else if (ep)
     {
       if (capture)
         *capture = new_board->placement[ep];
       *(get_bitboard (new_board, ep)) ^= 1ULL << ep;
+      remove_piece_score (new_board, new_board->placement[ep], ep);
       new_board->placement[ep] = 0;
     }
   // Change placement
+  move_piece_score (new_board, new_board->placement[from], from, to);
   new_board->placement[to] = new_board->placement[from];
   new_board->placement[from] = 0;
   // Promotion check
@@ -478,6 +527,7 @@ try_move (Board *board, int from, int to, char promote_in, Board *new_board, cha
 char*
 get_notation (Board *board, int from, int to, int capture, int ep, char promotion, int check, int checkmate)
 {
+  COUNT (STAT_GET_NOTATION, 1);
   // Get short algebraic chess notation
   int i = 0;
   char *notation = (char *) malloc (9);
@@ -641,3 +691,224 @@ to_fen (Board *board)
 
   return fen;
 }
+
+// Given a promotion (1..4) returns the corresponding piece character. Returns
+// '\0' if there is no promotion.
+char
+promotion_to_char (int promotion)
+{
+  if (promotion < 1 || promotion > 4)
+    return '\0';
+  return "NBRQ"[promotion - 1];
+}
+
+// Given a piece character returns the corresponding promotion (1..4). Returns 0
+// if the piece is not a valid promotion.
+int
+char_to_promotion (char piece)
+{
+  switch (toupper (piece))
+    {
+    case 'N': return 1;
+    case 'B': return 2;
+    case 'R': return 3;
+    case 'Q': return 4;
+    default:  return 0;
+    }
+}
+
+// Returns true if the move from-to can be performed and stores the resulting
+// position in new_board, updating castling rights, en passant square, active
+// color and clocks. If move_done is not NULL returns also the short algebraic
+// chess notation of the move (without check symbols). Assume that the move is
+// pseudo legal.
+bool
+make_move (Board *board, int from, int to, char promote_in, Board *new_board, char **move_done)
+{
+  if (promote_in && invalid_promotion (board, from, to))
+    return FALSE;
+  char capture = 0;
+  char *notation = castling (board, castling_type (board, from, to), new_board);
+  if (notation) // The move is a castling
+    {
+      if (move_done)
+        *move_done = notation;
+      else
+        free (notation);
+    }
+  else if (!try_move (board, from, to, promote_in, new_board, move_done, &capture))
+    return FALSE;
+  update_castling (new_board, from, to);
+  update_en_passant (new_board, from, to);
+  if (new_board->active_color)
+    new_board->fullmove_number++;
+  new_board->active_color = !new_board->active_color;
+  if (capture || toupper (board->placement[from]) == 'P')
+    new_board->halfmove_clock = 0;
+  else
+    new_board->halfmove_clock++;
+  return TRUE;
+}
+
+// Stores in moves all the legal moves of the active color packed with MOVE and
+// returns their number. Promotions are expanded in the four promotion pieces.
+int
+legal_moves (Board *board, int *moves)
+{
+  int color = board->active_color;
+  int n = 0;
+  int s[64];
+  int count;
+  Board new_board;
+  for (int from = 0; from < 64; from++)
+    if (get_color (board, from) == color)
+      {
+        char piece = toupper (board->placement[from]);
+        bboard x = xray (board, from, FALSE) & ~board->pieces[color];
+        if (piece == 'P' && board->en_passant >= 0 && have_en_passant (board, from, board->en_passant))
+          x |= 1ULL << board->en_passant;
+        squares (x, s, &count);
+        for (int i = 0; i < count; i++)
+          if (try_move (board, from, s[i], 'Q', &new_board, 0, 0))
+            {
+              if (piece == 'P' && (s[i] < A2 || s[i] > H7))
+                for (int p = 4; p > 0; p--)
+                  moves[n++] = MOVE (from, s[i], p);
+              else
+                moves[n++] = MOVE (from, s[i], 0);
+            }
+        if (piece == 'K')
+          {
+            if (castling_type (board, from, from + 2))
+              moves[n++] = MOVE (from, from + 2, 0);
+            if (castling_type (board, from, from - 2))
+              moves[n++] = MOVE (from, from - 2, 0);
+          }
+      }
+  return n;
+}
+
+// Returns the number of leaf nodes of the legal moves tree of the given depth
+// (performance test). The count can be stopped from another thread setting
+// stop, if not NULL: the result is then meaningless.
+unsigned long long
+perft (Board *board, int depth, const volatile int *stop)
+{
+  if (depth <= 0)
+    return 1;
+  if (stop && *stop)
+    return 0;
+  int moves[MAX_MOVES];
+  int n = legal_moves (board, moves);
+  if (depth == 1)
+    return n;
+  unsigned long long nodes = 0;
+  Board new_board;
+  for (int i = 0; i < n; i++)
+    if (make_move (board, MOVE_FROM (moves[i]), MOVE_TO (moves[i]), promotion_to_char (MOVE_PROMOTION (moves[i])), &new_board, NULL))
+      nodes += perft (&new_board, depth - 1, stop);
+  return nodes;
+}
+
+// Returns true if the position can occur in a game: one king for each color,
+// no pawns on the first and last ranks and the side that has just moved not in
+// check.
+bool
+valid_position (Board *board)
+{
+  return has_only_one_one (board->king[WHITE]) && has_only_one_one (board->king[BLACK])
+    && !require_a_promotion (board)
+    && !king_in_check (board, !board->active_color);
+}
+
+// Drops castling rights without king and rook on their squares and the en
+// passant square if no pawn can capture, like pack_position does.
+void
+normalize_board (Board *board)
+{
+  const char *p = board->placement;
+  if (p[E1] != 'K' || p[H1] != 'R') board->castling &= ~0x1000;
+  if (p[E1] != 'K' || p[A1] != 'R') board->castling &= ~0x0100;
+  if (p[E8] != 'k' || p[H8] != 'r') board->castling &= ~0x0010;
+  if (p[E8] != 'k' || p[A8] != 'r') board->castling &= ~0x0001;
+  if (!en_passant_capturable (board))
+    board->en_passant = -1;
+}
+
+// Stores in packed the canonical POSITION_SIZE bytes encoding of the position:
+// the occupancy bitboard (8 bytes, little endian), the piece nibbles of the
+// occupied squares in ascending order (16 bytes, two per byte starting from the
+// low nibble), a flags byte (bit 0 the active color, bits 1-4 the castling
+// rights KQkq) and the en passant square (0xff if none). Castling rights
+// without king and rook on their squares and en passant squares that no pawn
+// can capture are dropped, so equal positions have equal encodings. Returns
+// false if the position has more than 32 pieces.
+bool
+pack_position (Board *board, unsigned char *packed)
+{
+  bboard occupied = board->occupied;
+  if (__builtin_popcountll (occupied) > 32)
+    return FALSE;
+  memset (packed, 0, POSITION_SIZE);
+  for (int i = 0; i < 8; i++)
+    packed[i] = occupied >> (8 * i);
+  int s[64];
+  int count;
+  squares (occupied, s, &count);
+  for (int i = 0; i < count; i++)
+    packed[8 + i / 2] |= piece_to_nibble (board->placement[s[i]]) << (4 * (i % 2));
+  const char *p = board->placement;
+  int flags = board->active_color;
+  if ((board->castling & 0x1000) && p[E1] == 'K' && p[H1] == 'R') flags |= 0x02;
+  if ((board->castling & 0x0100) && p[E1] == 'K' && p[A1] == 'R') flags |= 0x04;
+  if ((board->castling & 0x0010) && p[E8] == 'k' && p[H8] == 'r') flags |= 0x08;
+  if ((board->castling & 0x0001) && p[E8] == 'k' && p[A8] == 'r') flags |= 0x10;
+  packed[24] = flags;
+  packed[25] = en_passant_capturable (board) ? board->en_passant : 0xff;
+  return TRUE;
+}
+
+// Builds in board the position encoded by pack_position. Clocks are reset.
+// Returns false if packed is not a valid canonical encoding or a king is
+// missing.
+bool
+unpack_position (const unsigned char *packed, Board *board)
+{
+  bboard occupied = 0;
+  for (int i = 0; i < 8; i++)
+    occupied |= (bboard) packed[i] << (8 * i);
+  int s[64];
+  int count;
+  squares (occupied, s, &count);
+  if (count > 32 || packed[24] & 0xe0)
+    return FALSE;
+  memset (board, 0, sizeof (Board));
+  for (int i = 0; i < 32; i++)
+    {
+      int nibble = (packed[8 + i / 2] >> (4 * (i % 2))) & 0xf;
+      if (i >= count)
+        {
+          if (nibble)
+            return FALSE;
+          continue;
+        }
+      char piece = nibble_to_piece (nibble);
+      if (!piece)
+        return FALSE;
+      board->placement[s[i]] = piece;
+      *(get_piece_bitboard (board, piece)) |= 1ULL << s[i];
+    }
+  set_occupied (board);
+  set_scores (board);
+  if (!has_only_one_one (board->king[WHITE]) || !has_only_one_one (board->king[BLACK]))
+    return FALSE;
+  board->active_color = packed[24] & 1;
+  board->castling = (packed[24] & 0x02 ? 0x1000 : 0) | (packed[24] & 0x04 ? 0x0100 : 0)
+    | (packed[24] & 0x08 ? 0x0010 : 0) | (packed[24] & 0x10 ? 0x0001 : 0);
+  board->en_passant = packed[25] == 0xff ? -1 : packed[25];
+  board->halfmove_clock = 0;
+  board->fullmove_number = 1;
+  // Reject non canonical encodings
+  unsigned char repacked[POSITION_SIZE];
+  return pack_position (board, repacked) && !memcmp (packed, repacked, POSITION_SIZE);
+}
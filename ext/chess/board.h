@@ -18,6 +18,10 @@ typedef struct Board
   short int en_passant;
   unsigned int halfmove_clock;
   unsigned int fullmove_number;
+  // Incremental evaluation (see eval.c) - white point of view
+  int mg_score;
+  int eg_score;
+  int phase;
   // Pieces bitboards - 0 means white 1 means black
   bboard pawns[2];
   bboard rooks[2];
@@ -30,22 +34,43 @@ typedef struct Board
   bboard occupied;
 } Board;
 
-#define NEW_BOARD (Board*) malloc (sizeof (Board))
+#define NEW_BOARD (Board*) STATS_MALLOC (sizeof (Board))
+
+// Moves are packed in 16 bits, like Polyglot does: bits 0-5 are the ending
+// square, bits 6-11 the starting square and bits 12-14 the promotion piece (1
+// knight, 2 bishop, 3 rook, 4 queen).
+#define MOVE(from, to, promotion) ((to) | ((from) << 6) | ((promotion) << 12))
+#define MOVE_FROM(m) (((m) >> 6) & 0x3f)
+#define MOVE_TO(m) ((m) & 0x3f)
+#define MOVE_PROMOTION(m) (((m) >> 12) & 0x7)
+#define MAX_MOVES 256
+
+// Size in bytes of the packed position encoding (see pack_position).
+#define POSITION_SIZE 26
+
+// Piece types in the order used for packed formats.
+#define PIECES "PNBRQK"
 
 #include "common.h"
 #include "special.h"
+#include "eval.h"
+
+extern const Board STARTING_BOARD;
 
 void init_board (Board *board);
 void set_occupied (Board *board);
 char* print_board (Board *board);
 int get_color (Board *board, int square);
 bboard* get_piece_bitboard (Board *board, char piece);
+int piece_to_nibble (char piece);
+char nibble_to_piece (int nibble);
 bboard* get_bitboard (Board *board, int square);
 bboard xray (Board *board, int from, bool only_attack);
 bboard all_xray (Board *board, int color, bool only_attack);
 bboard all_xray_without_friends (Board *board, int color, bool only_attack);
 void remove_piece (Board *board, int square, Board *new_board);
 int same_pieces_that_can_capture_a_square (Board *board, int color, int square, int *pieces, char piece_filter);
+bool attacked (Board *board, int color, int square);
 bool capture (Board *board, int color, int square);
 bool pieces_can_safe_capture (Board *board, int color, int square);
 bool king_in_check (Board *board, int color);
@@ -60,5 +85,14 @@ bool get_coord (Board *board, char piece, const char* disambiguating, const char
 bool try_move (Board *board, int from, int to, char promote_in, Board *new_board, char **move_done, char *capture);
 char* get_notation (Board *board, int from, int to, int capture, int ep, char promotion, int check, int checkmate);
 char* to_fen (Board *board);
+char promotion_to_char (int promotion);
+int char_to_promotion (char piece);
+bool make_move (Board *board, int from, int to, char promote_in, Board *new_board, char **move_done);
+int legal_moves (Board *board, int *moves);
+unsigned long long perft (Board *board, int depth, const volatile int *stop);
+bool valid_position (Board *board);
+void normalize_board (Board *board);
+bool pack_position (Board *board, unsigned char *packed);
+bool unpack_position (const unsigned char *packed, Board *board);
 
 #endif
@@ -0,0 +1,40 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stdint.h>
+#include "common.h"
+#include "board.h"
+
+// An entry of a Polyglot book as stored on disk: 16 bytes, big endian. Entries
+// are sorted by key.
+typedef struct
+{
+  uint64_t key;
+  uint16_t move;
+  uint16_t weight;
+  uint32_t learn;
+} BookEntry;
+
+// A Polyglot book mapped in memory.
+typedef struct
+{
+  void *map;
+  size_t map_size;
+  const BookEntry *entries;
+  size_t count;
+} Book;
+
+bboard polyglot_key (Board *board);
+bool open_book (Book *book, const char *path);
+void close_book (Book *book);
+size_t book_entries (const Book *book, bboard key, BookEntry *entries, size_t max);
+int book_move (Board *board, int move);
+
+#endif
@@ -7,8 +7,186 @@
 
 #include "chess.h"
 
-VALUE illegal_move_error;
-VALUE board_klass;
+// Set only once by Init_chess. Classes are shareable between Ractors.
+static VALUE illegal_move_error;
+static VALUE board_klass;
+static VALUE position_klass;
+static ID id_moves_cache;
+static ID id_coord_moves_cache;
+
+// The transposition table shared by all the searches, allocated at the first
+// search, the number of threads of a search and the nodes searched so far. The
+// lock protects the engine settings, the node count and the references of the
+// table.
+static TranspositionTable *transposition_table;
+static size_t hash_mb = DEFAULT_HASH_MB;
+static int engine_threads = 1;
+static unsigned long long engine_nodes;
+static rb_nativethread_lock_t table_lock;
+
+// Typed data
+
+const rb_data_type_t game_type = {
+  .wrap_struct_name = "Chess::CGame",
+  .function = {
+    .dmark = NULL,
+    .dfree = game_free,
+    .dsize = game_memsize,
+  },
+  .flags = RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED,
+};
+
+const rb_data_type_t board_type = {
+  .wrap_struct_name = "Chess::Board",
+  .function = {
+    .dmark = board_mark,
+    .dfree = RUBY_TYPED_DEFAULT_FREE,
+    .dsize = board_memsize,
+    .dcompact = board_compact,
+  },
+  .flags = RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED,
+};
+
+const rb_data_type_t position_type = {
+  .wrap_struct_name = "Chess::Position",
+  .function = {
+    .dmark = NULL,
+    .dfree = RUBY_TYPED_DEFAULT_FREE,
+    .dsize = position_memsize,
+  },
+  .flags = RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED | RUBY_TYPED_FROZEN_SHAREABLE,
+};
+
+const rb_data_type_t explorer_type = {
+  .wrap_struct_name = "Chess::Explorer",
+  .function = {
+    .dmark = NULL,
+    .dfree = explorer_free,
+    .dsize = explorer_memsize,
+  },
+  .flags = RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED,
+};
+
+const rb_data_type_t book_type = {
+  .wrap_struct_name = "Chess::Book",
+  .function = {
+    .dmark = NULL,
+    .dfree = book_free,
+    .dsize = book_memsize,
+  },
+  .flags = RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED,
+};
+
+/*
+ * Free function of a game.
+ */
+void
+game_free (void *data)
+{
+  free_game ((Game *) data);
+}
+
+/*
+ * Memsize function of a game: the struct plus the boards and moves it owns,
+ * its share of the ones shared with its copies, and its variations.
+ */
+size_t
+game_memsize (const void *data)
+{
+  const Game *g = (const Game *) data;
+  size_t size = sizeof (Game);
+  for (int i = g->shared; i < g->current; i++)
+    size += sizeof (Board) + strlen (g->moves[i]) + 1 + strlen (g->coord_moves[i]) + 1;
+  return size + history_memsize (g->history) + variations_memsize (&g->variations);
+}
+
+/*
+ * Mark function of a board: keep alive the game that owns the board.
+ */
+void
+board_mark (void *data)
+{
+  rb_gc_mark_movable (((BoardWrapper *) data)->game);
+}
+
+/*
+ * Memsize function of a board, with its copy of the position.
+ */
+size_t
+board_memsize (const void *data)
+{
+  return sizeof (BoardWrapper);
+}
+
+/*
+ * Compact function of a board: update the reference to the game if moved.
+ */
+void
+board_compact (void *data)
+{
+  BoardWrapper *wrapper = (BoardWrapper *) data;
+  wrapper->game = rb_gc_location (wrapper->game);
+}
+
+/*
+ * Memsize function of a position.
+ */
+size_t
+position_memsize (const void *data)
+{
+  return sizeof (Position);
+}
+
+/*
+ * Free function of an explorer: unmap the file.
+ */
+void
+explorer_free (void *data)
+{
+  close_explorer ((Explorer *) data);
+  xfree (data);
+}
+
+/*
+ * Memsize function of an explorer. The mapped file is not accounted.
+ */
+size_t
+explorer_memsize (const void *data)
+{
+  return sizeof (Explorer);
+}
+
+/*
+ * Free function of a book: unmap the file.
+ */
+void
+book_free (void *data)
+{
+  close_book ((Book *) data);
+  xfree (data);
+}
+
+/*
+ * Memsize function of a book. The mapped file is not accounted.
+ */
+size_t
+book_memsize (const void *data)
+{
+  return sizeof (Book);
+}
+
+/*
+ * Wrap a copy of a board of `game` in a new Ruby {Board} object.
+ */
+VALUE
+wrap_board (VALUE game, Board *board)
+{
+  BoardWrapper *wrapper;
+  VALUE rb_board = TypedData_Make_Struct (board_klass, BoardWrapper, &board_type, wrapper);
+  memcpy (&wrapper->board, board, sizeof (Board));
+  RB_OBJ_WRITE (rb_board, &wrapper->game, game);
+  return rb_board;
+}
 
 // Game
 
@@ -19,10 +197,186 @@ VALUE
 game_alloc (VALUE class)
 {
   Game *g = init_game ();
-  return Data_Wrap_Struct (class, 0, free_game, g);
-  // VALUE tdata = Data_Wrap_Struct (class, 0, free_game, g);
-  // rb_obj_call_init (tdata, 0, 0);
-  // return tdata;
+  return TypedData_Wrap_Struct (class, &game_type, g);
+}
+
+/*
+ * Replay the moves on the game without the GVL, until done or stopped. Stops
+ * on the first illegal move storing its index in `failed`.
+ */
+void*
+game_replay_without_gvl (void *data)
+{
+  ReplayArgs *args = (ReplayArgs *) data;
+  Game *g = args->game;
+  for (; args->done < args->size && !args->stop; args->done++)
+    {
+      int m = args->moves[args->done];
+      int from = MOVE_FROM (m);
+      int to = MOVE_TO (m);
+      char promote_in = promotion_to_char (MOVE_PROMOTION (m));
+      if (!pseudo_legal_move (current_board (g), from, to) || !apply_move (g, from, to, promote_in))
+        {
+          args->failed = args->done;
+          break;
+        }
+    }
+  return NULL;
+}
+
+/*
+ * Stop the replay to let the thread handle its interrupts.
+ */
+void
+game_replay_stop (void *data)
+{
+  ((ReplayArgs *) data)->stop = 1;
+}
+
+/*
+ * Run the replay releasing the GVL and wrap the game.
+ */
+VALUE
+game_replay_run (VALUE data)
+{
+  ReplayArgs *args = (ReplayArgs *) data;
+  while (args->done < args->size && args->failed < 0)
+    {
+      args->stop = 0;
+      rb_thread_call_without_gvl (game_replay_without_gvl, args, game_replay_stop, args);
+      rb_thread_check_ints ();
+    }
+  if (args->failed >= 0)
+    {
+      int m = args->moves[args->failed];
+      char *move = ft_to_coord_move (MOVE_FROM (m), MOVE_TO (m), promotion_to_char (MOVE_PROMOTION (m)));
+      VALUE message = rb_sprintf ("Illegal move '%s'", move);
+      free (move);
+      rb_exc_raise (rb_exc_new_str (illegal_move_error, message));
+    }
+  VALUE game = TypedData_Wrap_Struct (args->klass, &game_type, args->game);
+  args->game = NULL;
+  return game;
+}
+
+/*
+ * Free the replay, also if it has been interrupted, with the game if it has
+ * not been wrapped.
+ */
+VALUE
+game_replay_free (VALUE data)
+{
+  ReplayArgs *args = (ReplayArgs *) data;
+  xfree (args->moves);
+  if (args->game)
+    free_game (args->game);
+  return Qnil;
+}
+
+/*
+ * @overload replay(coord_moves)
+ *   Creates a new game performing all the moves in a single native call. The
+ *   moves are played without holding the GVL, so other Ruby threads can run in
+ *   the meantime, and the replay can be interrupted.
+ *   @param [Array<String>] coord_moves The array of moves in coordinate chess
+ *     notation _(es: e2e4, e7e8q, e7e8=Q)_.
+ *   @return [Game]
+ *   @raise [BadNotationError] if a move is malformed.
+ *   @raise [IllegalMoveError] if a move is illegal.
+ */
+VALUE
+game_s_replay (VALUE class, VALUE coord_moves)
+{
+  Check_Type (coord_moves, T_ARRAY);
+  ReplayArgs args;
+  args.size = RARRAY_LEN (coord_moves);
+  // Validate all the moves before allocating anything
+  for (long i = 0; i < args.size; i++)
+    {
+      VALUE rb_move = rb_ary_entry (coord_moves, i);
+      Check_Type (rb_move, T_STRING);
+      const char *s = StringValueCStr (rb_move);
+      size_t len = strlen (s);
+      int promotion = 0;
+      if (len == 5)
+        promotion = char_to_promotion (s[4]);
+      else if (len == 6 && s[4] == '=')
+        promotion = char_to_promotion (s[5]);
+      if ((len != 4 && !promotion)
+          || s[0] < 'a' || s[0] > 'h' || s[1] < '1' || s[1] > '8'
+          || s[2] < 'a' || s[2] > 'h' || s[3] < '1' || s[3] > '8')
+        rb_raise (rb_path2class ("Chess::BadNotationError"), "Invalid notation '%s'", s);
+    }
+  args.moves = ALLOC_N (int, args.size);
+  for (long i = 0; i < args.size; i++)
+    {
+      const char *s = RSTRING_PTR (rb_ary_entry (coord_moves, i));
+      int promotion = s[4] ? char_to_promotion (s[4] == '=' ? s[5] : s[4]) : 0;
+      args.moves[i] = MOVE (coord_to_square (s), coord_to_square (s + 2), promotion);
+    }
+  args.klass = class;
+  args.game = init_game ();
+  args.done = 0;
+  args.failed = -1;
+  return rb_ensure (game_replay_run, (VALUE) &args, game_replay_free, (VALUE) &args);
+}
+
+/*
+ * Deserialize the game without the GVL.
+ */
+void*
+game_load_without_gvl (void *data)
+{
+  LoadArgs *args = (LoadArgs *) data;
+  args->game = load_game (args->data, args->size);
+  return NULL;
+}
+
+/*
+ * @overload from_binary(data)
+ *   Creates a new game from the compact binary format returned by
+ *   {#to_binary}. The moves are restored with the move generator only, without
+ *   parsing any notation, and without holding the GVL.
+ *   @param [String] data The binary string.
+ *   @return [Game]
+ *   @raise [InvalidBinaryFormatError]
+ */
+VALUE
+game_s_from_binary (VALUE class, VALUE data)
+{
+  StringValue (data);
+  LoadArgs args;
+  args.size = RSTRING_LEN (data);
+  args.data = ALLOC_N (unsigned char, args.size);
+  memcpy (args.data, RSTRING_PTR (data), args.size);
+  rb_thread_call_without_gvl (game_load_without_gvl, &args, NULL, NULL);
+  xfree (args.data);
+  if (!args.game)
+    rb_raise (rb_path2class ("Chess::InvalidBinaryFormatError"), "Invalid binary format");
+  return TypedData_Wrap_Struct (class, &game_type, args.game);
+}
+
+/*
+ * @overload initialize_copy(other)
+ *   Called by `dup` and `clone`. The copy shares the boards and the moves
+ *   played in `other`, which are never changed, so copying a game does not
+ *   depend on its length. Moves played in a copy and in `other` later are
+ *   their own.
+ *   @param [Game] other The game to copy.
+ *   @return [Game]
+ */
+VALUE
+game_initialize_copy (VALUE self, VALUE other)
+{
+  rb_obj_init_copy (self, other);
+  if (self == other)
+    return self;
+  Game *g, *o;
+  GetGame (self, g);
+  GetGame (other, o);
+  DATA_PTR (self) = copy_game (o);
+  free_game (g);
+  return self;
 }
 
 /*
@@ -37,8 +391,9 @@ VALUE
 game_set_fen (VALUE self, VALUE fen)
 {
   Game *g;
-  Data_Get_Struct (self, Game, g);
+  GetGame (self, g);
   set_fen (g, StringValuePtr (fen));
+  invalidate_moves (self);
   return self;
 }
 
@@ -72,7 +427,7 @@ VALUE
 game_move (VALUE self, VALUE rb_piece, VALUE rb_disambiguating, VALUE rb_to_coord, VALUE rb_promote_in)
 {
   Game *g;
-  Data_Get_Struct (self, Game, g);
+  GetGame (self, g);
   Board *board = current_board (g);
   char piece = StringValuePtr (rb_piece)[0];
   char *disambiguating = rb_disambiguating == Qnil ? NULL : StringValuePtr (rb_disambiguating);
@@ -83,7 +438,10 @@ game_move (VALUE self, VALUE rb_piece, VALUE rb_disambiguating, VALUE rb_to_coor
     get_coord (board, piece, disambiguating, to_coord, promote_in, &from, &to) &&
     apply_move (g, from, to, promote_in)
   )
-    return rb_str_new2 (current_move (g));
+    {
+      invalidate_moves (self);
+      return rb_str_new2 (current_move (g));
+    }
   else
     rb_raise (illegal_move_error, "Illegal move");
 }
@@ -107,13 +465,16 @@ VALUE
 game_move2 (VALUE self, VALUE rb_from, VALUE rb_to, VALUE rb_promote_in)
 {
   Game *g;
-  Data_Get_Struct (self, Game, g);
+  GetGame (self, g);
   Board *board = current_board (g);
   int from = coord_to_square (StringValuePtr (rb_from));
   int to = coord_to_square (StringValuePtr (rb_to));
   char promote_in = rb_promote_in == Qnil ? '\0' : StringValuePtr (rb_promote_in)[0];
   if (pseudo_legal_move (board, from, to) && apply_move (g, from, to, promote_in))
-    return rb_str_new2 (current_move (g));
+    {
+      invalidate_moves (self);
+      return rb_str_new2 (current_move (g));
+    }
   else
     rb_raise (illegal_move_error, "Illegal move");
 }
@@ -151,13 +512,16 @@ VALUE
 game_move3 (VALUE self, VALUE rb_from, VALUE rb_to, VALUE rb_promote_in)
 {
   Game *g;
-  Data_Get_Struct (self, Game, g);
+  GetGame (self, g);
   Board *board = current_board (g);
   int from = FIX2INT (rb_from);
   int to = FIX2INT (rb_to);
   char promote_in = rb_promote_in == Qnil ? '\0' : StringValuePtr (rb_promote_in)[0];
   if (pseudo_legal_move (board, from, to) && apply_move (g, from, to, promote_in))
-    return rb_str_new2 (current_move (g));
+    {
+      invalidate_moves (self);
+      return rb_str_new2 (current_move (g));
+    }
   else
     rb_raise (illegal_move_error, "Illegal move");
 }
@@ -174,7 +538,7 @@ VALUE
 game_resign (VALUE self, VALUE color)
 {
   Game *g;
-  Data_Get_Struct (self, Game, g);
+  GetGame (self, g);
   const char *c;
   if (TYPE (color) == T_SYMBOL)
     c = rb_id2name (SYM2ID (color));
@@ -196,7 +560,7 @@ VALUE
 game_draw (VALUE self)
 {
   Game *g;
-  Data_Get_Struct (self, Game, g);
+  GetGame (self, g);
   g->result = DRAW;
   return Qnil;
 }
@@ -211,11 +575,11 @@ VALUE
 game_boards (VALUE self, VALUE index)
 {
   Game *g;
-  Data_Get_Struct (self, Game, g);
+  GetGame (self, g);
   int n = FIX2INT (index);
   Board *board = get_board (g, n);
   if (board)
-    return Data_Wrap_Struct (board_klass, 0, 0, board);
+    return wrap_board (self, board);
   return Qnil;
 }
 
@@ -229,7 +593,7 @@ VALUE
 game_current_board (VALUE self)
 {
   Game *g;
-  Data_Get_Struct (self, Game, g);
+  GetGame (self, g);
   return game_boards (self, INT2FIX (g->current-1));
 }
 
@@ -241,12 +605,7 @@ game_current_board (VALUE self)
 VALUE
 game_moves (VALUE self)
 {
-  Game *g;
-  Data_Get_Struct (self, Game, g);
-  VALUE moves = rb_ary_new ();
-  for (int i = 0; i < g->current; i++)
-    rb_ary_push (moves, rb_str_new2 (g->moves[i]));
-  return moves;
+  return rb_ary_dup (cached_moves (self, id_moves_cache));
 }
 
 /*
@@ -258,12 +617,7 @@ game_moves (VALUE self)
 VALUE
 game_coord_moves (VALUE self)
 {
-  Game *g;
-  Data_Get_Struct (self, Game, g);
-  VALUE moves = rb_ary_new ();
-  for (int i = 0; i < g->current; i++)
-    rb_ary_push (moves, rb_str_new2 (g->coord_moves[i]));
-  return moves;
+  return rb_ary_dup (cached_moves (self, id_coord_moves_cache));
 }
 
 /*
@@ -286,7 +640,7 @@ VALUE
 game_threefold_repetition (VALUE self)
 {
   Game *g;
-  Data_Get_Struct (self, Game, g);
+  GetGame (self, g);
   if (threefold_repetition (g))
     return Qtrue;
   else
@@ -307,7 +661,7 @@ VALUE
 game_result (VALUE self)
 {
   Game *g;
-  Data_Get_Struct (self, Game, g);
+  GetGame (self, g);
   char *result = result_to_s (g->result);
   VALUE rb_result = rb_str_new2 (result);
   free (result);
@@ -323,7 +677,7 @@ VALUE
 game_size (VALUE self)
 {
   Game *g;
-  Data_Get_Struct (self, Game, g);
+  GetGame (self, g);
   return INT2FIX (g->current);
 }
 
@@ -342,155 +696,533 @@ game_each (VALUE self)
   if (!rb_block_given_p ())
     return game_moves(self);
   Game *g;
-  Data_Get_Struct (self, Game, g);
-  for (int i = 0; i < g->current; i++)
+  GetGame (self, g);
+  VALUE moves = cached_moves (self, id_moves_cache);
+  VALUE coord_moves = cached_moves (self, id_coord_moves_cache);
+  for (int i = 0; i < g->current && i < RARRAY_LEN (moves); i++)
     rb_yield_values (4,
-                     Data_Wrap_Struct (board_klass, 0, 0, get_board (g, i)),
-                     rb_str_new2 (g->moves[i]),
-                     rb_str_new2 (g->coord_moves[i]),
+                     wrap_board (self, get_board (g, i)),
+                     RARRAY_AREF (moves, i),
+                     RARRAY_AREF (coord_moves, i),
                      INT2FIX (i));
   return self;
 }
 
 /*
- * @overload rollback!
- *   Rollback last move.
- *   @return [Game] Returns `self` with last move cancelled.
+ * @overload each_move
+ *   Cycle the moves of the {Game} without allocating new strings.
+ *   @yield [move, index]
+ *     Calls `block` once for each move in `self`, passing the frozen `move` in
+ *     short algebraic chess notation and its `index` as parameters.
+ *   @return [Game] Returns `self` if a block is given.
+ *   @return [Enumerator] Returns an enumerator if no block is given.
  */
 VALUE
-game_rollback (VALUE self)
+game_each_move (VALUE self)
 {
-  Game *g;
-  Data_Get_Struct (self, Game, g);
-  rollback (g);
+  RETURN_SIZED_ENUMERATOR (self, 0, 0, game_enum_size);
+  VALUE moves = cached_moves (self, id_moves_cache);
+  for (long i = 0; i < RARRAY_LEN (moves); i++)
+    rb_yield_values (2, RARRAY_AREF (moves, i), LONG2FIX (i));
   return self;
 }
 
 /*
- * @overload to_s
- *   Current {Board} to string.
- *   @return [String]
+ * @overload each_coord_move
+ *   Cycle the moves of the {Game} in coordinate chess notation without
+ *   allocating new strings.
+ *   @yield [move, index]
+ *     Calls `block` once for each move in `self`, passing the frozen `move` in
+ *     coordinate chess notation and its `index` as parameters.
+ *   @return [Game] Returns `self` if a block is given.
+ *   @return [Enumerator] Returns an enumerator if no block is given.
  */
 VALUE
-game_to_s (VALUE self)
+game_each_coord_move (VALUE self)
 {
-  Game *g;
-  Data_Get_Struct (self, Game, g);
-  Board *b = get_board (g, g->current-1);
-  char *s = print_board (b);
-  VALUE rb_s = rb_str_new2 (s);
-  free (s);
-  return rb_s;
+  RETURN_SIZED_ENUMERATOR (self, 0, 0, game_enum_size);
+  VALUE moves = cached_moves (self, id_coord_moves_cache);
+  for (long i = 0; i < RARRAY_LEN (moves); i++)
+    rb_yield_values (2, RARRAY_AREF (moves, i), LONG2FIX (i));
+  return self;
 }
 
-// Board
-
 /*
- * @overload placement
- *   Cycle the {Board} squares.
- *   @yield [piece, index]
- *     Calls `block` once for each square in the {Board}, passing the `piece` in
- *     the square and the `index` as parameters.
- *   @return [Board] Returns `self` if a block is given.
- *   @return [Array<String>] Returns the array of pieces if no block is given.
+ * @overload each_ply
+ *   Cycle the moves of the {Game} as packed integers, without allocating any
+ *   object. The starting square is in bits 6-11, the ending square in bits
+ *   0-5 and the promotion piece in bits 12-14 (1 knight, 2 bishop, 3 rook, 4
+ *   queen), like Polyglot moves. Squares are numbered as in {Game#move3}.
+ *   @yield [ply, index]
+ *     Calls `block` once for each move in `self`, passing the packed `ply`
+ *     (`nil` for a position set by FEN) and its `index` as parameters.
+ *   @return [Game] Returns `self` if a block is given.
+ *   @return [Enumerator] Returns an enumerator if no block is given.
+ *   @example
+ *     :001 > g = Chess::Game.new(['e4'])
+ *      => #<Chess::Game:0x007f88a529fa88>
+ *     :002 > g.each_ply.to_a
+ *      => [[796, 0]]
  */
 VALUE
-board_placement (VALUE self)
+game_each_ply (VALUE self)
 {
-  Board *board;
-  Data_Get_Struct (self, Board, board);
-  if (!rb_block_given_p ())
-    {
-      VALUE placement = rb_ary_new ();
-      for (int i = 0; i < 64; i++)
-        {
-          char piece = board->placement[i];
-          rb_ary_push (placement, rb_str_new (&piece, 1));
-        }
-      return placement;
-    }
-  else
+  RETURN_SIZED_ENUMERATOR (self, 0, 0, game_enum_size);
+  Game *g;
+  GetGame (self, g);
+  for (int i = 0; i < g->current; i++)
     {
-      for (int i = 0; i < 64; i++)
-        {
-          char piece = board->placement[i];
-          rb_yield_values (2, rb_str_new (&piece, 1), INT2FIX (i));
-        }
-      return self;
+      const char *s = g->coord_moves[i];
+      VALUE ply = Qnil;
+      if (s[0] >= 'a' && s[0] <= 'h')
+        ply = INT2FIX (MOVE (coord_to_square (s), coord_to_square (s + 2), s[4] == '=' ? char_to_promotion (s[5]) : 0));
+      rb_yield_values (2, ply, INT2FIX (i));
     }
+  return self;
 }
 
 /*
- * @overload [](square)
- *   Returns the piece on the `square` of the chessboard. If there is no piece
- *   or the square is not valid return `nil`.
- *   Each square on the chessboard is represented by an integer according to the
- *   following scheme:
- *
- *       8 | 56 57 58 59 60 61 62 63
- *       7 | 48 49 50 51 52 53 54 55
- *       6 | 40 41 42 43 44 45 46 47
- *       5 | 32 33 34 35 36 37 38 39
- *       4 | 24 25 26 27 28 29 30 31
- *       3 | 16 17 18 19 20 21 22 23
- *       2 |  8  9 10 11 12 13 14 15
- *       1 |  0  1  2  3  4  5  6  7
- *         +-------------------------
- *            a  b  c  d  e  f  g  h
- *
- *   @param [Integer,String] square The square of the {Board}. Can be an integer
- *     between 0 and 63 or a string like 'a2', 'c5'...
- *   @return [String] The symbol that identify the piece _('P', 'R', 'N', 'B',
- *     'Q', 'K')_. Upcase for a white piece, downcase for a black piece.
+ * @overload each_fen
+ *   Cycle the positions of the {Game} as FEN strings, without wrapping each
+ *   {Board}.
+ *   @yield [fen, index]
+ *     Calls `block` once for each {Board} in `self`, passing its frozen `fen`
+ *     and its `index` as parameters.
+ *   @return [Game] Returns `self` if a block is given.
+ *   @return [Enumerator] Returns an enumerator if no block is given.
  */
 VALUE
-board_get_piece (VALUE self, VALUE square)
+game_each_fen (VALUE self)
 {
-  Board *board;
-  Data_Get_Struct (self, Board, board);
-  int i;
-  if (TYPE (square) == T_STRING)
-    i = coord_to_square (StringValuePtr (square));
-  else
-    i = FIX2INT (square);
-  char piece = board->placement[i];
-  if (i < 0 || i > 63 || !piece)
-    return Qnil;
-  else
-    return rb_str_new (&piece, 1);
+  RETURN_SIZED_ENUMERATOR (self, 0, 0, game_enum_size);
+  Game *g;
+  GetGame (self, g);
+  for (int i = 0; i < g->current; i++)
+    {
+      char *fen = to_fen (g->boards[i]);
+      VALUE rb_fen = rb_obj_freeze (rb_str_new2 (fen));
+      free (fen);
+      rb_yield_values (2, rb_fen, INT2FIX (i));
+    }
+  return self;
 }
 
 /*
- * @overload check?
- *   Returns `true` if the king of the color that has the turn is in check,
- *   `false` otherwise.
+ * Size of the enumerators of the game.
  */
 VALUE
-board_king_in_check (VALUE self)
+game_enum_size (VALUE self, VALUE args, VALUE eobj)
 {
-  Board *board;
-  Data_Get_Struct (self, Board, board);
-  if (king_in_check (board, board->active_color))
-    return Qtrue;
-  else
-    return Qfalse;
+  Game *g;
+  GetGame (self, g);
+  return INT2FIX (g->current);
 }
 
 /*
- * @overload checkmate?
- *   Returns `true` if the king of the color that has the turn is in checkmate,
- *   `false` otherwise.
+ * Returns the frozen array with the interned moves of the game (in coordinate
+ * notation if `cache` is the coord moves one). The array is cached on the game
+ * until the next move or rollback.
  */
 VALUE
-board_king_in_checkmate (VALUE self)
+cached_moves (VALUE self, ID cache)
 {
-  Board *board;
-  Data_Get_Struct (self, Board, board);
-  if (king_in_checkmate (board, board->active_color))
-    return Qtrue;
-  else
-    return Qfalse;
-}
+  VALUE moves = rb_attr_get (self, cache);
+  if (!NIL_P (moves))
+    return moves;
+  Game *g;
+  GetGame (self, g);
+  char **source = cache == id_moves_cache ? g->moves : g->coord_moves;
+  moves = rb_ary_new_capa (g->current);
+  for (int i = 0; i < g->current; i++)
+    rb_ary_push (moves, rb_interned_str_cstr (source[i]));
+  rb_obj_freeze (moves);
+  if (!OBJ_FROZEN (self))
+    rb_ivar_set (self, cache, moves);
+  return moves;
+}
+
+/*
+ * Drop the cached arrays of moves.
+ */
+void
+invalidate_moves (VALUE self)
+{
+  if (OBJ_FROZEN (self))
+    return;
+  rb_ivar_set (self, id_moves_cache, Qnil);
+  rb_ivar_set (self, id_coord_moves_cache, Qnil);
+}
+
+/*
+ * @overload rollback!
+ *   Rollback last move.
+ *   @return [Game] Returns `self` with last move cancelled.
+ */
+VALUE
+game_rollback (VALUE self)
+{
+  Game *g;
+  GetGame (self, g);
+  rollback (g);
+  invalidate_moves (self);
+  return self;
+}
+
+/*
+ * @overload to_binary
+ *   Returns the game in a compact binary format: the starting FEN (if the game
+ *   was loaded from a FEN), the result and one byte for each move, that is
+ *   the index of the move in the list of legal moves of the position. Use
+ *   {from_binary} to load it.
+ *   @return [String]
+ *   @raise [RuntimeError] if a position was set by FEN after the first move.
+ */
+VALUE
+game_to_binary (VALUE self)
+{
+  Game *g;
+  GetGame (self, g);
+  size_t size;
+  unsigned char *data = dump_game (g, &size);
+  if (!data)
+    rb_raise (rb_eRuntimeError, "A game with a position set by FEN after the first move can not be serialized");
+  VALUE rb_data = rb_str_new ((char *) data, size);
+  free (data);
+  return rb_data;
+}
+
+/*
+ * @overload to_s
+ *   Current {Board} to string.
+ *   @return [String]
+ */
+VALUE
+game_to_s (VALUE self)
+{
+  Game *g;
+  GetGame (self, g);
+  Board *b = get_board (g, g->current-1);
+  char *s = print_board (b);
+  VALUE rb_s = rb_str_new2 (s);
+  free (s);
+  return rb_s;
+}
+
+/*
+ * Returns the variation of a game at path, the indexes of the variations from
+ * the main line, or NULL (the main line) if path is empty. Raises IndexError
+ * if there is no such variation.
+ */
+Variation*
+get_variation (Game *g, VALUE path)
+{
+  Check_Type (path, T_ARRAY);
+  Variation *v = NULL;
+  for (long i = 0; i < RARRAY_LEN (path); i++)
+    {
+      Variations *list = line_variations (g, v);
+      long index = NUM2LONG (RARRAY_AREF (path, i));
+      if (index < 0 || index >= list->count)
+        rb_raise (rb_eIndexError, "No variation at %"PRIsVALUE, path);
+      v = list->items[index];
+    }
+  return v;
+}
+
+/*
+ * Adds an empty variation, alternative to the move at index ply of the line
+ * at path, and returns its index among the variations of the line. Use
+ * {Game#add_variation} instead.
+ */
+VALUE
+game_variation_add (VALUE self, VALUE path, VALUE ply)
+{
+  Game *g;
+  GetGame (self, g);
+  Variation *parent = get_variation (g, path);
+  if (!add_variation (g, parent, NUM2INT (ply)))
+    rb_raise (rb_eArgError, "No move %d in the line", NUM2INT (ply));
+  return INT2FIX (line_variations (g, parent)->count - 1);
+}
+
+/*
+ * Returns the ply, the moves, the coord moves, the result and the number of
+ * variations of the line at path. Use {Variation} instead.
+ */
+VALUE
+game_variation_info (VALUE self, VALUE path)
+{
+  Game *g;
+  GetGame (self, g);
+  Variation *v = get_variation (g, path);
+  if (!v)
+    return rb_ary_new_from_args (5, INT2FIX (0), game_moves (self), game_coord_moves (self),
+                                 game_result (self), INT2FIX (g->variations.count));
+  VALUE moves = rb_ary_new_capa (v->size);
+  VALUE coord_moves = rb_ary_new_capa (v->size);
+  for (int i = 0; i < v->size; i++)
+    {
+      rb_ary_push (moves, rb_str_new2 (v->moves[i]));
+      rb_ary_push (coord_moves, rb_str_new2 (v->coord_moves[i]));
+    }
+  char *result = result_to_s (v->result);
+  VALUE rb_result = rb_str_new2 (result);
+  free (result);
+  return rb_ary_new_from_args (5, INT2FIX (v->ply), moves, coord_moves, rb_result, INT2FIX (v->variations.count));
+}
+
+/*
+ * Returns the board after the move at index of the line at path, the one
+ * before its first move if index is -1. Use {Variation#[]} instead.
+ */
+VALUE
+game_variation_board (VALUE self, VALUE path, VALUE index)
+{
+  Game *g;
+  GetGame (self, g);
+  Variation *v = get_variation (g, path);
+  int n = NUM2INT (index);
+  if (n < -1 || n >= line_size (g, v))
+    return Qnil;
+  return wrap_board (self, line_board (g, v, n));
+}
+
+/*
+ * Makes a move at the end of the variation at path as {Game#move}, or as
+ * {Game#move2} if piece is `nil` and `disambiguating` is the starting square.
+ * Use {Variation#move} instead.
+ */
+VALUE
+game_variation_move (VALUE self, VALUE path, VALUE rb_piece, VALUE rb_disambiguating, VALUE rb_to_coord, VALUE rb_promote_in)
+{
+  Game *g;
+  GetGame (self, g);
+  Variation *v = get_variation (g, path);
+  if (!v)
+    rb_raise (rb_eArgError, "Not a variation");
+  Board *board = line_board (g, v, v->size - 1);
+  char *disambiguating = rb_disambiguating == Qnil ? NULL : StringValuePtr (rb_disambiguating);
+  char *to_coord = StringValuePtr (rb_to_coord);
+  char promote_in = rb_promote_in == Qnil ? '\0' : StringValuePtr (rb_promote_in)[0];
+  int from, to;
+  bool legal;
+  if (rb_piece == Qnil)
+    {
+      from = coord_to_square (disambiguating);
+      to = coord_to_square (to_coord);
+      legal = pseudo_legal_move (board, from, to);
+    }
+  else
+    legal = get_coord (board, StringValuePtr (rb_piece)[0], disambiguating, to_coord, promote_in, &from, &to);
+  if (legal && variation_apply_move (g, v, from, to, promote_in))
+    return rb_str_new2 (v->moves[v->size - 1]);
+  rb_raise (illegal_move_error, "Illegal move");
+}
+
+/*
+ * Promotes the variation at path to the continuation of its parent line and
+ * returns its new index among the variations of the parent line. Use
+ * {Variation#promote!} instead.
+ */
+VALUE
+game_variation_promote (VALUE self, VALUE path)
+{
+  Game *g;
+  GetGame (self, g);
+  Variation *v = get_variation (g, path);
+  if (!v)
+    rb_raise (rb_eArgError, "Not a variation");
+  if (!promote_variation (g, v))
+    rb_raise (rb_eArgError, "Empty variation or main line longer than %d moves", BUFFER_SIZE);
+  if (!v->parent)
+    invalidate_moves (self);
+  Variations *list = line_variations (g, v->parent);
+  int index = 0;
+  while (list->items[index] != v)
+    index++;
+  return INT2FIX (index);
+}
+
+/*
+ * Removes the variation at path. Use {Variation#remove!} instead.
+ */
+VALUE
+game_variation_remove (VALUE self, VALUE path)
+{
+  Game *g;
+  GetGame (self, g);
+  Variation *v = get_variation (g, path);
+  if (!v)
+    rb_raise (rb_eArgError, "Not a variation");
+  remove_variation (g, v);
+  return self;
+}
+
+// Board
+
+/*
+ * @overload placement
+ *   Cycle the {Board} squares.
+ *   @yield [piece, index]
+ *     Calls `block` once for each square in the {Board}, passing the `piece` in
+ *     the square and the `index` as parameters.
+ *   @return [Board] Returns `self` if a block is given.
+ *   @return [Array<String>] Returns the array of pieces if no block is given.
+ */
+VALUE
+board_placement (VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  if (!rb_block_given_p ())
+    {
+      VALUE placement = rb_ary_new ();
+      for (int i = 0; i < 64; i++)
+        {
+          char piece = board->placement[i];
+          rb_ary_push (placement, rb_str_new (&piece, 1));
+        }
+      return placement;
+    }
+  else
+    {
+      for (int i = 0; i < 64; i++)
+        {
+          char piece = board->placement[i];
+          rb_yield_values (2, rb_str_new (&piece, 1), INT2FIX (i));
+        }
+      return self;
+    }
+}
+
+/*
+ * @overload bitboards
+ *   Returns the twelve piece bitboards of the {Board}, in the order _'P', 'N',
+ *   'B', 'R', 'Q', 'K', 'p', 'n', 'b', 'r', 'q', 'k'_. The bit `n` of a
+ *   bitboard is set if there is the piece on the square `n` (see {#[]} for the
+ *   squares numbering).
+ *   @return [Array<Integer>]
+ *   @example
+ *     :001 > g = Chess::Game.new
+ *      => #<Chess::Game:0x007f88a529fa88>
+ *     :002 > g.board.bitboards.first.to_s(16)
+ *      => "ff00"
+ */
+VALUE
+board_bitboards (VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  VALUE bitboards = rb_ary_new_capa (12);
+  for (int i = 0; i < 12; i++)
+    {
+      char piece = i < 6 ? PIECES[i] : tolower (PIECES[i-6]);
+      rb_ary_push (bitboards, ULL2NUM (*get_piece_bitboard (board, piece)));
+    }
+  return bitboards;
+}
+
+/*
+ * @overload packed(format = :bytes)
+ *   Returns the pieces placement of the {Board} in a single binary string.
+ *   @param [Symbol] format The format of the string:
+ *
+ *     * `:bytes`: 64 bytes, one for each square, with the piece character
+ *       _('P', 'R', 'N', 'B', 'Q', 'K', upcase for white, downcase for
+ *       black)_ or `"\0"` if the square is empty;
+ *     * `:nibbles`: 32 bytes, 4 bits for each square (even squares in the low
+ *       nibble). Empty squares are 0, 'P', 'N', 'B', 'R', 'Q', 'K' are 1..6
+ *       and the bit 3 is set for black pieces.
+ *   @return [String]
+ */
+VALUE
+board_packed (int argc, VALUE *argv, VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  VALUE format;
+  rb_scan_args (argc, argv, "01", &format);
+  if (NIL_P (format) || format == ID2SYM (rb_intern ("bytes")))
+    return rb_str_new (board->placement, 64);
+  if (format != ID2SYM (rb_intern ("nibbles")))
+    rb_raise (rb_eArgError, "unknown format %" PRIsVALUE, format);
+  char packed[32];
+  for (int i = 0; i < 32; i++)
+    packed[i] = piece_to_nibble (board->placement[2*i]) | piece_to_nibble (board->placement[2*i+1]) << 4;
+  return rb_str_new (packed, 32);
+}
+
+/*
+ * @overload [](square)
+ *   Returns the piece on the `square` of the chessboard. If there is no piece
+ *   or the square is not valid return `nil`.
+ *   Each square on the chessboard is represented by an integer according to the
+ *   following scheme:
+ *
+ *       8 | 56 57 58 59 60 61 62 63
+ *       7 | 48 49 50 51 52 53 54 55
+ *       6 | 40 41 42 43 44 45 46 47
+ *       5 | 32 33 34 35 36 37 38 39
+ *       4 | 24 25 26 27 28 29 30 31
+ *       3 | 16 17 18 19 20 21 22 23
+ *       2 |  8  9 10 11 12 13 14 15
+ *       1 |  0  1  2  3  4  5  6  7
+ *         +-------------------------
+ *            a  b  c  d  e  f  g  h
+ *
+ *   @param [Integer,String] square The square of the {Board}. Can be an integer
+ *     between 0 and 63 or a string like 'a2', 'c5'...
+ *   @return [String] The symbol that identify the piece _('P', 'R', 'N', 'B',
+ *     'Q', 'K')_. Upcase for a white piece, downcase for a black piece.
+ */
+VALUE
+board_get_piece (VALUE self, VALUE square)
+{
+  Board *board;
+  GetBoard (self, board);
+  int i;
+  if (TYPE (square) == T_STRING)
+    i = coord_to_square (StringValuePtr (square));
+  else
+    i = FIX2INT (square);
+  char piece = board->placement[i];
+  if (i < 0 || i > 63 || !piece)
+    return Qnil;
+  else
+    return rb_str_new (&piece, 1);
+}
+
+/*
+ * @overload check?
+ *   Returns `true` if the king of the color that has the turn is in check,
+ *   `false` otherwise.
+ */
+VALUE
+board_king_in_check (VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  if (king_in_check (board, board->active_color))
+    return Qtrue;
+  else
+    return Qfalse;
+}
+
+/*
+ * @overload checkmate?
+ *   Returns `true` if the king of the color that has the turn is in checkmate,
+ *   `false` otherwise.
+ */
+VALUE
+board_king_in_checkmate (VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  if (king_in_checkmate (board, board->active_color))
+    return Qtrue;
+  else
+    return Qfalse;
+}
 
 /*
  * @overload stalemate?
@@ -501,7 +1233,7 @@ VALUE
 board_stalemate (VALUE self)
 {
   Board *board;
-  Data_Get_Struct (self, Board, board);
+  GetBoard (self, board);
   if (stalemate (board, board->active_color))
     return Qtrue;
   else
@@ -517,7 +1249,7 @@ VALUE
 board_insufficient_material (VALUE self)
 {
   Board *board;
-  Data_Get_Struct (self, Board, board);
+  GetBoard (self, board);
   if (insufficient_material (board))
     return Qtrue;
   else
@@ -533,7 +1265,7 @@ VALUE
 board_only_kings (VALUE self)
 {
   Board *board;
-  Data_Get_Struct (self, Board, board);
+  GetBoard (self, board);
   if (only_kings (board))
     return Qtrue;
   else
@@ -549,7 +1281,7 @@ VALUE
 board_fifty_move_rule (VALUE self)
 {
   Board *board;
-  Data_Get_Struct (self, Board, board);
+  GetBoard (self, board);
   if (fifty_move_rule (board))
     return Qtrue;
   else
@@ -566,7 +1298,7 @@ VALUE
 board_active_color (VALUE self)
 {
   Board *board;
-  Data_Get_Struct (self, Board, board);
+  GetBoard (self, board);
   if (board->active_color)
     return Qtrue;
   else
@@ -584,7 +1316,7 @@ VALUE
 board_halfmove_clock (VALUE self)
 {
   Board *board;
-  Data_Get_Struct (self, Board, board);
+  GetBoard (self, board);
   return INT2FIX (board->halfmove_clock);
 }
 
@@ -598,7 +1330,7 @@ VALUE
 board_fullmove_number (VALUE self)
 {
   Board *board;
-  Data_Get_Struct (self, Board, board);
+  GetBoard (self, board);
   return INT2FIX (board->fullmove_number);
 }
 
@@ -620,7 +1352,7 @@ VALUE
 board_generate_moves (VALUE self, VALUE square)
 {
   Board *board;
-  Data_Get_Struct (self, Board, board);
+  GetBoard (self, board);
   int from;
   if (TYPE (square) == T_STRING)
     from = coord_to_square (StringValuePtr (square));
@@ -656,52 +1388,1419 @@ VALUE
 board_generate_all_moves (VALUE self)
 {
   Board *board;
-  Data_Get_Struct (self, Board, board);
-  VALUE moves = rb_ary_new ();
+  GetBoard (self, board);
+  GenerateArgs args;
+  memcpy (&args.board, board, sizeof (Board));
+  rb_thread_call_without_gvl (board_generate_all_moves_without_gvl, &args, NULL, NULL);
+  VALUE moves = rb_ary_new_capa (args.size);
+  for (int i = 0; i < args.size; i++)
+    {
+      rb_ary_push (moves, rb_str_new2 (args.moves[i]));
+      free (args.moves[i]);
+    }
+  return moves;
+}
+
+/*
+ * Generate the notation of all legal moves of the board without the GVL.
+ */
+void*
+board_generate_all_moves_without_gvl (void *data)
+{
+  GenerateArgs *args = (GenerateArgs *) data;
+  Board *board = &args->board;
   Board new_board;
   char *move_done;
   char capture;
+  args->size = 0;
   for (int i = 0; i < 64; i++)
     for (int j = 0; j < 64; j++)
       if (pseudo_legal_move (board, i, j))
         {
           move_done = castling (board, castling_type (board, i, j), &new_board);
           if (move_done || try_move (board, i, j, 'Q', &new_board, &move_done, &capture))
-            rb_ary_push (moves, rb_str_new2 (move_done));
+            args->moves[args->size++] = move_done;
         }
-  return moves;
+  return NULL;
 }
 
 /*
- * @overload to_fen
- *   Returns the FEN string of the board.
- *   @return [String]
+ * Returns the format of the legal moves from the `format:` keyword argument.
  */
-VALUE
-board_to_fen (VALUE self)
+static int
+legal_moves_format (int argc, VALUE *argv)
 {
-  Board *board;
-  Data_Get_Struct (self, Board, board);
-  char *fen = to_fen (board);
-  VALUE rb_fen = rb_str_new2 (fen);
-  free (fen);
-  return rb_fen;
-}
+  VALUE opts;
+  rb_scan_args (argc, argv, "0:", &opts);
+  VALUE format = Qundef;
+  if (!NIL_P (opts))
+    {
+      ID keys[1] = { rb_intern ("format") };
+      rb_get_kwargs (opts, keys, 0, 1, &format);
+    }
+  if (format == Qundef || format == ID2SYM (rb_intern ("uci")))
+    return MOVES_UCI;
+  if (format == ID2SYM (rb_intern ("packed")))
+    return MOVES_PACKED;
+  if (format == ID2SYM (rb_intern ("san")))
+    return MOVES_SAN;
+  rb_raise (rb_eArgError, "unknown format %" PRIsVALUE, format);
+}
+
+/*
+ * Returns the legal move of the board in the given format.
+ */
+static VALUE
+legal_move_value (Board *board, int move, int format)
+{
+  if (format == MOVES_PACKED)
+    return INT2FIX (move);
+  if (format == MOVES_SAN)
+    return move_notation (board, move);
+  char s[5];
+  s[0] = square_to_file (MOVE_FROM (move));
+  s[1] = square_to_rank (MOVE_FROM (move));
+  s[2] = square_to_file (MOVE_TO (move));
+  s[3] = square_to_rank (MOVE_TO (move));
+  s[4] = tolower (promotion_to_char (MOVE_PROMOTION (move)));
+  return rb_str_new (s, s[4] ? 5 : 4);
+}
+
+/*
+ * @overload legal_moves(format: :uci)
+ *   Generate all legal moves for the current board position. Unlike
+ *   {#generate_all_moves} the `:uci` and `:packed` formats never compute the
+ *   short algebraic notation of the moves, and promotions are listed once for
+ *   each promotion piece.
+ *   @param [Symbol] format The format of the moves:
+ *
+ *     * `:uci`: strings in UCI notation _(e2e4, e7e8q)_;
+ *     * `:packed`: integers with the destination square in the bits 0-5, the
+ *       starting square in the bits 6-11 and the promotion piece in the bits
+ *       12-14 _(0 none, 1..4 for 'N', 'B', 'R', 'Q')_;
+ *     * `:san`: strings in short algebraic chess notation, with check and
+ *       checkmate symbols.
+ *   @return [Array<String>, Array<Integer>]
+ *   @raise [ArgumentError] If the format is unknown.
+ *   @example
+ *     :001 > g = Chess::Game.new
+ *      => #<Chess::Game:0x007f88a529fa88>
+ *     :002 > g.board.legal_moves.first(3)
+ *      => ["b1a3", "b1c3", "g1f3"]
+ *     :003 > g.board.legal_moves(format: :packed).first(3)
+ *      => [80, 82, 405]
+ */
+VALUE
+board_legal_moves (int argc, VALUE *argv, VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  int format = legal_moves_format (argc, argv);
+  int moves[MAX_MOVES];
+  int n = legal_moves (board, moves);
+  VALUE rb_moves = rb_ary_new_capa (n);
+  for (int i = 0; i < n; i++)
+    rb_ary_push (rb_moves, legal_move_value (board, moves[i], format));
+  return rb_moves;
+}
+
+/*
+ * @overload legal_move_count
+ *   Returns the number of legal moves for the current board position, with
+ *   promotions counted once for each promotion piece. No Ruby objects are
+ *   allocated.
+ *   @return [Integer]
+ */
+VALUE
+board_legal_move_count (VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  int moves[MAX_MOVES];
+  return INT2FIX (legal_moves (board, moves));
+}
+
+/*
+ * Size of the enumerator of each_legal_move.
+ */
+static VALUE
+board_legal_move_enum_size (VALUE self, VALUE args, VALUE eobj)
+{
+  return board_legal_move_count (self);
+}
+
+/*
+ * @overload each_legal_move(format: :uci)
+ *   Cycle the legal moves for the current board position. A move is converted
+ *   to the given format only when it is yielded, so breaking out of the block
+ *   early skips the conversion of the remaining moves.
+ *   @param [Symbol] format The format of the moves, see {#legal_moves}.
+ *   @yield [move] Calls `block` once for each legal move.
+ *   @return [Board] Returns `self` if a block is given.
+ *   @return [Enumerator] Returns an enumerator if no block is given.
+ *   @raise [ArgumentError] If the format is unknown.
+ *   @example
+ *     :001 > g = Chess::Game.new
+ *      => #<Chess::Game:0x007f88a529fa88>
+ *     :002 > g.board.each_legal_move(format: :san).find { |m| m.start_with?('N') }
+ *      => "Na3"
+ */
+VALUE
+board_each_legal_move (int argc, VALUE *argv, VALUE self)
+{
+  RETURN_SIZED_ENUMERATOR (self, argc, argv, board_legal_move_enum_size);
+  Board *board;
+  GetBoard (self, board);
+  int format = legal_moves_format (argc, argv);
+  int moves[MAX_MOVES];
+  int n = legal_moves (board, moves);
+  for (int i = 0; i < n; i++)
+    rb_yield (legal_move_value (board, moves[i], format));
+  return self;
+}
+
+/*
+ * @overload perft(depth)
+ *   Counts the leaf nodes of the legal moves tree of the given `depth`
+ *   starting from the {Board} position. Useful to test and benchmark the move
+ *   generator. The count runs without holding the GVL and can be interrupted
+ *   by other threads.
+ *   @param [Integer] depth The depth of the tree.
+ *   @return [Integer]
+ *   @example
+ *     :001 > g = Chess::Game.new
+ *      => #<Chess::Game:0x007f88a529fa88>
+ *     :002 > g.board.perft(3)
+ *      => 8902
+ */
+VALUE
+board_perft (VALUE self, VALUE depth)
+{
+  Board *board;
+  GetBoard (self, board);
+  PerftArgs args;
+  memcpy (&args.board, board, sizeof (Board));
+  args.depth = NUM2INT (depth);
+  // A stopped count is incomplete: start again once the interrupts that did
+  // not raise are handled
+  do
+    {
+      args.stop = 0;
+      rb_thread_call_without_gvl (board_perft_without_gvl, &args, board_perft_stop, &args);
+      rb_thread_check_ints ();
+    }
+  while (args.stop);
+  return ULL2NUM (args.nodes);
+}
+
+/*
+ * Count the perft leaf nodes without the GVL.
+ */
+void*
+board_perft_without_gvl (void *data)
+{
+  PerftArgs *args = (PerftArgs *) data;
+  args->nodes = perft (&args->board, args->depth, &args->stop);
+  return NULL;
+}
+
+/*
+ * Stop the count to let the thread handle its interrupts.
+ */
+void
+board_perft_stop (void *data)
+{
+  ((PerftArgs *) data)->stop = 1;
+}
+
+/*
+ * @overload to_fen
+ *   Returns the FEN string of the board.
+ *   @return [String]
+ */
+VALUE
+board_to_fen (VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  char *fen = to_fen (board);
+  VALUE rb_fen = rb_str_new2 (fen);
+  free (fen);
+  return rb_fen;
+}
+
+/*
+ * @overload to_position
+ *   Returns the position of the board as a {Position}, a compact value that can
+ *   be compared and used as hash key. Clocks are not part of the position.
+ *   @return [Position]
+ *   @raise [RuntimeError] if the board has more than 32 pieces.
+ */
+VALUE
+board_to_position (VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  Position *position;
+  VALUE rb_position = TypedData_Make_Struct (position_klass, Position, &position_type, position);
+  if (!pack_position (board, position->packed))
+    rb_raise (rb_eRuntimeError, "Too many pieces to pack the position");
+  return rb_obj_freeze (rb_position);
+}
+
+/*
+ * Returns the short algebraic chess notation, with check and checkmate
+ * symbols, of the packed move played on the board. nil if the move is illegal.
+ */
+VALUE
+move_notation (Board *board, int move)
+{
+  Board new_board;
+  char *notation;
+  if (!pseudo_legal_move (board, MOVE_FROM (move), MOVE_TO (move))
+      || !make_move (board, MOVE_FROM (move), MOVE_TO (move), promotion_to_char (MOVE_PROMOTION (move)), &new_board, &notation))
+    return Qnil;
+  VALUE rb_notation = rb_str_new2 (notation);
+  free (notation);
+  if (king_in_check (&new_board, new_board.active_color))
+    rb_str_cat_cstr (rb_notation, king_in_checkmate (&new_board, new_board.active_color) ? "#" : "+");
+  return rb_notation;
+}
+
+/*
+ * Compare two explorer entries by number of games, most played first.
+ */
+static int
+compare_explored (const void *a, const void *b)
+{
+  const ExplorerEntry *x = (const ExplorerEntry *) a;
+  const ExplorerEntry *y = (const ExplorerEntry *) b;
+  unsigned long long nx = (unsigned long long) x->white + x->draws + x->black;
+  unsigned long long ny = (unsigned long long) y->white + y->draws + y->black;
+  return (nx < ny) - (nx > ny);
+}
+
+/*
+ * @overload explore(explorer)
+ *   Returns the moves played in the position of the {Board} in the games
+ *   indexed by the explorer, most played first.
+ *   @param [Explorer] explorer The explorer to query.
+ *   @return [Array<Hash>] For each move a hash with the short algebraic chess
+ *     notation of the move (`:move`) and the number of games won by white
+ *     (`:white`), drawn (`:draws`) and won by black (`:black`).
+ *   @raise [InvalidBinaryFormatError] if the explorer file has more moves for
+ *     the position than a position can have.
+ *   @example
+ *     :001 > explorer = Chess::Explorer.new('openings.idx')
+ *     :002 > Chess::Game.new.board.explore(explorer).first
+ *      => {:move=>"e4", :white=>120, :draws=>80, :black=>95}
+ */
+VALUE
+board_explore (VALUE self, VALUE rb_explorer)
+{
+  Board *board;
+  GetBoard (self, board);
+  Explorer *explorer;
+  GetExplorer (rb_explorer, explorer);
+  unsigned char position[POSITION_SIZE];
+  const ExplorerEntry *first;
+  size_t n = pack_position (board, position) ? explore (explorer, position, &first) : 0;
+  // A position has less legal moves than MAX_MOVES
+  if (n > MAX_MOVES)
+    rb_raise (rb_path2class ("Chess::InvalidBinaryFormatError"), "Invalid explorer file");
+  ExplorerEntry entries[MAX_MOVES];
+  memcpy (entries, first, n * sizeof (ExplorerEntry));
+  qsort (entries, n, sizeof (ExplorerEntry), compare_explored);
+  VALUE moves = rb_ary_new_capa (n);
+  for (size_t i = 0; i < n; i++)
+    {
+      VALUE rb_notation = move_notation (board, entries[i].move);
+      if (NIL_P (rb_notation))
+        continue;
+      VALUE move = rb_hash_new ();
+      rb_hash_aset (move, ID2SYM (rb_intern ("move")), rb_notation);
+      rb_hash_aset (move, ID2SYM (rb_intern ("white")), UINT2NUM (entries[i].white));
+      rb_hash_aset (move, ID2SYM (rb_intern ("draws")), UINT2NUM (entries[i].draws));
+      rb_hash_aset (move, ID2SYM (rb_intern ("black")), UINT2NUM (entries[i].black));
+      rb_ary_push (moves, move);
+    }
+  return moves;
+}
+
+/*
+ * @overload polyglot_key
+ *   Returns the Zobrist key of the position used by Polyglot opening books.
+ *   @return [Integer]
+ */
+VALUE
+board_polyglot_key (VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  return ULL2NUM (polyglot_key (board));
+}
+
+/*
+ * @overload evaluate
+ *   Returns the static evaluation of the position in centipawns from the
+ *   point of view of white: material plus piece-square bonuses, tapered
+ *   between middlegame and endgame by the material left on the board. The
+ *   evaluation is kept updated while moving, so this method is cheap.
+ *   @return [Integer]
+ *   @example
+ *     :001 > Chess::Game.new(%w[e4 d5 exd5]).board.evaluate
+ *      => 125
+ */
+VALUE
+board_evaluate (VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  int score = evaluate (board);
+  return INT2FIX (board->active_color == WHITE ? score : -score);
+}
+
+/*
+ * @overload endgame_result
+ *   Returns the result of the ending with best play if on the board there are
+ *   only the kings and a queen, a rook or a pawn. The results come from
+ *   bitbases generated in memory the first time they are needed; the
+ *   fifty-move rule is not taken into account.
+ *   @return [String, nil] `1-0`, `0-1` or `1/2-1/2`, `nil` for other
+ *     positions.
+ *   @example
+ *     :001 > g = Chess::Game.new
+ *     :002 > g.set_fen!('4k3/8/4K3/4P3/8/8/8/8 b - - 0 1')
+ *     :003 > g.board.endgame_result
+ *      => "1-0"
+ *     :004 > g.set_fen!('4k3/8/4K3/4P3/8/8/8/8 w - - 0 1')
+ *     :005 > g.board.endgame_result
+ *      => "1/2-1/2"
+ */
+VALUE
+board_endgame_result (VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  int result = probe_bitbase (board);
+  if (result == IN_PROGRESS)
+    return Qnil;
+  char *s = result_to_s (result);
+  VALUE rb_result = rb_str_new2 (s);
+  free (s);
+  return rb_result;
+}
+
+/*
+ * Returns the value of a non negative integer search limit, 0 if not given.
+ */
+static long long
+search_limit (VALUE value, const char *name)
+{
+  if (value == Qundef || NIL_P (value))
+    return 0;
+  long long limit = NUM2LL (value);
+  if (limit <= 0)
+    rb_raise (rb_eArgError, "%s must be positive", name);
+  return limit;
+}
+
+/*
+ * @overload best_move(depth: nil, nodes: nil, time_ms: nil)
+ *   Searches the best move of the active color with the built-in engine: an
+ *   iterative deepening alpha-beta search with quiescence search and move
+ *   ordering. The search stops at the first reached limit; with no limits the
+ *   search depth is 4. The search runs without holding the GVL and can be
+ *   interrupted by other threads. See {Engine} for the transposition table
+ *   size and the number of threads.
+ *   @param [Integer] depth The maximum depth in plies.
+ *   @param [Integer] nodes The maximum number of searched nodes.
+ *   @param [Integer] time_ms The maximum search time in milliseconds.
+ *   @return [String,nil] The move in short algebraic chess notation or `nil` if
+ *     there are no legal moves.
+ *   @raise [ArgumentError] If a limit is not positive.
+ *   @example
+ *     :001 > g = Chess::Game.new
+ *      => #<Chess::Game:0x007f88a529fa88>
+ *     :002 > g.board.best_move(time_ms: 500)
+ *      => "e4"
+ */
+VALUE
+board_best_move (int argc, VALUE *argv, VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  VALUE opts;
+  rb_scan_args (argc, argv, ":", &opts);
+  ID keys[3] = { rb_intern ("depth"), rb_intern ("nodes"), rb_intern ("time_ms") };
+  VALUE values[3] = { Qundef, Qundef, Qundef };
+  if (!NIL_P (opts))
+    rb_get_kwargs (opts, keys, 0, 3, values);
+  int depth = (int) search_limit (values[0], "depth");
+  unsigned long long nodes = search_limit (values[1], "nodes");
+  long time_ms = (long) search_limit (values[2], "time_ms");
+  if (!depth && !nodes && !time_ms)
+    depth = 4;
+  SearchArgs args;
+  memcpy (&args.board, board, sizeof (Board));
+  init_search (&args.search, depth, nodes, time_ms, acquire_table ());
+  rb_native_mutex_lock (&table_lock);
+  args.threads = engine_threads;
+  rb_native_mutex_unlock (&table_lock);
+  args.move = 0;
+  rb_ensure (board_best_move_search, (VALUE) &args, board_best_move_release, (VALUE) &args);
+  if (!args.move)
+    return Qnil;
+  return move_notation (&args.board, args.move);
+}
+
+/*
+ * Run the search releasing the GVL.
+ */
+VALUE
+board_best_move_search (VALUE data)
+{
+  rb_thread_call_without_gvl (board_best_move_without_gvl, (void *) data, board_best_move_stop, (void *) data);
+  return Qnil;
+}
+
+/*
+ * Release the transposition table used by the search, also if the search has
+ * been interrupted, and count its nodes.
+ */
+VALUE
+board_best_move_release (VALUE data)
+{
+  rb_native_mutex_lock (&table_lock);
+  engine_nodes += ((SearchArgs *) data)->search.nodes;
+  release_table (((SearchArgs *) data)->search.table);
+  rb_native_mutex_unlock (&table_lock);
+  return Qnil;
+}
+
+/*
+ * Search the best move without the GVL.
+ */
+void*
+board_best_move_without_gvl (void *data)
+{
+  SearchArgs *args = (SearchArgs *) data;
+  args->move = parallel_search (&args->board, &args->search, args->threads);
+  return NULL;
+}
+
+/*
+ * Stop a running search.
+ */
+void
+board_best_move_stop (void *data)
+{
+  ((SearchArgs *) data)->search.stop = 1;
+}
+
+/*
+ * @overload to_s
+ *   {Board} to string.
+ *   @return [String]
+ */
+VALUE
+board_to_s (VALUE self)
+{
+  Board *board;
+  GetBoard (self, board);
+  char *s = print_board (board);
+  VALUE rb_s = rb_str_new2 (s);
+  free (s);
+  return rb_s;
+}
+
+// Position
+
+/*
+ * @overload from_binary(data)
+ *   Creates a position from the packed encoding returned by {#to_binary}.
+ *   @param [String] data The 26 bytes of the packed position.
+ *   @return [Position]
+ *   @raise [InvalidBinaryFormatError]
+ */
+VALUE
+position_s_from_binary (VALUE class, VALUE data)
+{
+  StringValue (data);
+  Board board;
+  if (RSTRING_LEN (data) != POSITION_SIZE || !unpack_position ((unsigned char *) RSTRING_PTR (data), &board))
+    rb_raise (rb_path2class ("Chess::InvalidBinaryFormatError"), "Invalid binary format");
+  Position *position;
+  VALUE rb_position = TypedData_Make_Struct (class, Position, &position_type, position);
+  memcpy (position->packed, RSTRING_PTR (data), POSITION_SIZE);
+  return rb_obj_freeze (rb_position);
+}
+
+/*
+ * @overload to_binary
+ *   Returns the packed encoding of the position: the occupancy bitboard, the
+ *   pieces of the occupied squares (4 bits each), side to move, castling
+ *   rights and en passant square in 26 bytes. Equal positions have equal
+ *   encodings.
+ *   @return [String]
+ */
+VALUE
+position_to_binary (VALUE self)
+{
+  Position *position;
+  GetPosition (self, position);
+  return rb_str_new ((char *) position->packed, POSITION_SIZE);
+}
+
+/*
+ * @overload to_fen
+ *   Returns the FEN string of the position. The halfmove clock is 0 and the
+ *   fullmove number is 1.
+ *   @return [String]
+ */
+VALUE
+position_to_fen (VALUE self)
+{
+  Position *position;
+  GetPosition (self, position);
+  Board board;
+  unpack_position (position->packed, &board);
+  char *fen = to_fen (&board);
+  VALUE rb_fen = rb_str_new2 (fen);
+  free (fen);
+  return rb_fen;
+}
+
+/*
+ * @overload to_board
+ *   Returns the position as the {Board} of a new {Game} that starts from it.
+ *   @return [Board]
+ */
+VALUE
+position_to_board (VALUE self)
+{
+  Position *position;
+  GetPosition (self, position);
+  Board *board = NEW_BOARD;
+  unpack_position (position->packed, board);
+  VALUE game = rb_class_new_instance (0, NULL, rb_path2class ("Chess::Game"));
+  Game *g;
+  GetGame (game, g);
+  set_board (g, board);
+  return wrap_board (game, current_board (g));
+}
+
+/*
+ * @overload ==(other)
+ *   Returns true if the other object is the same position.
+ *   @param [Position] other
+ *   @return [Boolean]
+ */
+VALUE
+position_equal (VALUE self, VALUE other)
+{
+  if (!rb_typeddata_is_kind_of (other, &position_type))
+    return Qfalse;
+  Position *a, *b;
+  GetPosition (self, a);
+  GetPosition (other, b);
+  return memcmp (a->packed, b->packed, POSITION_SIZE) ? Qfalse : Qtrue;
+}
+
+/*
+ * @overload hash
+ *   Hash code of the position, consistent with {#==}.
+ *   @return [Integer]
+ */
+VALUE
+position_hash (VALUE self)
+{
+  Position *position;
+  GetPosition (self, position);
+  return ST2FIX (rb_memhash (position->packed, POSITION_SIZE));
+}
+
+// Explorer
+
+/*
+ * Alloc function
+ */
+VALUE
+explorer_alloc (VALUE class)
+{
+  Explorer *explorer;
+  VALUE rb_explorer = TypedData_Make_Struct (class, Explorer, &explorer_type, explorer);
+  explorer->map = NULL;
+  explorer->count = 0;
+  return rb_explorer;
+}
+
+/*
+ * Collect the explorer entries of the games without the GVL, until done or
+ * stopped.
+ */
+void*
+explorer_collect_without_gvl (void *data)
+{
+  CollectArgs *args = (CollectArgs *) data;
+  collect_entries (&args->collection, args->threads);
+  return NULL;
+}
+
+/*
+ * Stop the collection to let the thread handle its interrupts.
+ */
+void
+explorer_collect_stop (void *data)
+{
+  ((CollectArgs *) data)->collection.stop = 1;
+}
+
+/*
+ * Run the collection releasing the GVL and return its entries.
+ */
+VALUE
+explorer_collect_run (VALUE data)
+{
+  CollectArgs *args = (CollectArgs *) data;
+  Collection *collection = &args->collection;
+  map_pgn_files (collection);
+  while (!collection->done && collection->error == COLLECTED && !collection->out_of_memory)
+    {
+      collection->stop = 0;
+      rb_thread_call_without_gvl (explorer_collect_without_gvl, args, explorer_collect_stop, args);
+      rb_thread_check_ints ();
+    }
+  if (collection->out_of_memory)
+    rb_memerror ();
+  const char *path = collection->index >= 0 && collection->index < collection->path_count
+    ? collection->paths[collection->index] : "";
+  switch (collection->error)
+    {
+    case UNREADABLE_FILE:
+      rb_syserr_fail (collection->error_number, path);
+    case INVALID_BINARY_GAME:
+      rb_raise (rb_path2class ("Chess::InvalidBinaryFormatError"), "Invalid binary format of game %ld", collection->index);
+    case INVALID_PGN:
+      rb_raise (rb_path2class ("Chess::InvalidPgnFormatError"), "Invalid PGN format in %s at line %ld", path, collection->line);
+    case ILLEGAL_MOVE:
+      rb_raise (illegal_move_error, "Illegal move '%s' in %s at line %ld", collection->move, path, collection->line);
+    }
+  return rb_str_new ((char *) collection->entries, collection->count * sizeof (ExplorerEntry));
+}
+
+/*
+ * Free the memory of the collection.
+ */
+VALUE
+explorer_collect_free (VALUE data)
+{
+  CollectArgs *args = (CollectArgs *) data;
+  close_collection (&args->collection);
+  xfree (args->data);
+  xfree (args->sizes);
+  xfree (args->paths);
+  xfree (args->buffer);
+  return Qnil;
+}
+
+/*
+ * Returns the sorted and aggregated explorer entries, packed in a string, of
+ * the games in the binary format of {Game#to_binary} and of the PGN files,
+ * parsed and replayed natively with the given number of threads.
+ */
+VALUE
+explorer_s_collect (VALUE class, VALUE games, VALUE paths, VALUE max_plies, VALUE threads)
+{
+  Check_Type (games, T_ARRAY);
+  Check_Type (paths, T_ARRAY);
+  CollectArgs args;
+  args.threads = NUM2INT (threads);
+  if (args.threads < 1 || args.threads > MAX_THREADS)
+    rb_raise (rb_eArgError, "invalid number of threads %d", args.threads);
+  memset (&args.collection, 0, sizeof (Collection));
+  Collection *collection = &args.collection;
+  collection->size = RARRAY_LEN (games);
+  collection->path_count = RARRAY_LEN (paths);
+  collection->max_plies = NIL_P (max_plies) ? 0 : NUM2INT (max_plies);
+  collection->error = COLLECTED;
+  size_t total = 0;
+  for (size_t i = 0; i < collection->size; i++)
+    {
+      VALUE game = rb_ary_entry (games, i);
+      total += RSTRING_LEN (StringValue (game));
+    }
+  size_t length = 0;
+  for (long i = 0; i < collection->path_count; i++)
+    {
+      VALUE path = rb_ary_entry (paths, i);
+      Check_Type (path, T_STRING);
+      length += strlen (StringValueCStr (path)) + 1;
+    }
+  args.sizes = ALLOC_N (size_t, collection->size);
+  args.data = ALLOC_N (unsigned char, total);
+  for (size_t i = 0, offset = 0; i < collection->size; offset += args.sizes[i], i++)
+    {
+      VALUE game = rb_ary_entry (games, i);
+      args.sizes[i] = RSTRING_LEN (game);
+      memcpy (args.data + offset, RSTRING_PTR (game), args.sizes[i]);
+    }
+  // Copy the paths one after the other
+  args.paths = ALLOC_N (const char *, collection->path_count);
+  args.buffer = ALLOC_N (char, length);
+  for (long i = 0, offset = 0; i < collection->path_count; i++)
+    {
+      VALUE path = rb_ary_entry (paths, i);
+      memcpy (args.buffer + offset, RSTRING_PTR (path), RSTRING_LEN (path) + 1);
+      args.paths[i] = args.buffer + offset;
+      offset += RSTRING_LEN (path) + 1;
+    }
+  collection->data = args.data;
+  collection->sizes = args.sizes;
+  collection->paths = args.paths;
+  return rb_ensure (explorer_collect_run, (VALUE) &args, explorer_collect_free, (VALUE) &args);
+}
+
+/*
+ * Merge and write the explorer entries without the GVL.
+ */
+void*
+explorer_write_without_gvl (void *data)
+{
+  WriteArgs *args = (WriteArgs *) data;
+  args->count = aggregate_entries (args->entries, args->count);
+  errno = 0;
+  if (!write_explorer (args->path, args->entries, args->count))
+    args->error = errno ? errno : EIO;
+  else
+    args->error = 0;
+  return NULL;
+}
 
 /*
- * @overload to_s
- *   {Board} to string.
- *   @return [String]
+ * Merges the runs of entries returned by `collect` and writes the explorer
+ * file.
  */
 VALUE
-board_to_s (VALUE self)
+explorer_s_write (VALUE class, VALUE path, VALUE runs)
+{
+  Check_Type (runs, T_ARRAY);
+  WriteArgs args;
+  size_t total = 0;
+  for (long i = 0; i < RARRAY_LEN (runs); i++)
+    {
+      VALUE run = rb_ary_entry (runs, i);
+      StringValue (run);
+      total += RSTRING_LEN (run);
+    }
+  args.path = ALLOC_N (char, strlen (StringValueCStr (path)) + 1);
+  strcpy (args.path, RSTRING_PTR (path));
+  args.entries = (ExplorerEntry *) ALLOC_N (char, total);
+  args.count = total / sizeof (ExplorerEntry);
+  for (long i = 0, offset = 0; i < RARRAY_LEN (runs); i++)
+    {
+      VALUE run = rb_ary_entry (runs, i);
+      memcpy ((char *) args.entries + offset, RSTRING_PTR (run), RSTRING_LEN (run));
+      offset += RSTRING_LEN (run);
+    }
+  rb_thread_call_without_gvl (explorer_write_without_gvl, &args, NULL, NULL);
+  xfree (args.entries);
+  xfree (args.path);
+  if (args.error)
+    rb_syserr_fail_str (args.error, path);
+  return UINT2NUM (args.count);
+}
+
+/*
+ * @overload initialize(path)
+ *   Opens an explorer file created by {Explorer.build}. The file is mapped in
+ *   memory, so it is not loaded and can be shared between processes.
+ *   @param [String] path The path of the explorer file.
+ *   @raise [InvalidBinaryFormatError] if the file is not an explorer file.
+ *   @raise [SystemCallError] if the file can not be read.
+ */
+VALUE
+explorer_initialize (VALUE self, VALUE path)
+{
+  Explorer *explorer;
+  GetExplorer (self, explorer);
+  close_explorer (explorer);
+  if (!open_explorer (explorer, StringValueCStr (path)))
+    {
+      if (errno)
+        rb_sys_fail_str (path);
+      rb_raise (rb_path2class ("Chess::InvalidBinaryFormatError"), "Invalid explorer file");
+    }
+  return self;
+}
+
+/*
+ * @overload size
+ *   Returns the number of distinct position and move pairs in the explorer.
+ *   @return [Integer]
+ */
+VALUE
+explorer_size (VALUE self)
+{
+  Explorer *explorer;
+  GetExplorer (self, explorer);
+  return SIZET2NUM (explorer->count);
+}
+
+// Book
+
+/*
+ * Alloc function
+ */
+VALUE
+book_alloc (VALUE class)
+{
+  Book *book;
+  VALUE rb_book = TypedData_Make_Struct (class, Book, &book_type, book);
+  book->map = NULL;
+  book->count = 0;
+  return rb_book;
+}
+
+/*
+ * @overload initialize(path)
+ *   Opens a Polyglot opening book. The file is mapped in memory, so opening a
+ *   book costs nothing and the pages are shared between processes.
+ *   @param [String] path The path of the `.bin` book.
+ *   @raise [InvalidBinaryFormatError] if the file is not a Polyglot book.
+ *   @raise [SystemCallError] if the file can not be read.
+ */
+VALUE
+book_initialize (VALUE self, VALUE path)
+{
+  Book *book;
+  GetBook (self, book);
+  close_book (book);
+  if (!open_book (book, StringValueCStr (path)))
+    {
+      if (errno)
+        rb_sys_fail_str (path);
+      rb_raise (rb_path2class ("Chess::InvalidBinaryFormatError"), "Invalid Polyglot book");
+    }
+  return self;
+}
+
+/*
+ * @overload close
+ *   Unmaps the book. A closed book has no entries.
+ *   @return [nil]
+ */
+VALUE
+book_close (VALUE self)
+{
+  Book *book;
+  GetBook (self, book);
+  close_book (book);
+  return Qnil;
+}
+
+/*
+ * @overload size
+ *   Returns the number of entries of the book.
+ *   @return [Integer]
+ */
+VALUE
+book_size (VALUE self)
+{
+  Book *book;
+  GetBook (self, book);
+  return SIZET2NUM (book->count);
+}
+
+/*
+ * @overload entries(board)
+ *   Returns the book moves of the position of the board, in the order of the
+ *   book (usually the highest weight first). Illegal moves are skipped.
+ *   @param [Board] board The board to look up.
+ *   @return [Array<Hash>] For each move a hash with the short algebraic chess
+ *     notation of the move (`:move`) and its weight (`:weight`).
+ */
+VALUE
+book_entries_for (VALUE self, VALUE rb_board)
 {
+  Book *book;
+  GetBook (self, book);
   Board *board;
-  Data_Get_Struct (self, Board, board);
-  char *s = print_board (board);
-  VALUE rb_s = rb_str_new2 (s);
-  free (s);
-  return rb_s;
+  GetBoard (rb_board, board);
+  BookEntry entries[MAX_MOVES];
+  size_t n = book_entries (book, polyglot_key (board), entries, MAX_MOVES);
+  VALUE moves = rb_ary_new_capa (n);
+  for (size_t i = 0; i < n; i++)
+    {
+      VALUE rb_notation = move_notation (board, book_move (board, entries[i].move));
+      if (NIL_P (rb_notation))
+        continue;
+      VALUE move = rb_hash_new ();
+      rb_hash_aset (move, ID2SYM (rb_intern ("move")), rb_notation);
+      rb_hash_aset (move, ID2SYM (rb_intern ("weight")), UINT2NUM (entries[i].weight));
+      rb_ary_push (moves, move);
+    }
+  return moves;
+}
+
+// Engine
+
+/*
+ * Returns a reference to the shared transposition table, allocating it if
+ * needed.
+ */
+TranspositionTable*
+acquire_table (void)
+{
+  rb_native_mutex_lock (&table_lock);
+  if (!transposition_table)
+    transposition_table = new_table (hash_mb);
+  TranspositionTable *table = transposition_table;
+  if (table)
+    retain_table (table);
+  rb_native_mutex_unlock (&table_lock);
+  if (!table)
+    rb_memerror ();
+  return table;
+}
+
+/*
+ * @overload hash_mb
+ *   Returns the size in megabytes of the transposition table shared by the
+ *   searches of {Board#best_move}.
+ *   @return [Integer]
+ */
+VALUE
+engine_s_hash_mb (VALUE self)
+{
+  rb_native_mutex_lock (&table_lock);
+  size_t size_mb = hash_mb;
+  rb_native_mutex_unlock (&table_lock);
+  return SIZET2NUM (size_mb);
+}
+
+/*
+ * @overload hash_mb=(size_mb)
+ *   Sets the size in megabytes of the transposition table, 16 by default. The
+ *   number of entries is rounded down to a power of two. The previous table is
+ *   discarded when the running searches end.
+ *   @param [Integer] size_mb The size in megabytes, at most 4096.
+ *   @raise [ArgumentError] If the size is not positive or is too large.
+ */
+VALUE
+engine_s_set_hash_mb (VALUE self, VALUE size_mb)
+{
+  long long size = NUM2LL (size_mb);
+  if (size <= 0 || size > MAX_HASH_MB)
+    rb_raise (rb_eArgError, "invalid hash size %lld", size);
+  rb_native_mutex_lock (&table_lock);
+  hash_mb = (size_t) size;
+  if (transposition_table)
+    release_table (transposition_table);
+  transposition_table = NULL;
+  rb_native_mutex_unlock (&table_lock);
+  return size_mb;
+}
+
+/*
+ * @overload clear
+ *   Removes all the entries of the transposition table, so that the next
+ *   searches do not reuse the results of the previous ones.
+ *   @return [nil]
+ */
+VALUE
+engine_s_clear (VALUE self)
+{
+  rb_native_mutex_lock (&table_lock);
+  if (transposition_table)
+    clear_table (transposition_table);
+  rb_native_mutex_unlock (&table_lock);
+  return Qnil;
+}
+
+/*
+ * @overload nodes
+ *   Returns the number of nodes searched by {Board#best_move} since the library
+ *   was loaded. The nodes of the helper threads of a search are not counted.
+ *   @return [Integer]
+ */
+VALUE
+engine_s_nodes (VALUE self)
+{
+  rb_native_mutex_lock (&table_lock);
+  unsigned long long nodes = engine_nodes;
+  rb_native_mutex_unlock (&table_lock);
+  return ULL2NUM (nodes);
+}
+
+/*
+ * @overload threads
+ *   Returns the number of threads of a search.
+ *   @return [Integer]
+ */
+VALUE
+engine_s_threads (VALUE self)
+{
+  rb_native_mutex_lock (&table_lock);
+  int threads = engine_threads;
+  rb_native_mutex_unlock (&table_lock);
+  return INT2FIX (threads);
+}
+
+/*
+ * @overload threads=(threads)
+ *   Sets the number of threads of a search, 1 by default. With more threads
+ *   the search is a Lazy SMP search: helper threads search the same position
+ *   with different depths and move orders sharing the transposition table,
+ *   that makes the main thread reach the same depth faster. The limits of
+ *   {Board#best_move} apply to the main thread.
+ *   @param [Integer] threads The number of threads, from 1 to 256.
+ *   @raise [ArgumentError] If the number is out of range.
+ */
+VALUE
+engine_s_set_threads (VALUE self, VALUE threads)
+{
+  int n = NUM2INT (threads);
+  if (n < 1 || n > MAX_THREADS)
+    rb_raise (rb_eArgError, "invalid number of threads %d", n);
+  rb_native_mutex_lock (&table_lock);
+  engine_threads = n;
+  rb_native_mutex_unlock (&table_lock);
+  return threads;
+}
+
+// Database
+
+/*
+ * Validate the files without the GVL, until done or stopped.
+ */
+void*
+database_validate_without_gvl (void *data)
+{
+  ValidateArgs *args = (ValidateArgs *) data;
+  validate_pgn_files (&args->validation, args->threads);
+  return NULL;
+}
+
+/*
+ * Stop the validation to let the thread handle its interrupts.
+ */
+void
+database_validate_stop (void *data)
+{
+  ((ValidateArgs *) data)->validation.stop = 1;
+}
+
+/*
+ * Run the validation releasing the GVL and build the results.
+ */
+VALUE
+database_validate_run (VALUE data)
+{
+  ValidateArgs *args = (ValidateArgs *) data;
+  Validation *validation = &args->validation;
+  while (validation->next < validation->size && !validation->out_of_memory)
+    {
+      validation->stop = 0;
+      rb_thread_call_without_gvl (database_validate_without_gvl, args, database_validate_stop, args);
+      rb_thread_check_ints ();
+    }
+  if (validation->out_of_memory)
+    rb_memerror ();
+  VALUE failures = rb_ary_new_capa (validation->failure_count);
+  for (size_t i = 0; i < validation->failure_count; i++)
+    {
+      ValidationFailure *failure = &validation->failures[i];
+      rb_ary_push (failures, rb_ary_new_from_args (
+        5, LONG2NUM (failure->file), LONG2NUM (failure->game), INT2FIX (failure->ply),
+        failure->move[0] ? rb_str_new2 (failure->move) : Qnil,
+        ID2SYM (rb_intern (failure_reason_to_s (failure->reason)))));
+    }
+  return rb_ary_new_from_args (3, LONG2NUM (validation->games), LONG2NUM (validation->plies), failures);
+}
+
+/*
+ * Free the memory of the validation.
+ */
+VALUE
+database_validate_free (VALUE data)
+{
+  ValidateArgs *args = (ValidateArgs *) data;
+  free (args->validation.failures);
+  xfree (args->validation.paths);
+  xfree (args->buffer);
+  return Qnil;
+}
+
+/*
+ * Replays the games of the PGN files natively with the given number of threads
+ * and returns the number of games, the number of plies played and the
+ * failures, each as an array with the index of the file, the game, the ply,
+ * the move and the reason. Use {Database.validate} instead.
+ */
+VALUE
+database_s_validate_files (VALUE self, VALUE paths, VALUE threads)
+{
+  Check_Type (paths, T_ARRAY);
+  ValidateArgs args;
+  args.threads = NUM2INT (threads);
+  if (args.threads < 1 || args.threads > MAX_THREADS)
+    rb_raise (rb_eArgError, "invalid number of threads %d", args.threads);
+  // Copy the paths one after the other
+  long count = RARRAY_LEN (paths);
+  size_t size = count > 0 ? (size_t) count : 0;
+  size_t length = 0;
+  for (long i = 0; i < count; i++)
+    {
+      VALUE path = rb_ary_entry (paths, i);
+      Check_Type (path, T_STRING);
+      length += strlen (StringValueCStr (path)) + 1;
+    }
+  memset (&args.validation, 0, sizeof (Validation));
+  args.validation.size = count;
+  args.validation.paths = ALLOC_N (const char *, size);
+  args.buffer = ALLOC_N (char, length);
+  for (long i = 0, offset = 0; i < count; i++)
+    {
+      VALUE path = rb_ary_entry (paths, i);
+      memcpy (args.buffer + offset, RSTRING_PTR (path), RSTRING_LEN (path) + 1);
+      args.validation.paths[i] = args.buffer + offset;
+      offset += RSTRING_LEN (path) + 1;
+    }
+  return rb_ensure (database_validate_run, (VALUE) &args, database_validate_free, (VALUE) &args);
+}
+
+// Chess
+
+/*
+ * Analyze the FENs without the GVL, until done or stopped.
+ */
+void*
+chess_analyze_fens_without_gvl (void *data)
+{
+  AnalyzeArgs *args = (AnalyzeArgs *) data;
+  int moves[MAX_MOVES];
+  Board board;
+  for (; args->done < args->size && !args->stop; args->done++)
+    {
+      FenAnalysis *result = &args->results[args->done];
+      const char *fen = args->fens + args->offsets[args->done];
+      if (!valid_fen (fen))
+        continue;
+      parse_fen (fen, &board);
+      if (!valid_position (&board))
+        continue;
+      result->valid = TRUE;
+      if (args->fields & (FEN_CHECK | FEN_CHECKMATE | FEN_STALEMATE))
+        result->check = king_in_check (&board, board.active_color);
+      if (args->fields & (FEN_LEGAL_MOVE_COUNT | FEN_CHECKMATE | FEN_STALEMATE))
+        result->legal_move_count = legal_moves (&board, moves);
+      if (args->fields & FEN_POLYGLOT_KEY)
+        result->polyglot_key = polyglot_key (&board);
+      if (args->fields & FEN_NORMALIZED)
+        {
+          normalize_board (&board);
+          result->fen = to_fen (&board);
+        }
+    }
+  return NULL;
+}
+
+/*
+ * Stop the analysis to let the thread handle its interrupts.
+ */
+void
+chess_analyze_fens_stop (void *data)
+{
+  ((AnalyzeArgs *) data)->stop = 1;
+}
+
+/*
+ * Run the analysis releasing the GVL and build the results.
+ */
+VALUE
+chess_analyze_fens_run (VALUE data)
+{
+  AnalyzeArgs *args = (AnalyzeArgs *) data;
+  while (args->done < args->size)
+    {
+      args->stop = 0;
+      rb_thread_call_without_gvl (chess_analyze_fens_without_gvl, args, chess_analyze_fens_stop, args);
+      rb_thread_check_ints ();
+    }
+  VALUE results = rb_ary_new_capa (args->size);
+  for (long i = 0; i < args->size; i++)
+    {
+      FenAnalysis *result = &args->results[i];
+      if (!result->valid)
+        {
+          rb_ary_push (results, Qnil);
+          continue;
+        }
+      VALUE hash = rb_hash_new_capa (args->count);
+      for (int j = 0; j < args->count; j++)
+        {
+          VALUE value = Qnil;
+          switch (1 << args->order[j])
+            {
+            case FEN_LEGAL_MOVE_COUNT: value = INT2FIX (result->legal_move_count); break;
+            case FEN_CHECK: value = result->check ? Qtrue : Qfalse; break;
+            case FEN_CHECKMATE: value = result->check && !result->legal_move_count ? Qtrue : Qfalse; break;
+            case FEN_STALEMATE: value = !result->check && !result->legal_move_count ? Qtrue : Qfalse; break;
+            case FEN_NORMALIZED: value = rb_str_new2 (result->fen); break;
+            case FEN_POLYGLOT_KEY: value = ULL2NUM (result->polyglot_key); break;
+            }
+          rb_hash_aset (hash, args->keys[j], value);
+        }
+      rb_ary_push (results, hash);
+    }
+  return results;
+}
+
+/*
+ * Free the analysis, also if it has been interrupted.
+ */
+VALUE
+chess_analyze_fens_free (VALUE data)
+{
+  AnalyzeArgs *args = (AnalyzeArgs *) data;
+  for (long i = 0; i < args->size; i++)
+    free (args->results[i].fen);
+  xfree (args->results);
+  xfree (args->fens);
+  xfree (args->offsets);
+  return Qnil;
+}
+
+/*
+ * @overload analyze_fens(fens, fields: [:legal_move_count, :check, :checkmate, :stalemate, :fen, :polyglot_key])
+ *   Validates and analyzes an array of FEN strings in a single native call,
+ *   without creating a {Game} for each position and without holding the GVL.
+ *   A FEN is valid if it is well formed and the position can occur in a game:
+ *   one king for each color, no pawns on the first and last ranks and the side
+ *   that has just moved not in check.
+ *   @param [Array<String>] fens The FEN strings.
+ *   @param [Array<Symbol>] fields The fields to compute:
+ *
+ *     * `:legal_move_count`: the number of legal moves;
+ *     * `:check`, `:checkmate`, `:stalemate`: the state of the side to move;
+ *     * `:fen`: the normalized FEN, without castling rights whose king and rook
+ *       are not on their squares and without en passant square if no pawn can
+ *       capture;
+ *     * `:polyglot_key`: the Polyglot key of the position.
+ *   @return [Array<Hash, nil>] For each FEN a hash with the requested fields,
+ *     `nil` if the FEN is not valid.
+ *   @raise [ArgumentError] if a field is unknown.
+ *   @example
+ *     :001 > Chess.analyze_fens(['6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1', 'invalid'], fields: %i[legal_move_count checkmate])
+ *      => [{:legal_move_count=>17, :checkmate=>false}, nil]
+ */
+VALUE
+chess_s_analyze_fens (int argc, VALUE *argv, VALUE self)
+{
+  VALUE fens, opts;
+  rb_scan_args (argc, argv, "1:", &fens, &opts);
+  Check_Type (fens, T_ARRAY);
+  ID names[FEN_FIELDS] = {
+    rb_intern ("legal_move_count"), rb_intern ("check"), rb_intern ("checkmate"),
+    rb_intern ("stalemate"), rb_intern ("fen"), rb_intern ("polyglot_key")
+  };
+  VALUE rb_fields = Qundef;
+  if (!NIL_P (opts))
+    {
+      ID key = rb_intern ("fields");
+      rb_get_kwargs (opts, &key, 0, 1, &rb_fields);
+    }
+  AnalyzeArgs args;
+  args.fields = 0;
+  args.count = 0;
+  if (rb_fields == Qundef)
+    for (; args.count < FEN_FIELDS; args.count++)
+      {
+        args.order[args.count] = args.count;
+        args.fields |= 1 << args.count;
+      }
+  else
+    {
+      Check_Type (rb_fields, T_ARRAY);
+      for (long i = 0; i < RARRAY_LEN (rb_fields); i++)
+        {
+          VALUE field = rb_ary_entry (rb_fields, i);
+          int j = 0;
+          while (j < FEN_FIELDS && !(SYMBOL_P (field) && SYM2ID (field) == names[j]))
+            j++;
+          if (j == FEN_FIELDS)
+            rb_raise (rb_eArgError, "unknown field %" PRIsVALUE, rb_inspect (field));
+          if (!(args.fields & (1 << j)))
+            args.order[args.count++] = j;
+          args.fields |= 1 << j;
+        }
+    }
+  for (int i = 0; i < args.count; i++)
+    args.keys[i] = ID2SYM (names[args.order[i]]);
+  // Copy the FENs one after the other
+  args.size = RARRAY_LEN (fens);
+  long length = 0;
+  for (long i = 0; i < args.size; i++)
+    {
+      VALUE fen = rb_ary_entry (fens, i);
+      Check_Type (fen, T_STRING);
+      length += strlen (StringValueCStr (fen)) + 1;
+    }
+  args.offsets = ALLOC_N (long, args.size);
+  args.fens = ALLOC_N (char, length);
+  args.results = ZALLOC_N (FenAnalysis, args.size);
+  for (long i = 0, offset = 0; i < args.size; i++)
+    {
+      VALUE fen = rb_ary_entry (fens, i);
+      args.offsets[i] = offset;
+      memcpy (args.fens + offset, RSTRING_PTR (fen), RSTRING_LEN (fen) + 1);
+      offset += RSTRING_LEN (fen) + 1;
+    }
+  args.done = 0;
+  return rb_ensure (chess_analyze_fens_run, (VALUE) &args, chess_analyze_fens_free, (VALUE) &args);
+}
+
+/*
+ * @overload stats
+ *   Returns the counters of the hot paths of the library: the calls of
+ *   `try_move`, `all_xray`, `king_in_check`, `king_in_checkmate`, `stalemate`
+ *   and `get_notation`, the calls and bytes of the allocations of games, boards
+ *   and strings (`malloc_calls`, `malloc_bytes`) and the copies of boards
+ *   (`board_copies`). The counters are shared by all threads and are compiled
+ *   in only if the extension is built with `--enable-stats`:
+ *
+ *       gem install chess -- --enable-stats
+ *
+ *   @return [Hash{Symbol => Integer}, nil] The counters, `nil` if they are not
+ *     compiled in.
+ *   @example
+ *     :001 > Chess.reset_stats
+ *     :002 > Chess::Game.new(%w[e4 e5 Qh5 Nc6 Bc4 Nf6 Qxf7])
+ *     :003 > Chess.stats[:king_in_checkmate]
+ *      => 1
+ */
+VALUE
+chess_s_stats (VALUE self)
+{
+  if (!STATS_ENABLED)
+    return Qnil;
+  VALUE stats = rb_hash_new_capa (STATS);
+  for (int i = 0; i < STATS; i++)
+    rb_hash_aset (stats, ID2SYM (rb_intern (stat_name (i))), ULL2NUM (get_stat (i)));
+  return stats;
+}
+
+/*
+ * @overload reset_stats
+ *   Sets all the counters of {Chess.stats} to zero.
+ *   @return [nil]
+ */
+VALUE
+chess_s_reset_stats (VALUE self)
+{
+  reset_stats ();
+  return Qnil;
 }
 
 // INIT
@@ -709,8 +2808,13 @@ board_to_s (VALUE self)
 void
 Init_chess ()
 {
-  init_chess_library ();
+  rb_ext_ractor_safe (true);
+  id_moves_cache = rb_intern ("moves_cache");
+  id_coord_moves_cache = rb_intern ("coord_moves_cache");
   VALUE chess = rb_define_module ("Chess");
+  rb_define_singleton_method (chess, "analyze_fens", chess_s_analyze_fens, -1);
+  rb_define_singleton_method (chess, "stats", chess_s_stats, 0);
+  rb_define_singleton_method (chess, "reset_stats", chess_s_reset_stats, 0);
 
   /*
    * Document-class: Chess::CGame
@@ -719,6 +2823,9 @@ Init_chess ()
    */
   VALUE game = rb_define_class_under (chess, "CGame", rb_cObject);
   rb_define_alloc_func (game, game_alloc);
+  rb_define_singleton_method (game, "replay", game_s_replay, 1);
+  rb_define_singleton_method (game, "from_binary", game_s_from_binary, 1);
+  rb_define_method (game, "initialize_copy", game_initialize_copy, 1);
   rb_define_method (game, "set_fen!", game_set_fen, 1);
   rb_define_method (game, "move", game_move, 4);
   rb_define_method (game, "move2", game_move2, 3);
@@ -734,7 +2841,18 @@ Init_chess ()
   rb_define_method (game, "result", game_result, 0);
   rb_define_method (game, "size", game_size, 0);
   rb_define_method (game, "each", game_each, 0);
+  rb_define_method (game, "each_move", game_each_move, 0);
+  rb_define_method (game, "each_coord_move", game_each_coord_move, 0);
+  rb_define_method (game, "each_ply", game_each_ply, 0);
+  rb_define_method (game, "each_fen", game_each_fen, 0);
   rb_define_method (game, "rollback!", game_rollback, 0);
+  rb_define_private_method (game, "variation_add", game_variation_add, 2);
+  rb_define_private_method (game, "variation_info", game_variation_info, 1);
+  rb_define_private_method (game, "variation_board", game_variation_board, 2);
+  rb_define_private_method (game, "variation_move", game_variation_move, 5);
+  rb_define_private_method (game, "variation_promote", game_variation_promote, 1);
+  rb_define_private_method (game, "variation_remove", game_variation_remove, 1);
+  rb_define_method (game, "to_binary", game_to_binary, 0);
   rb_define_method (game, "to_s", game_to_s, 0);
   rb_define_alias (game, "board", "current");
 
@@ -750,6 +2868,8 @@ Init_chess ()
   board_klass = rb_define_class_under (chess, "Board", rb_cObject);
   rb_undef_alloc_func (board_klass);
   rb_define_method (board_klass, "placement", board_placement, 0);
+  rb_define_method (board_klass, "bitboards", board_bitboards, 0);
+  rb_define_method (board_klass, "packed", board_packed, -1);
   rb_define_method (board_klass, "[]", board_get_piece, 1);
   rb_define_method (board_klass, "check?", board_king_in_check, 0);
   rb_define_method (board_klass, "checkmate?", board_king_in_checkmate, 0);
@@ -762,9 +2882,84 @@ Init_chess ()
   rb_define_method (board_klass, "fullmove_number", board_fullmove_number, 0);
   rb_define_method (board_klass, "generate_moves", board_generate_moves, 1);
   rb_define_method (board_klass, "generate_all_moves", board_generate_all_moves, 0);
+  rb_define_method (board_klass, "legal_moves", board_legal_moves, -1);
+  rb_define_method (board_klass, "legal_move_count", board_legal_move_count, 0);
+  rb_define_method (board_klass, "each_legal_move", board_each_legal_move, -1);
+  rb_define_method (board_klass, "perft", board_perft, 1);
   rb_define_method (board_klass, "to_fen", board_to_fen, 0);
+  rb_define_method (board_klass, "to_position", board_to_position, 0);
+  rb_define_method (board_klass, "explore", board_explore, 1);
+  rb_define_method (board_klass, "polyglot_key", board_polyglot_key, 0);
+  rb_define_method (board_klass, "evaluate", board_evaluate, 0);
+  rb_define_method (board_klass, "endgame_result", board_endgame_result, 0);
+  rb_define_method (board_klass, "best_move", board_best_move, -1);
   rb_define_method (board_klass, "to_s", board_to_s, 0);
 
+  /*
+   * Document-class: Chess::Position
+   *
+   * This class rappresents a chess position (placement, side to move, castling
+   * rights and en passant square) packed in 26 bytes. Positions are immutable
+   * and can be compared and used as hash keys without FEN strings.
+   */
+  position_klass = rb_define_class_under (chess, "Position", rb_cObject);
+  rb_undef_alloc_func (position_klass);
+  rb_define_singleton_method (position_klass, "from_binary", position_s_from_binary, 1);
+  rb_define_method (position_klass, "to_binary", position_to_binary, 0);
+  rb_define_method (position_klass, "to_fen", position_to_fen, 0);
+  rb_define_method (position_klass, "to_board", position_to_board, 0);
+  rb_define_method (position_klass, "==", position_equal, 1);
+  rb_define_method (position_klass, "eql?", position_equal, 1);
+  rb_define_method (position_klass, "hash", position_hash, 0);
+
+  /*
+   * Document-class: Chess::Explorer
+   *
+   * This class rappresents an opening explorer: for each position of a game
+   * collection the moves played next with their results, stored in a sorted
+   * table mapped in memory.
+   */
+  VALUE explorer = rb_define_class_under (chess, "Explorer", rb_cObject);
+  rb_define_alloc_func (explorer, explorer_alloc);
+  rb_define_singleton_method (explorer, "collect", explorer_s_collect, 4);
+  rb_define_singleton_method (explorer, "write", explorer_s_write, 2);
+  rb_define_method (explorer, "initialize", explorer_initialize, 1);
+  rb_define_method (explorer, "size", explorer_size, 0);
+
+  /*
+   * Document-class: Chess::Book
+   *
+   * This class rappresents a Polyglot opening book.
+   */
+  VALUE book = rb_define_class_under (chess, "Book", rb_cObject);
+  rb_define_alloc_func (book, book_alloc);
+  rb_define_method (book, "initialize", book_initialize, 1);
+  rb_define_method (book, "close", book_close, 0);
+  rb_define_method (book, "size", book_size, 0);
+  rb_define_method (book, "entries", book_entries_for, 1);
+
+  /*
+   * Document-module: Chess::Engine
+   *
+   * Settings of the built-in engine used by {Board#best_move}.
+   */
+  rb_native_mutex_initialize (&table_lock);
+  VALUE engine = rb_define_module_under (chess, "Engine");
+  rb_define_singleton_method (engine, "hash_mb", engine_s_hash_mb, 0);
+  rb_define_singleton_method (engine, "hash_mb=", engine_s_set_hash_mb, 1);
+  rb_define_singleton_method (engine, "clear", engine_s_clear, 0);
+  rb_define_singleton_method (engine, "nodes", engine_s_nodes, 0);
+  rb_define_singleton_method (engine, "threads", engine_s_threads, 0);
+  rb_define_singleton_method (engine, "threads=", engine_s_set_threads, 1);
+
+  /*
+   * Document-module: Chess::Database
+   *
+   * Tools for collections of games.
+   */
+  VALUE database = rb_define_module_under (chess, "Database");
+  rb_define_singleton_method (database, "validate_files", database_s_validate_files, 2);
+
   /*
    * Document-class: Chess::IllegalMoveError
    *
@@ -6,11 +6,171 @@
  */
 
 #include "ruby.h"
+#include "ruby/thread.h"
+#include "ruby/thread_native.h"
 #include "game.h"
+#include "explorer.h"
+#include "book.h"
+#include "search.h"
+#include "bitbase.h"
+#include "database.h"
+
+// Wrapper of a Ruby Board object. The board is a copy, so it stays valid when
+// the game rolls back or frees its plies; the game it comes from is kept alive
+// by the wrapper.
+typedef struct
+{
+  Board board;
+  VALUE game;
+} BoardWrapper;
+
+// A Ruby Position object: an immutable position in the packed encoding.
+typedef struct
+{
+  unsigned char packed[POSITION_SIZE];
+} Position;
+
+extern const rb_data_type_t game_type;
+extern const rb_data_type_t board_type;
+extern const rb_data_type_t position_type;
+extern const rb_data_type_t explorer_type;
+extern const rb_data_type_t book_type;
+
+#define GetGame(obj, g) TypedData_Get_Struct ((obj), Game, &game_type, (g))
+#define GetBoard(obj, b) ((b) = &((BoardWrapper *) rb_check_typeddata ((obj), &board_type))->board)
+#define GetPosition(obj, p) TypedData_Get_Struct ((obj), Position, &position_type, (p))
+#define GetExplorer(obj, e) TypedData_Get_Struct ((obj), Explorer, &explorer_type, (e))
+#define GetBook(obj, b) TypedData_Get_Struct ((obj), Book, &book_type, (b))
+
+// Formats of Board#legal_moves and Board#each_legal_move.
+enum { MOVES_UCI, MOVES_PACKED, MOVES_SAN };
+
+// Arguments of the functions executed without the GVL. Inputs are copied out of
+// Ruby objects before the GVL is released.
+
+typedef struct
+{
+  VALUE klass;
+  Game *game;
+  int *moves;
+  long size;
+  long done;
+  long failed;
+  volatile int stop;
+} ReplayArgs;
+
+typedef struct
+{
+  unsigned char *data;
+  size_t size;
+  Game *game;
+} LoadArgs;
+
+typedef struct
+{
+  Board board;
+  char *moves[MAX_MOVES];
+  int size;
+} GenerateArgs;
+
+typedef struct
+{
+  Board board;
+  int depth;
+  unsigned long long nodes;
+  volatile int stop;
+} PerftArgs;
+
+typedef struct
+{
+  Collection collection;
+  unsigned char *data;
+  size_t *sizes;
+  const char **paths;
+  char *buffer;
+  int threads;
+} CollectArgs;
+
+typedef struct
+{
+  Board board;
+  Search search;
+  int threads;
+  int move;
+} SearchArgs;
+
+typedef struct
+{
+  char *path;
+  ExplorerEntry *entries;
+  size_t count;
+  int error;
+} WriteArgs;
+
+typedef struct
+{
+  Validation validation;
+  char *buffer;
+  int threads;
+} ValidateArgs;
+
+// Fields of Chess.analyze_fens.
+#define FEN_LEGAL_MOVE_COUNT 0x01
+#define FEN_CHECK 0x02
+#define FEN_CHECKMATE 0x04
+#define FEN_STALEMATE 0x08
+#define FEN_NORMALIZED 0x10
+#define FEN_POLYGLOT_KEY 0x20
+#define FEN_FIELDS 6
+
+typedef struct
+{
+  bool valid;
+  bool check;
+  int legal_move_count;
+  char *fen;
+  bboard polyglot_key;
+} FenAnalysis;
+
+typedef struct
+{
+  char *fens;
+  long *offsets;
+  long size;
+  int fields;
+  int order[FEN_FIELDS];
+  VALUE keys[FEN_FIELDS];
+  int count;
+  FenAnalysis *results;
+  long done;
+  volatile int stop;
+} AnalyzeArgs;
+
+// Typed data
+
+void game_free (void *data);
+size_t game_memsize (const void *data);
+void board_mark (void *data);
+size_t board_memsize (const void *data);
+void board_compact (void *data);
+VALUE wrap_board (VALUE game, Board *board);
+size_t position_memsize (const void *data);
+void explorer_free (void *data);
+size_t explorer_memsize (const void *data);
+void book_free (void *data);
+size_t book_memsize (const void *data);
 
 // Game
 
 VALUE game_alloc (VALUE class);
+void* game_replay_without_gvl (void *data);
+void game_replay_stop (void *data);
+VALUE game_replay_run (VALUE data);
+VALUE game_replay_free (VALUE data);
+VALUE game_s_replay (VALUE class, VALUE coord_moves);
+void* game_load_without_gvl (void *data);
+VALUE game_s_from_binary (VALUE class, VALUE data);
+VALUE game_initialize_copy (VALUE self, VALUE other);
 VALUE game_set_fen (VALUE self, VALUE fen);
 VALUE game_move (VALUE self, VALUE rb_piece, VALUE rb_disambiguating, VALUE rb_to_coord, VALUE rb_promote_in);
 VALUE game_move2 (VALUE self, VALUE rb_from, VALUE rb_to, VALUE rb_promote_in);
@@ -25,12 +185,29 @@ VALUE game_threefold_repetition (VALUE self);
 VALUE game_result (VALUE self);
 VALUE game_size (VALUE self);
 VALUE game_each (VALUE self);
+VALUE game_each_move (VALUE self);
+VALUE game_each_coord_move (VALUE self);
+VALUE game_each_ply (VALUE self);
+VALUE game_each_fen (VALUE self);
+VALUE game_enum_size (VALUE self, VALUE args, VALUE eobj);
+VALUE cached_moves (VALUE self, ID cache);
+void invalidate_moves (VALUE self);
 VALUE game_rollback (VALUE self);
+VALUE game_to_binary (VALUE self);
 VALUE game_to_s (VALUE self);
+Variation* get_variation (Game *g, VALUE path);
+VALUE game_variation_add (VALUE self, VALUE path, VALUE ply);
+VALUE game_variation_info (VALUE self, VALUE path);
+VALUE game_variation_board (VALUE self, VALUE path, VALUE index);
+VALUE game_variation_move (VALUE self, VALUE path, VALUE rb_piece, VALUE rb_disambiguating, VALUE rb_to_coord, VALUE rb_promote_in);
+VALUE game_variation_promote (VALUE self, VALUE path);
+VALUE game_variation_remove (VALUE self, VALUE path);
 
 // Board
 
 VALUE board_placement (VALUE self);
+VALUE board_bitboards (VALUE self);
+VALUE board_packed (int argc, VALUE *argv, VALUE self);
 VALUE board_get_piece (VALUE self, VALUE square);
 VALUE board_king_in_check (VALUE self);
 VALUE board_king_in_checkmate (VALUE self);
@@ -42,10 +219,86 @@ VALUE board_active_color (VALUE self);
 VALUE board_halfmove_clock (VALUE self);
 VALUE board_fullmove_number (VALUE self);
 VALUE board_generate_moves (VALUE self, VALUE square);
+void* board_generate_all_moves_without_gvl (void *data);
 VALUE board_generate_all_moves (VALUE self);
+VALUE board_legal_moves (int argc, VALUE *argv, VALUE self);
+VALUE board_legal_move_count (VALUE self);
+VALUE board_each_legal_move (int argc, VALUE *argv, VALUE self);
+void* board_perft_without_gvl (void *data);
+void board_perft_stop (void *data);
+VALUE board_perft (VALUE self, VALUE depth);
 VALUE board_to_fen (VALUE self);
+VALUE board_to_position (VALUE self);
+VALUE move_notation (Board *board, int move);
+VALUE board_explore (VALUE self, VALUE explorer);
+VALUE board_polyglot_key (VALUE self);
+VALUE board_evaluate (VALUE self);
+VALUE board_endgame_result (VALUE self);
+VALUE board_best_move (int argc, VALUE *argv, VALUE self);
+VALUE board_best_move_search (VALUE data);
+VALUE board_best_move_release (VALUE data);
+void* board_best_move_without_gvl (void *data);
+void board_best_move_stop (void *data);
 VALUE board_to_s (VALUE self);
 
+// Engine
+
+TranspositionTable* acquire_table (void);
+VALUE engine_s_hash_mb (VALUE self);
+VALUE engine_s_set_hash_mb (VALUE self, VALUE size_mb);
+VALUE engine_s_clear (VALUE self);
+VALUE engine_s_nodes (VALUE self);
+VALUE engine_s_threads (VALUE self);
+VALUE engine_s_set_threads (VALUE self, VALUE threads);
+
+// Position
+
+VALUE position_s_from_binary (VALUE class, VALUE data);
+VALUE position_to_binary (VALUE self);
+VALUE position_to_fen (VALUE self);
+VALUE position_to_board (VALUE self);
+VALUE position_equal (VALUE self, VALUE other);
+VALUE position_hash (VALUE self);
+
+// Explorer
+
+VALUE explorer_alloc (VALUE class);
+void* explorer_collect_without_gvl (void *data);
+void explorer_collect_stop (void *data);
+VALUE explorer_collect_run (VALUE data);
+VALUE explorer_collect_free (VALUE data);
+VALUE explorer_s_collect (VALUE class, VALUE games, VALUE paths, VALUE max_plies, VALUE threads);
+void* explorer_write_without_gvl (void *data);
+VALUE explorer_s_write (VALUE class, VALUE path, VALUE runs);
+VALUE explorer_initialize (VALUE self, VALUE path);
+VALUE explorer_size (VALUE self);
+
+// Book
+
+VALUE book_alloc (VALUE class);
+VALUE book_initialize (VALUE self, VALUE path);
+VALUE book_close (VALUE self);
+VALUE book_size (VALUE self);
+VALUE book_entries_for (VALUE self, VALUE board);
+
+// Database
+
+void* database_validate_without_gvl (void *data);
+void database_validate_stop (void *data);
+VALUE database_validate_run (VALUE data);
+VALUE database_validate_free (VALUE data);
+VALUE database_s_validate_files (VALUE self, VALUE paths, VALUE threads);
+
+// Chess
+
+void* chess_analyze_fens_without_gvl (void *data);
+void chess_analyze_fens_stop (void *data);
+VALUE chess_analyze_fens_run (VALUE data);
+VALUE chess_analyze_fens_free (VALUE data);
+VALUE chess_s_analyze_fens (int argc, VALUE *argv, VALUE self);
+VALUE chess_s_stats (VALUE self);
+VALUE chess_s_reset_stats (VALUE self);
+
 // INIT
 
 void Init_chess ();
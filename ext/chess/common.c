@@ -5,6 +5,11 @@
  * This code is under LICENSE LGPLv3
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "common.h"
 
 // Given a square returns the file.
@@ -32,7 +37,7 @@ coord_to_square (const char *coord)
 char*
 square_to_coord (int square)
 {
-  char *s = (char *) malloc (3);
+  char *s = (char *) STATS_MALLOC (3);
   s[0] = square_to_file (square);
   s[1] = square_to_rank (square);
   s[2] = '\0';
@@ -44,7 +49,7 @@ square_to_coord (int square)
 char*
 ft_to_coord_move (int from, int to, char promote_in)
 {
-  char *s = (char *) malloc (7);
+  char *s = (char *) STATS_MALLOC (7);
   s[0] = square_to_file (from);
   s[1] = square_to_rank (from);
   s[2] = square_to_file (to);
@@ -63,7 +68,7 @@ ft_to_coord_move (int from, int to, char promote_in)
 char*
 result_to_s (unsigned short int r)
 {
-  char *s = (char *) malloc (8);
+  char *s = (char *) STATS_MALLOC (8);
   switch (r)
     {
     case WHITE_WON:
@@ -86,7 +91,7 @@ result_to_s (unsigned short int r)
 char*
 castling_to_s (short int castling)
 {
-  char *s = (char *) malloc (5);
+  char *s = (char *) STATS_MALLOC (5);
   int cur = 0;
   if (0x1000 & castling) { s[cur] = 'K'; cur++; }
   if (0x0100 & castling) { s[cur] = 'Q'; cur++; }
@@ -101,7 +106,7 @@ castling_to_s (short int castling)
 char*
 en_passant_to_s (short int en_passant)
 {
-  char *s = (char *) malloc (3);
+  char *s = (char *) STATS_MALLOC (3);
   if (en_passant == -1)
     strcpy (s, "-");
   else
@@ -115,3 +120,36 @@ compare (const void *a, const void *b)
 {
   return strcmp (*(const char **) a, *(const char **) b);
 }
+
+// Maps the file in memory read only and stores its size in size. Returns NULL
+// if the file can not be mapped, with errno set to 0 if the file is empty.
+void*
+map_file (const char *path, size_t *size)
+{
+  int fd = open (path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat (fd, &st) < 0)
+    {
+      close (fd);
+      return NULL;
+    }
+  *size = st.st_size;
+  void *map = NULL;
+  errno = 0;
+  if (*size > 0)
+    map = mmap (NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+  int error = errno;
+  close (fd);
+  errno = error;
+  return map == MAP_FAILED ? NULL : map;
+}
+
+// Unmaps a file mapped by map_file.
+void
+unmap_file (void *map, size_t size)
+{
+  if (map)
+    munmap (map, size);
+}
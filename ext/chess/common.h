@@ -12,13 +12,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdbool.h>
+#include "stats.h"
 
-// Boolean definition
+// Boolean definition: the same type of ruby.h, so that the extension agrees
+// on it across its files.
 
 #ifndef RUBY_BACKWARD2_BOOL_H
-#define FALSE 0
-#define TRUE 1
-typedef unsigned short bool;
+#define FALSE false
+#define TRUE true
 #endif
 
 // Macros
@@ -110,5 +112,7 @@ char* result_to_s (unsigned short int r);
 char* castling_to_s (short int castling);
 char* en_passant_to_s (short int en_passant);
 int compare (const void *a, const void *b);
+void* map_file (const char *path, size_t *size);
+void unmap_file (void *map, size_t size);
 
 #endif
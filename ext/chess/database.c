@@ -0,0 +1,539 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+// Validation of PGN collections. The games are parsed and replayed natively by
+// a pool of threads that take the files one at a time from a shared cursor, so
+// a thread that is done with a file takes the next one left.
+
+// Threads are POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include "database.h"
+
+#define VALID -1
+
+// The results of the files validated by a thread since the last merge.
+typedef struct
+{
+  long games;
+  long plies;
+  ValidationFailure *failures;
+  size_t count;
+  size_t capacity;
+  bool out_of_memory;
+} Report;
+
+typedef struct
+{
+  Validation *validation;
+  pthread_mutex_t *lock;
+  pthread_t thread;
+} Worker;
+
+// Returns how the games of a PGN file are expected to end, from the names of
+// the directories in its path as in the test collection: checkmate, white_won,
+// black_won, stalemate, threefold_repetition, fifty_move_rule,
+// insufficient_material, illegal and invalid.
+int
+path_expectations (const char *path)
+{
+  static const struct { const char *name; int expectations; } directories[] = {
+    { "checkmate", EXPECT_CHECKMATE },
+    { "white_won", EXPECT_WHITE_WON },
+    { "black_won", EXPECT_BLACK_WON },
+    { "stalemate", EXPECT_STALEMATE },
+    { "threefold_repetition", EXPECT_THREEFOLD_REPETITION },
+    { "fifty_move_rule", EXPECT_FIFTY_MOVE_RULE },
+    { "insufficient_material", EXPECT_INSUFFICIENT_MATERIAL },
+    { "illegal", EXPECT_ILLEGAL_MOVE },
+    { "invalid", EXPECT_INVALID_PGN }
+  };
+  int expectations = 0;
+  for (const char *end; (end = strchr (path, '/')); path = end + 1)
+    for (size_t i = 0; i < sizeof (directories) / sizeof (directories[0]); i++)
+      if (strlen (directories[i].name) == (size_t) (end - path)
+          && !strncmp (path, directories[i].name, end - path))
+        expectations |= directories[i].expectations;
+  return expectations;
+}
+
+// Returns the name of a failure reason.
+const char*
+failure_reason_to_s (int reason)
+{
+  static const char *reasons[] = {
+    "unreadable_file", "invalid_pgn", "illegal_move", "wrong_check",
+    "wrong_checkmate", "wrong_result", "not_checkmate", "wrong_winner",
+    "not_stalemate", "not_threefold_repetition", "not_fifty_move_rule",
+    "not_insufficient_material", "not_illegal_move", "not_invalid_pgn"
+  };
+  return reasons[reason];
+}
+
+static const char*
+skip_space (const char *p, const char *end)
+{
+  while (p < end && isspace ((unsigned char) *p))
+    p++;
+  return p;
+}
+
+static const char*
+end_of_line (const char *p, const char *end)
+{
+  const char *eol = (const char *) memchr (p, '\n', end - p);
+  return eol ? eol : end;
+}
+
+static bool
+delimiter (char c)
+{
+  return isspace ((unsigned char) c) || (c && strchr ("{}();[", c));
+}
+
+// Stores in value the value of the tag name if the tag pair line starting at p
+// is about it.
+static void
+tag_value (const char *p, const char *eol, const char *name, char *value)
+{
+  size_t n = strlen (name);
+  if ((size_t) (eol - p) < n + 2 || strncmp (p + 1, name, n) || !isspace ((unsigned char) p[n + 1]))
+    return;
+  const char *start = (const char *) memchr (p, '"', eol - p);
+  const char *stop = start ? (const char *) memchr (start + 1, '"', eol - start - 1) : NULL;
+  if (!stop)
+    return;
+  size_t size = stop - start - 1 < TAG_VALUE_SIZE ? stop - start - 1 : TAG_VALUE_SIZE - 1;
+  memcpy (value, start + 1, size);
+  value[size] = '\0';
+}
+
+// Returns true if the token is a game termination marker and stores it in
+// result if it is not already set by the tag.
+static bool
+termination (const char *token, int length, char *result)
+{
+  static const char *markers[] = { "1-0", "0-1", "1/2-1/2", "1/2", "*" };
+  for (int i = 0; i < 5; i++)
+    if ((size_t) length == strlen (markers[i]) && !strncmp (token, markers[i], length))
+      {
+        if (!result[0])
+          strcpy (result, markers[i]);
+        return TRUE;
+      }
+  return FALSE;
+}
+
+// Parses a move as the regular expressions of Game#move do, ignoring the
+// annotations (!, ?) appended to the move.
+static bool
+parse_san (const char *s, int n, SanMove *m)
+{
+  memset (m, 0, sizeof (SanMove));
+  m->text = s;
+  m->length = n;
+  while (n > 0 && (s[n - 1] == '!' || s[n - 1] == '?'))
+    n--;
+  if (n > 0 && (s[n - 1] == '+' || s[n - 1] == '#'))
+    m->suffix = s[--n];
+  if ((n == 3 || n == 5) && (s[0] == 'O' || s[0] == '0') && s[1] == '-' && (s[2] == 'O' || s[2] == '0')
+      && (n == 3 || (s[3] == '-' && (s[4] == 'O' || s[4] == '0'))))
+    {
+      m->castling = n == 3 ? 'K' : 'Q';
+      return TRUE;
+    }
+  if (n >= 2 && s[n - 2] == 'e' && s[n - 1] == 'p')
+    n -= 2;
+  if (n >= 3 && s[n - 1] && strchr ("RNBQrnbq", s[n - 1]) && (isdigit ((unsigned char) s[n - 2]) || s[n - 2] == '='))
+    {
+      m->promote_in = toupper (s[--n]);
+      if (s[n - 1] == '=')
+        n--;
+    }
+  if (n < 2 || s[n - 2] < 'a' || s[n - 2] > 'h' || s[n - 1] < '1' || s[n - 1] > '8')
+    return FALSE;
+  m->to[0] = s[n - 2];
+  m->to[1] = s[n - 1];
+  n -= 2;
+  int i = 0;
+  if (n > 0 && s[0] && strchr ("RNBQK", s[0]))
+    m->piece = s[i++];
+  if (n > i && s[n - 1] == 'x')
+    n--;
+  bool file = n > i && s[i] >= 'a' && s[i] <= 'h';
+  bool rank = n > i && s[n - 1] >= '1' && s[n - 1] <= '8';
+  if (n - i > 2 || (n - i == 2 && !(file && rank)) || (n - i == 1 && !file && !rank))
+    return FALSE;
+  memcpy (m->disambiguating, s + i, n - i);
+  return TRUE;
+}
+
+// Skips a variation (recursive annotation variation) starting at p. Returns
+// NULL if it is not closed.
+static const char*
+skip_variation (const char *p, const char *end)
+{
+  int depth = 0;
+  for (; p < end; p++)
+    {
+      if (*p == '{' && !(p = (const char *) memchr (p, '}', end - p)))
+        return NULL;
+      if (*p == ';')
+        p = end_of_line (p, end);
+      else if (*p == '(')
+        depth++;
+      else if (*p == ')' && --depth == 0)
+        return p + 1;
+    }
+  return NULL;
+}
+
+// Parses the game of the PGN text that starts at *text and moves *text after
+// it. Comments, variations, move numbers and numeric annotation glyphs are
+// skipped. Returns false if there are no more games.
+bool
+parse_pgn_game (const char **text, const char *end, PgnGame *game)
+{
+  const char *p = skip_space (*text, end);
+  if (p == end)
+    return FALSE;
+  game->result[0] = game->fen[0] = '\0';
+  game->size = 0;
+  game->invalid = NULL;
+  // Tag pairs and escaped lines
+  while (p < end && (*p == '[' || *p == '%'))
+    {
+      const char *eol = end_of_line (p, end);
+      if (*p == '[')
+        {
+          tag_value (p, eol, "Result", game->result);
+          tag_value (p, eol, "FEN", game->fen);
+        }
+      p = skip_space (eol, end);
+    }
+  // Movetext, until the termination marker or the tags of the next game
+  while ((p = skip_space (p, end)) < end && *p != '[')
+    {
+      const char *start = p;
+      if (*p == '{' || *p == '(')
+        {
+          const char *close = *p == '{' ? (const char *) memchr (p, '}', end - p) : skip_variation (p, end);
+          if (!close && !game->invalid)
+            {
+              game->invalid = start;
+              game->invalid_length = 1;
+            }
+          p = !close ? end : *p == '{' ? close + 1 : close;
+          continue;
+        }
+      if (*p == ';')
+        {
+          p = end_of_line (p, end);
+          continue;
+        }
+      while (p < end && !delimiter (*p))
+        p++;
+      // A closing bracket without the opening one
+      if (p == start)
+        p++;
+      if (termination (start, p - start, game->result))
+        break;
+      // Numeric annotation glyph
+      if (*start == '$' || game->invalid)
+        continue;
+      // Move number, maybe followed by the move
+      const char *move = start;
+      while (move < p && isdigit ((unsigned char) *move))
+        move++;
+      if (move > start && move < p && *move == '.')
+        while (move < p && *move == '.')
+          move++;
+      else
+        move = start;
+      if (move == p)
+        continue;
+      SanMove san;
+      if (!parse_san (move, p - move, &san))
+        {
+          game->invalid = move;
+          game->invalid_length = p - move;
+        }
+      else if (game->size <= BUFFER_SIZE)
+        game->moves[game->size++] = san;
+    }
+  if (!strcmp (game->result, "1/2"))
+    strcpy (game->result, "1/2-1/2");
+  *text = p;
+  return TRUE;
+}
+
+// Returns a new game in the starting position of the PGN game, NULL if the
+// game is not valid PGN or its FEN tag is not a valid position.
+Game*
+start_pgn_game (const PgnGame *pgn)
+{
+  if (pgn->invalid || (pgn->fen[0] && !valid_fen (pgn->fen)))
+    return NULL;
+  Game *g = init_game ();
+  if (pgn->fen[0])
+    {
+      Board *board = NEW_BOARD;
+      parse_fen (pgn->fen, board);
+      if (!valid_position (board))
+        {
+          free (board);
+          free_game (g);
+          return NULL;
+        }
+      set_board (g, board);
+    }
+  return g;
+}
+
+// Performs the move on the game as Game#move does.
+bool
+play_san (Game *g, const SanMove *m)
+{
+  Board *board = current_board (g);
+  int from, to;
+  if (m->castling)
+    {
+      from = board->active_color ? E8 : E1;
+      to = m->castling == 'K' ? from + 2 : from - 2;
+      return pseudo_legal_move (board, from, to) && apply_move (g, from, to, 0);
+    }
+  if (m->disambiguating[1])
+    {
+      from = coord_to_square (m->disambiguating);
+      to = coord_to_square (m->to);
+      // Castling of the UCI protocol (Lichess): the king moves on its rook
+      if ((from == E1 && board->placement[from] == 'K') || (from == E8 && board->placement[from] == 'k'))
+        to = to == from + 3 ? from + 2 : to == from - 4 ? from - 2 : to;
+      return pseudo_legal_move (board, from, to) && apply_move (g, from, to, m->promote_in);
+    }
+  return get_coord (board, m->piece, m->disambiguating[0] ? m->disambiguating : NULL, m->to, m->promote_in, &from, &to)
+    && apply_move (g, from, to, m->promote_in);
+}
+
+// Replays the game and checks it against the expectations. Returns VALID or
+// the reason of the failure, stores the failing ply (0 if the failure is not
+// about a move) and the number of plies played.
+static int
+check_game (const PgnGame *pgn, int expectations, int *ply, long *plies)
+{
+  *ply = *plies = 0;
+  Game *g = start_pgn_game (pgn);
+  if (!g)
+    return INVALID_PGN;
+  int reason = VALID;
+  for (int i = 0; i < pgn->size && reason == VALID; i++)
+    {
+      *ply = i + 1;
+      const SanMove *m = &pgn->moves[i];
+      if (!play_san (g, m))
+        {
+          reason = ILLEGAL_MOVE;
+          break;
+        }
+      (*plies)++;
+      Board *board = current_board (g);
+      if (m->suffix == '+' && !king_in_check (board, board->active_color))
+        reason = WRONG_CHECK;
+      else if (m->suffix == '#' && !king_in_checkmate (board, board->active_color))
+        reason = WRONG_CHECKMATE;
+    }
+  Board *board = current_board (g);
+  if (reason == VALID)
+    {
+      *ply = 0;
+      char *result = result_to_s (g->result);
+      if (!expectations && g->result != IN_PROGRESS && pgn->result[0] && strcmp (result, pgn->result))
+        reason = WRONG_RESULT;
+      else if ((expectations & EXPECT_CHECKMATE) && !king_in_checkmate (board, board->active_color))
+        reason = NOT_CHECKMATE;
+      else if (((expectations & EXPECT_WHITE_WON) && g->result != WHITE_WON)
+               || ((expectations & EXPECT_BLACK_WON) && g->result != BLACK_WON))
+        reason = WRONG_WINNER;
+      else if ((expectations & EXPECT_STALEMATE) && !stalemate (board, board->active_color))
+        reason = NOT_STALEMATE;
+      else if ((expectations & EXPECT_THREEFOLD_REPETITION) && !threefold_repetition (g))
+        reason = NOT_THREEFOLD_REPETITION;
+      else if ((expectations & EXPECT_FIFTY_MOVE_RULE) && !fifty_move_rule (board))
+        reason = NOT_FIFTY_MOVE_RULE;
+      else if ((expectations & EXPECT_INSUFFICIENT_MATERIAL) && !insufficient_material (board))
+        reason = NOT_INSUFFICIENT_MATERIAL;
+      free (result);
+    }
+  free_game (g);
+  return reason;
+}
+
+static void
+add_failure (Report *report, long file, long game, int ply, int reason, const char *move, int length)
+{
+  if (report->count == report->capacity)
+    {
+      size_t capacity = report->capacity ? report->capacity * 2 : 16;
+      ValidationFailure *failures = (ValidationFailure *) realloc (report->failures, capacity * sizeof (ValidationFailure));
+      if (!failures)
+        {
+          report->out_of_memory = TRUE;
+          return;
+        }
+      report->failures = failures;
+      report->capacity = capacity;
+    }
+  ValidationFailure *failure = &report->failures[report->count++];
+  failure->file = file;
+  failure->game = game;
+  failure->ply = ply;
+  failure->reason = reason;
+  length = length < FAILURE_MOVE_SIZE ? length : FAILURE_MOVE_SIZE - 1;
+  memcpy (failure->move, move, length);
+  failure->move[length] = '\0';
+}
+
+// Validates the games of a file. A file without games is not valid. The files
+// of the illegal and invalid directories must have a game that fails for that
+// reason.
+static void
+validate_file (const char *path, long file, PgnGame *pgn, Report *report)
+{
+  int expectations = path_expectations (path);
+  int expected_failure = expectations & EXPECT_INVALID_PGN ? INVALID_PGN
+    : expectations & EXPECT_ILLEGAL_MOVE ? ILLEGAL_MOVE : VALID;
+  size_t size = 0;
+  const char *data = (const char *) map_file (path, &size);
+  if (!data && errno)
+    {
+      add_failure (report, file, 0, 0, UNREADABLE_FILE, "", 0);
+      return;
+    }
+  const char *p = data, *end = data + size;
+  long games = 0;
+  bool failed = FALSE;
+  while (data && parse_pgn_game (&p, end, pgn))
+    {
+      int ply;
+      long plies;
+      int reason = check_game (pgn, expectations, &ply, &plies);
+      games++;
+      report->plies += plies;
+      if (reason == VALID)
+        continue;
+      if (expected_failure != VALID)
+        {
+          failed |= reason == expected_failure;
+          continue;
+        }
+      if (reason == INVALID_PGN && pgn->invalid)
+        add_failure (report, file, games, 0, reason, pgn->invalid, pgn->invalid_length);
+      else if (ply)
+        add_failure (report, file, games, ply, reason, pgn->moves[ply - 1].text, pgn->moves[ply - 1].length);
+      else
+        add_failure (report, file, games, 0, reason, "", 0);
+    }
+  if (!games && expected_failure != INVALID_PGN)
+    add_failure (report, file, 0, 0, INVALID_PGN, "", 0);
+  else if (games && expected_failure != VALID && !failed)
+    add_failure (report, file, 0, 0, expected_failure == INVALID_PGN ? NOT_INVALID_PGN : NOT_ILLEGAL_MOVE, "", 0);
+  report->games += games;
+  unmap_file ((void *) data, size);
+}
+
+// Merges the report of a thread into the validation. Must hold the lock.
+static void
+merge_report (Validation *validation, Report *report)
+{
+  validation->games += report->games;
+  validation->plies += report->plies;
+  validation->out_of_memory |= report->out_of_memory;
+  size_t count = validation->failure_count + report->count;
+  if (count > validation->failure_capacity)
+    {
+      size_t capacity = count * 2;
+      ValidationFailure *failures = (ValidationFailure *) realloc (validation->failures, capacity * sizeof (ValidationFailure));
+      if (!failures)
+        {
+          validation->out_of_memory = TRUE;
+          report->count = 0;
+        }
+      else
+        {
+          validation->failures = failures;
+          validation->failure_capacity = capacity;
+        }
+    }
+  memcpy (validation->failures + validation->failure_count, report->failures, report->count * sizeof (ValidationFailure));
+  validation->failure_count += report->count;
+  report->games = report->plies = 0;
+  report->count = 0;
+  report->out_of_memory = FALSE;
+}
+
+static void*
+validate_worker (void *data)
+{
+  Worker *worker = (Worker *) data;
+  Validation *validation = worker->validation;
+  Report report = { 0, 0, NULL, 0, 0, FALSE };
+  PgnGame *pgn = (PgnGame *) malloc (sizeof (PgnGame));
+  report.out_of_memory = !pgn;
+  for (;;)
+    {
+      pthread_mutex_lock (worker->lock);
+      merge_report (validation, &report);
+      if (validation->out_of_memory)
+        validation->stop = 1;
+      long file = validation->stop ? validation->size : validation->next;
+      if (file < validation->size)
+        validation->next++;
+      pthread_mutex_unlock (worker->lock);
+      if (file >= validation->size)
+        break;
+      validate_file (validation->paths[file], file, pgn, &report);
+    }
+  free (report.failures);
+  free (pgn);
+  return NULL;
+}
+
+// Validates the PGN files from the next one with the given number of threads,
+// the calling thread included. Each game is replayed checking that the moves
+// are legal, that the check and checkmate suffixes are right, that a result
+// decided on the board matches the one of the PGN and that it ends as expected
+// by its path (see path_expectations). The files being validated when the
+// validation is stopped are completed.
+void
+validate_pgn_files (Validation *validation, int threads)
+{
+  pthread_mutex_t lock;
+  pthread_mutex_init (&lock, NULL);
+  Worker *workers = (Worker *) malloc ((threads > 1 ? threads : 1) * sizeof (Worker));
+  if (!workers)
+    {
+      validation->out_of_memory = TRUE;
+      pthread_mutex_destroy (&lock);
+      return;
+    }
+  int started = 0;
+  for (int i = 0; i < (threads > 1 ? threads : 1); i++)
+    {
+      workers[i].validation = validation;
+      workers[i].lock = &lock;
+    }
+  for (; started < threads - 1; started++)
+    if (pthread_create (&workers[started + 1].thread, NULL, validate_worker, workers + started + 1))
+      break;
+  validate_worker (workers);
+  for (int i = 0; i < started; i++)
+    pthread_join (workers[i + 1].thread, NULL);
+  free (workers);
+  pthread_mutex_destroy (&lock);
+}
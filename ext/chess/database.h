@@ -0,0 +1,106 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include "common.h"
+#include "board.h"
+#include "game.h"
+
+// How the games of a file are expected to end, from the directories in its
+// path.
+#define EXPECT_CHECKMATE 0x01
+#define EXPECT_WHITE_WON 0x02
+#define EXPECT_BLACK_WON 0x04
+#define EXPECT_STALEMATE 0x08
+#define EXPECT_THREEFOLD_REPETITION 0x10
+#define EXPECT_FIFTY_MOVE_RULE 0x20
+#define EXPECT_INSUFFICIENT_MATERIAL 0x40
+#define EXPECT_ILLEGAL_MOVE 0x80
+#define EXPECT_INVALID_PGN 0x100
+
+// Reasons of a validation failure.
+#define UNREADABLE_FILE 0
+#define INVALID_PGN 1
+#define ILLEGAL_MOVE 2
+#define WRONG_CHECK 3
+#define WRONG_CHECKMATE 4
+#define WRONG_RESULT 5
+#define NOT_CHECKMATE 6
+#define WRONG_WINNER 7
+#define NOT_STALEMATE 8
+#define NOT_THREEFOLD_REPETITION 9
+#define NOT_FIFTY_MOVE_RULE 10
+#define NOT_INSUFFICIENT_MATERIAL 11
+#define NOT_ILLEGAL_MOVE 12
+#define NOT_INVALID_PGN 13
+
+#define FAILURE_MOVE_SIZE 16
+#define TAG_VALUE_SIZE 128
+
+// A move of the movetext in short algebraic chess notation.
+typedef struct
+{
+  const char *text;
+  int length;
+  char piece;
+  char disambiguating[3];
+  char to[3];
+  char promote_in;
+  char castling;
+  char suffix;
+} SanMove;
+
+// A game of a PGN file. One move more than fits in a Game is stored, so that
+// the replay fails on the first one that does not fit, as Game#move does; the
+// moves after it are not stored.
+typedef struct
+{
+  char result[TAG_VALUE_SIZE];
+  char fen[TAG_VALUE_SIZE];
+  SanMove moves[BUFFER_SIZE + 1];
+  int size;
+  const char *invalid;
+  int invalid_length;
+} PgnGame;
+
+// A game that failed the validation: game and ply count from 1, ply is 0 if
+// the failure is not about a move.
+typedef struct
+{
+  long file;
+  long game;
+  int ply;
+  int reason;
+  char move[FAILURE_MOVE_SIZE];
+} ValidationFailure;
+
+// The validation of a list of PGN files. Files are taken in order from next,
+// a stopped validation can be resumed calling validate_pgn_files again.
+typedef struct
+{
+  const char **paths;
+  long size;
+  long next;
+  long games;
+  long plies;
+  ValidationFailure *failures;
+  size_t failure_count;
+  size_t failure_capacity;
+  bool out_of_memory;
+  volatile int stop;
+} Validation;
+
+int path_expectations (const char *path);
+const char* failure_reason_to_s (int reason);
+bool parse_pgn_game (const char **text, const char *end, PgnGame *game);
+Game* start_pgn_game (const PgnGame *pgn);
+bool play_san (Game *g, const SanMove *m);
+void validate_pgn_files (Validation *validation, int threads);
+
+#endif
@@ -0,0 +1,226 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+#include "eval.h"
+
+// Values in centipawns of the pieces indexed by nibble type (1 pawn ... 6
+// king, see PIECES), in the middlegame and in the endgame.
+static const int MG_VALUES[7] = { 0, 100, 320, 330, 500, 900, 0 };
+static const int EG_VALUES[7] = { 0, 120, 300, 320, 540, 950, 0 };
+
+// Contribution of the pieces to the game phase.
+static const int PHASES[7] = { 0, 0, 1, 1, 2, 4, 0 };
+
+// Piece-square tables from the white point of view, indexed by square (a1 is
+// the first entry). Black pieces use the square mirrored vertically.
+static const int MG_PST[7][64] =
+{
+  { 0 },
+  { // Pawn
+      0,   0,   0,   0,   0,   0,   0,   0,
+      5,  10,  10, -20, -20,  10,  10,   5,
+      5,  -5, -10,   0,   0, -10,  -5,   5,
+      0,   0,   0,  20,  20,   0,   0,   0,
+      5,   5,  10,  25,  25,  10,   5,   5,
+     10,  10,  20,  30,  30,  20,  10,  10,
+     50,  50,  50,  50,  50,  50,  50,  50,
+      0,   0,   0,   0,   0,   0,   0,   0
+  },
+  { // Knight
+    -50, -40, -30, -30, -30, -30, -40, -50,
+    -40, -20,   0,   5,   5,   0, -20, -40,
+    -30,   5,  10,  15,  15,  10,   5, -30,
+    -30,   0,  15,  20,  20,  15,   0, -30,
+    -30,   5,  15,  20,  20,  15,   5, -30,
+    -30,   0,  10,  15,  15,  10,   0, -30,
+    -40, -20,   0,   0,   0,   0, -20, -40,
+    -50, -40, -30, -30, -30, -30, -40, -50
+  },
+  { // Bishop
+    -20, -10, -10, -10, -10, -10, -10, -20,
+    -10,   5,   0,   0,   0,   0,   5, -10,
+    -10,  10,  10,  10,  10,  10,  10, -10,
+    -10,   0,  10,  10,  10,  10,   0, -10,
+    -10,   5,   5,  10,  10,   5,   5, -10,
+    -10,   0,   5,  10,  10,   5,   0, -10,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -20, -10, -10, -10, -10, -10, -10, -20
+  },
+  { // Rook
+      0,   0,   0,   5,   5,   0,   0,   0,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+      5,  10,  10,  10,  10,  10,  10,   5,
+      0,   0,   0,   0,   0,   0,   0,   0
+  },
+  { // Queen
+    -20, -10, -10,  -5,  -5, -10, -10, -20,
+    -10,   0,   5,   0,   0,   0,   0, -10,
+    -10,   5,   5,   5,   5,   5,   0, -10,
+      0,   0,   5,   5,   5,   5,   0,  -5,
+     -5,   0,   5,   5,   5,   5,   0,  -5,
+    -10,   0,   5,   5,   5,   5,   0, -10,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -20, -10, -10,  -5,  -5, -10, -10, -20
+  },
+  { // King: stay castled
+     20,  30,  10,   0,   0,  10,  30,  20,
+     20,  20,   0,   0,   0,   0,  20,  20,
+    -10, -20, -20, -20, -20, -20, -20, -10,
+    -20, -30, -30, -40, -40, -30, -30, -20,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30
+  }
+};
+
+// In the endgame pawns are worth more the more they are advanced, rooks want
+// the seventh rank and the king goes to the center.
+static const int EG_PST[7][64] =
+{
+  { 0 },
+  { // Pawn
+      0,   0,   0,   0,   0,   0,   0,   0,
+      5,   5,   5,   5,   5,   5,   5,   5,
+     10,  10,  10,  10,  10,  10,  10,  10,
+     20,  20,  20,  20,  20,  20,  20,  20,
+     35,  35,  35,  35,  35,  35,  35,  35,
+     60,  60,  60,  60,  60,  60,  60,  60,
+    100, 100, 100, 100, 100, 100, 100, 100,
+      0,   0,   0,   0,   0,   0,   0,   0
+  },
+  { // Knight
+    -50, -40, -30, -30, -30, -30, -40, -50,
+    -40, -20,   0,   5,   5,   0, -20, -40,
+    -30,   5,  10,  15,  15,  10,   5, -30,
+    -30,   0,  15,  20,  20,  15,   0, -30,
+    -30,   5,  15,  20,  20,  15,   5, -30,
+    -30,   0,  10,  15,  15,  10,   0, -30,
+    -40, -20,   0,   0,   0,   0, -20, -40,
+    -50, -40, -30, -30, -30, -30, -40, -50
+  },
+  { // Bishop
+    -20, -10, -10, -10, -10, -10, -10, -20,
+    -10,   5,   0,   0,   0,   0,   5, -10,
+    -10,  10,  10,  10,  10,  10,  10, -10,
+    -10,   0,  10,  10,  10,  10,   0, -10,
+    -10,   5,   5,  10,  10,   5,   5, -10,
+    -10,   0,   5,  10,  10,   5,   0, -10,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -20, -10, -10, -10, -10, -10, -10, -20
+  },
+  { // Rook
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+     10,  10,  10,  10,  10,  10,  10,  10,
+      0,   0,   0,   0,   0,   0,   0,   0
+  },
+  { // Queen
+    -20, -10, -10,  -5,  -5, -10, -10, -20,
+    -10,   0,   5,   0,   0,   0,   0, -10,
+    -10,   5,   5,   5,   5,   5,   0, -10,
+      0,   0,   5,   5,   5,   5,   0,  -5,
+     -5,   0,   5,   5,   5,   5,   0,  -5,
+    -10,   0,   5,   5,   5,   5,   0, -10,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -20, -10, -10,  -5,  -5, -10, -10, -20
+  },
+  { // King
+    -50, -30, -30, -30, -30, -30, -30, -50,
+    -30, -30,   0,   0,   0,   0, -30, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -20, -10,   0,   0, -10, -20, -30,
+    -50, -40, -30, -20, -20, -30, -40, -50
+  }
+};
+
+// Adds to the middlegame and endgame scores and to the phase of the board the
+// contribution of the piece on the square. Boards keep the scores updated
+// while moving, so that the evaluation does not need to scan the squares.
+void
+add_piece_score (Board *board, char piece, int square)
+{
+  int nibble = piece_to_nibble (piece);
+  int type = nibble & 7;
+  if (!type)
+    return;
+  if (nibble & 8)
+    {
+      square ^= 56;
+      board->mg_score -= MG_VALUES[type] + MG_PST[type][square];
+      board->eg_score -= EG_VALUES[type] + EG_PST[type][square];
+    }
+  else
+    {
+      board->mg_score += MG_VALUES[type] + MG_PST[type][square];
+      board->eg_score += EG_VALUES[type] + EG_PST[type][square];
+    }
+  board->phase += PHASES[type];
+}
+
+// Removes the contribution of the piece on the square.
+void
+remove_piece_score (Board *board, char piece, int square)
+{
+  int nibble = piece_to_nibble (piece);
+  int type = nibble & 7;
+  if (!type)
+    return;
+  if (nibble & 8)
+    {
+      square ^= 56;
+      board->mg_score += MG_VALUES[type] + MG_PST[type][square];
+      board->eg_score += EG_VALUES[type] + EG_PST[type][square];
+    }
+  else
+    {
+      board->mg_score -= MG_VALUES[type] + MG_PST[type][square];
+      board->eg_score -= EG_VALUES[type] + EG_PST[type][square];
+    }
+  board->phase -= PHASES[type];
+}
+
+// Updates the scores for the piece moved from a square to another.
+void
+move_piece_score (Board *board, char piece, int from, int to)
+{
+  remove_piece_score (board, piece, from);
+  add_piece_score (board, piece, to);
+}
+
+// Computes the scores from scratch, for boards not obtained by a move.
+void
+set_scores (Board *board)
+{
+  board->mg_score = 0;
+  board->eg_score = 0;
+  board->phase = 0;
+  for (int square = 0; square < 64; square++)
+    add_piece_score (board, board->placement[square], square);
+}
+
+// Returns the static evaluation in centipawns of the position from the point
+// of view of the active color: material plus piece-square bonuses, tapered
+// between the middlegame and the endgame scores by the game phase.
+int
+evaluate (Board *board)
+{
+  int phase = board->phase < MAX_PHASE ? board->phase : MAX_PHASE;
+  int score = (board->mg_score * phase + board->eg_score * (MAX_PHASE - phase)) / MAX_PHASE;
+  return board->active_color == WHITE ? score : -score;
+}
@@ -0,0 +1,24 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "common.h"
+#include "board.h"
+
+// Game phase of the starting position: knights and bishops count 1, rooks 2
+// and queens 4.
+#define MAX_PHASE 24
+
+void add_piece_score (Board *board, char piece, int square);
+void remove_piece_score (Board *board, char piece, int square);
+void move_piece_score (Board *board, char piece, int from, int to);
+void set_scores (Board *board);
+int evaluate (Board *board);
+
+#endif
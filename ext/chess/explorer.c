@@ -0,0 +1,478 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+// Threads are POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include "explorer.h"
+
+// Binary games of a batch and bytes of a PGN chunk taken by a thread at a time.
+#define GAME_BATCH 256
+#define PGN_CHUNK (64 << 10)
+
+// The entries collected by a thread.
+typedef struct
+{
+  ExplorerEntry *items;
+  size_t count;
+  size_t capacity;
+  bool out_of_memory;
+} Entries;
+
+// The binary games from game, count of them starting at offset in the data,
+// or, if file is not negative, the text of a PGN file from start to end.
+typedef struct
+{
+  size_t game;
+  size_t count;
+  size_t offset;
+  long file;
+  const char *start;
+  const char *end;
+} Chunk;
+
+typedef struct
+{
+  Collection *collection;
+  pthread_mutex_t *lock;
+  pthread_t thread;
+} Worker;
+
+// Orders the entries by position and then by move.
+static int
+compare_entries (const void *a, const void *b)
+{
+  const ExplorerEntry *x = (const ExplorerEntry *) a;
+  const ExplorerEntry *y = (const ExplorerEntry *) b;
+  int c = memcmp (x->position, y->position, POSITION_SIZE);
+  if (c)
+    return c;
+  return (int) x->move - (int) y->move;
+}
+
+// Adds the move played in the position of the board by a game with the result.
+// A full list is aggregated first, and grows unless that frees more than half
+// of it.
+static void
+add_entry (Entries *list, Board *board, int move, int result)
+{
+  if (list->count == list->capacity)
+    {
+      list->count = aggregate_entries (list->items, list->count);
+      if (list->count >= list->capacity / 2)
+        {
+          size_t capacity = list->capacity ? list->capacity * 2 : 1024;
+          ExplorerEntry *items = (ExplorerEntry *) realloc (list->items, capacity * sizeof (ExplorerEntry));
+          if (!items)
+            {
+              list->out_of_memory = TRUE;
+              return;
+            }
+          list->items = items;
+          list->capacity = capacity;
+        }
+    }
+  ExplorerEntry *e = &list->items[list->count];
+  if (!pack_position (board, e->position))
+    return;
+  e->move = move;
+  e->white = result == WHITE_WON;
+  e->draws = result == DRAW;
+  e->black = result == BLACK_WON;
+  list->count++;
+}
+
+// Replays a game in the binary format of dump_game and adds an entry for each
+// move played in the first max_plies plies (all if max_plies is 0). Games
+// without a result are skipped. Returns false if the game is not valid.
+static bool
+collect_binary_game (Entries *list, const unsigned char *data, size_t size, int max_plies)
+{
+  Board board, new_board;
+  int result;
+  int moves[MAX_MOVES];
+  size_t k = load_game_header (data, size, &board, &result);
+  if (!k)
+    return FALSE;
+  if (result == IN_PROGRESS)
+    return TRUE;
+  for (int ply = 0; k < size && (!max_plies || ply < max_plies); k++, ply++)
+    {
+      k += data[k] == BINARY_DEFAULT_PROMOTION;
+      int legal = legal_moves (&board, moves);
+      if (k >= size || data[k] >= legal)
+        return FALSE;
+      int m = moves[data[k]];
+      add_entry (list, &board, m, result);
+      make_move (&board, MOVE_FROM (m), MOVE_TO (m), promotion_to_char (MOVE_PROMOTION (m)), &new_board, NULL);
+      board = new_board;
+    }
+  return TRUE;
+}
+
+// Replays a PGN game and adds its entries as collect_binary_game does. A game
+// that does not end on the board takes the result of the PGN. Returns COLLECTED
+// or the reason of the failure, and stores in failed the failing token (NULL
+// if there is none).
+static int
+collect_pgn_game (Entries *list, const PgnGame *pgn, int max_plies, const SanMove **failed)
+{
+  *failed = NULL;
+  Game *g = start_pgn_game (pgn);
+  if (!g)
+    return INVALID_PGN;
+  for (int i = 0; i < pgn->size; i++)
+    if (!play_san (g, &pgn->moves[i]))
+      {
+        *failed = &pgn->moves[i];
+        free_game (g);
+        return ILLEGAL_MOVE;
+      }
+  int result = g->result;
+  if (result == IN_PROGRESS)
+    result = !strcmp (pgn->result, "1-0") ? WHITE_WON : !strcmp (pgn->result, "0-1") ? BLACK_WON
+      : !strcmp (pgn->result, "1/2-1/2") ? DRAW : IN_PROGRESS;
+  // The first ply of a game set by FEN is the position
+  int start = g->current > 0 && !strcmp (g->coord_moves[0], "SET BY FEN");
+  for (int i = start; result != IN_PROGRESS && i < g->current && (!max_plies || i - start < max_plies); i++)
+    {
+      const char *coord = g->coord_moves[i];
+      int from = coord_to_square (coord);
+      int to = coord_to_square (coord + 2);
+      Board *board = get_board (g, i - 1);
+      // The queen of a promotion without piece, as in dump_game
+      int promotion = coord[4] == '=' ? char_to_promotion (coord[5]) : 0;
+      if (!promotion && toupper (board->placement[from]) == 'P' && (to < A2 || to > H7))
+        promotion = char_to_promotion ('Q');
+      add_entry (list, board, MOVE (from, to, promotion), result);
+    }
+  free_game (g);
+  return COLLECTED;
+}
+
+// Returns the start of the first game after the line of p: a line beginning
+// with a tag pair after an empty one, as the games of a PGN file are
+// separated. Returns end if there is none.
+static const char*
+next_pgn_game (const char *p, const char *end)
+{
+  bool empty = FALSE;
+  while ((p = (const char *) memchr (p, '\n', end - p)) && ++p < end)
+    {
+      if (empty && *p == '[')
+        return p;
+      empty = TRUE;
+      for (const char *q = p; q < end && *q != '\n' && empty; q++)
+        empty = isspace ((unsigned char) *q);
+    }
+  return end;
+}
+
+// Takes the next chunk of the collection. Must hold the lock. Returns false if
+// there is nothing left.
+static bool
+next_chunk (Collection *c, Chunk *chunk)
+{
+  if (c->next_game < c->size)
+    {
+      chunk->file = -1;
+      chunk->game = c->next_game;
+      chunk->offset = c->next_data;
+      chunk->count = c->size - c->next_game < GAME_BATCH ? c->size - c->next_game : GAME_BATCH;
+      for (size_t i = 0; i < chunk->count; i++)
+        c->next_data += c->sizes[c->next_game++];
+      return TRUE;
+    }
+  for (; c->next_file < c->path_count; c->next_file++, c->next_byte = 0)
+    if (c->next_byte < c->map_sizes[c->next_file])
+      {
+        const char *map = c->maps[c->next_file];
+        const char *end = map + c->map_sizes[c->next_file];
+        chunk->file = c->next_file;
+        chunk->start = map + c->next_byte;
+        chunk->end = end - chunk->start > PGN_CHUNK ? next_pgn_game (chunk->start + PGN_CHUNK, end) : end;
+        c->next_byte = chunk->end - map;
+        return TRUE;
+      }
+  return FALSE;
+}
+
+// Stores the failure if it is the first one. Must hold the lock.
+static void
+fail (Collection *c, int reason, long index, const char *at, int length)
+{
+  if (c->error != COLLECTED)
+    return;
+  c->error = reason;
+  c->index = index;
+  c->line = 0;
+  if (at)
+    {
+      c->line = 1;
+      for (const char *p = c->maps[index]; (p = (const char *) memchr (p, '\n', at - p)); p++)
+        c->line++;
+    }
+  length = length < FAILURE_MOVE_SIZE ? length : FAILURE_MOVE_SIZE - 1;
+  memcpy (c->move, at ? at : "", length);
+  c->move[length] = '\0';
+  c->stop = 1;
+}
+
+// Collects the entries of the chunk. Returns false on failure.
+static bool
+collect_chunk (Worker *worker, const Chunk *chunk, Entries *list, PgnGame *pgn)
+{
+  Collection *c = worker->collection;
+  if (chunk->file < 0)
+    {
+      const unsigned char *data = c->data + chunk->offset;
+      for (size_t i = chunk->game; i < chunk->game + chunk->count; data += c->sizes[i], i++)
+        if (!collect_binary_game (list, data, c->sizes[i], c->max_plies))
+          {
+            pthread_mutex_lock (worker->lock);
+            fail (c, INVALID_BINARY_GAME, i, NULL, 0);
+            pthread_mutex_unlock (worker->lock);
+            return FALSE;
+          }
+      return TRUE;
+    }
+  const char *p = chunk->start;
+  for (;;)
+    {
+      while (p < chunk->end && isspace ((unsigned char) *p))
+        p++;
+      const char *game = p;
+      if (!parse_pgn_game (&p, chunk->end, pgn))
+        return TRUE;
+      const SanMove *failed;
+      int reason = collect_pgn_game (list, pgn, c->max_plies, &failed);
+      if (reason != COLLECTED)
+        {
+          pthread_mutex_lock (worker->lock);
+          if (failed)
+            fail (c, reason, chunk->file, failed->text, failed->length);
+          else if (pgn->invalid)
+            fail (c, reason, chunk->file, pgn->invalid, pgn->invalid_length);
+          else
+            fail (c, reason, chunk->file, game, 0);
+          pthread_mutex_unlock (worker->lock);
+          return FALSE;
+        }
+    }
+}
+
+// Appends the entries of a thread to the collection. Must hold the lock.
+static void
+merge_entries (Collection *c, Entries *list)
+{
+  c->out_of_memory |= list->out_of_memory;
+  list->count = aggregate_entries (list->items, list->count);
+  ExplorerEntry *entries = (ExplorerEntry *) realloc (c->entries, (c->count + list->count) * sizeof (ExplorerEntry));
+  if (!entries && c->count + list->count > 0)
+    {
+      c->out_of_memory = TRUE;
+      return;
+    }
+  c->entries = entries;
+  memcpy (c->entries + c->count, list->items, list->count * sizeof (ExplorerEntry));
+  c->count += list->count;
+}
+
+static void*
+collect_worker (void *data)
+{
+  Worker *worker = (Worker *) data;
+  Collection *c = worker->collection;
+  Entries list = { NULL, 0, 0, FALSE };
+  PgnGame *pgn = (PgnGame *) malloc (sizeof (PgnGame));
+  list.out_of_memory = !pgn;
+  Chunk chunk;
+  for (;;)
+    {
+      pthread_mutex_lock (worker->lock);
+      if (list.out_of_memory)
+        c->stop = 1;
+      bool next = !c->stop && next_chunk (c, &chunk);
+      c->done |= !c->stop && !next;
+      pthread_mutex_unlock (worker->lock);
+      if (!next || !collect_chunk (worker, &chunk, &list, pgn))
+        break;
+    }
+  pthread_mutex_lock (worker->lock);
+  merge_entries (c, &list);
+  pthread_mutex_unlock (worker->lock);
+  free (list.items);
+  free (pgn);
+  return NULL;
+}
+
+// Maps the PGN files of the collection. Returns false if a file can not be
+// read, the failure is stored in the collection with errno.
+bool
+map_pgn_files (Collection *c)
+{
+  c->maps = (const char **) calloc (c->path_count > 0 ? c->path_count : 1, sizeof (char *));
+  c->map_sizes = (size_t *) calloc (c->path_count > 0 ? c->path_count : 1, sizeof (size_t));
+  if (!c->maps || !c->map_sizes)
+    {
+      c->out_of_memory = TRUE;
+      return FALSE;
+    }
+  for (long i = 0; i < c->path_count; i++)
+    {
+      c->maps[i] = (const char *) map_file (c->paths[i], &c->map_sizes[i]);
+      if (!c->maps[i] && errno)
+        {
+          c->error_number = errno;
+          fail (c, UNREADABLE_FILE, i, NULL, 0);
+          return FALSE;
+        }
+      // An empty file
+      if (!c->maps[i])
+        c->map_sizes[i] = 0;
+    }
+  return TRUE;
+}
+
+// Replays the games of the collection from its cursors with the given number
+// of threads, the calling thread included, and stores their entries sorted and
+// aggregated. The chunks being collected when the collection is stopped are
+// completed. On failure the other threads stop at their next chunk.
+void
+collect_entries (Collection *c, int threads)
+{
+  pthread_mutex_t lock;
+  pthread_mutex_init (&lock, NULL);
+  Worker *workers = (Worker *) malloc ((threads > 1 ? threads : 1) * sizeof (Worker));
+  if (!workers)
+    {
+      c->out_of_memory = TRUE;
+      pthread_mutex_destroy (&lock);
+      return;
+    }
+  int started = 0;
+  for (int i = 0; i < (threads > 1 ? threads : 1); i++)
+    {
+      workers[i].collection = c;
+      workers[i].lock = &lock;
+    }
+  for (; started < threads - 1; started++)
+    if (pthread_create (&workers[started + 1].thread, NULL, collect_worker, workers + started + 1))
+      break;
+  collect_worker (workers);
+  for (int i = 0; i < started; i++)
+    pthread_join (workers[i + 1].thread, NULL);
+  free (workers);
+  pthread_mutex_destroy (&lock);
+  if (c->done)
+    c->count = aggregate_entries (c->entries, c->count);
+}
+
+// Unmaps the PGN files and frees the entries of the collection.
+void
+close_collection (Collection *c)
+{
+  for (long i = 0; c->maps && i < c->path_count; i++)
+    unmap_file ((void *) c->maps[i], c->map_sizes[i]);
+  free (c->maps);
+  free (c->map_sizes);
+  free (c->entries);
+  c->maps = NULL;
+  c->map_sizes = NULL;
+  c->entries = NULL;
+}
+
+// Sorts the entries and merges the ones with the same position and move
+// summing their results. Returns the new number of entries.
+size_t
+aggregate_entries (ExplorerEntry *entries, size_t count)
+{
+  if (count == 0)
+    return 0;
+  qsort (entries, count, sizeof (ExplorerEntry), compare_entries);
+  size_t n = 0;
+  for (size_t i = 1; i < count; i++)
+    if (compare_entries (&entries[n], &entries[i]))
+      entries[++n] = entries[i];
+    else
+      {
+        entries[n].white += entries[i].white;
+        entries[n].draws += entries[i].draws;
+        entries[n].black += entries[i].black;
+      }
+  return n + 1;
+}
+
+// Writes the explorer file. Entries must be sorted and aggregated. Returns
+// false on I/O errors.
+bool
+write_explorer (const char *path, const ExplorerEntry *entries, size_t count)
+{
+  FILE *file = fopen (path, "wb");
+  if (!file)
+    return FALSE;
+  ExplorerHeader header = { EXPLORER_MAGIC, EXPLORER_VERSION, sizeof (ExplorerEntry), count };
+  bool ok = fwrite (&header, sizeof (header), 1, file) == 1
+    && fwrite (entries, sizeof (ExplorerEntry), count, file) == count;
+  return fclose (file) == 0 && ok;
+}
+
+// Maps the explorer file in memory. Returns false if the file can not be read
+// or is not an explorer file (errno is 0 in this case).
+bool
+open_explorer (Explorer *explorer, const char *path)
+{
+  explorer->map = map_file (path, &explorer->map_size);
+  if (!explorer->map)
+    return FALSE;
+  const ExplorerHeader *header = (const ExplorerHeader *) explorer->map;
+  if (explorer->map_size < sizeof (ExplorerHeader)
+      || memcmp (header->magic, EXPLORER_MAGIC, 8)
+      || header->version != EXPLORER_VERSION
+      || header->entry_size != sizeof (ExplorerEntry)
+      || header->count > (explorer->map_size - sizeof (ExplorerHeader)) / sizeof (ExplorerEntry)
+      || explorer->map_size - sizeof (ExplorerHeader) != header->count * sizeof (ExplorerEntry))
+    {
+      close_explorer (explorer);
+      errno = 0;
+      return FALSE;
+    }
+  explorer->entries = (const ExplorerEntry *) (header + 1);
+  explorer->count = header->count;
+  return TRUE;
+}
+
+// Unmaps the explorer file.
+void
+close_explorer (Explorer *explorer)
+{
+  unmap_file (explorer->map, explorer->map_size);
+  explorer->map = NULL;
+  explorer->count = 0;
+}
+
+// Stores in first the entries of the position and returns their number.
+size_t
+explore (const Explorer *explorer, const unsigned char *position, const ExplorerEntry **first)
+{
+  size_t low = 0, high = explorer->count;
+  while (low < high)
+    {
+      size_t mid = low + (high - low) / 2;
+      if (memcmp (explorer->entries[mid].position, position, POSITION_SIZE) < 0)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+  size_t n = 0;
+  while (low + n < explorer->count && !memcmp (explorer->entries[low + n].position, position, POSITION_SIZE))
+    n++;
+  *first = explorer->entries + low;
+  return n;
+}
@@ -0,0 +1,94 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+#ifndef EXPLORER_H
+#define EXPLORER_H
+
+#define EXPLORER_MAGIC "CHESSEXP"
+#define EXPLORER_VERSION 1
+
+#include <stdint.h>
+#include "common.h"
+#include "board.h"
+#include "game.h"
+#include "database.h"
+
+// Reasons of a collection failure, with the UNREADABLE_FILE, INVALID_PGN and
+// ILLEGAL_MOVE ones of a validation.
+#define COLLECTED -1
+#define INVALID_BINARY_GAME 14
+
+// A move played in a position with the results of the games. The explorer file
+// is a header followed by the entries sorted by position and move.
+typedef struct
+{
+  unsigned char position[POSITION_SIZE];
+  uint16_t move;
+  uint32_t white;
+  uint32_t draws;
+  uint32_t black;
+} ExplorerEntry;
+
+typedef struct
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t entry_size;
+  uint64_t count;
+} ExplorerHeader;
+
+// An explorer file mapped in memory.
+typedef struct
+{
+  void *map;
+  size_t map_size;
+  const ExplorerEntry *entries;
+  size_t count;
+} Explorer;
+
+// The collection of the entries of the games to index: n binary games in the
+// format of dump_game stored one after the other in data, and PGN files. The
+// binary games are taken in batches and the PGN files in chunks, split where a
+// game starts, from shared cursors; a stopped collection can be resumed
+// calling collect_entries again. On failure index is the binary game or the
+// PGN file, line the line of the PGN file and move the failing token.
+typedef struct
+{
+  const unsigned char *data;
+  const size_t *sizes;
+  size_t size;
+  const char **paths;
+  long path_count;
+  int max_plies;
+  const char **maps;
+  size_t *map_sizes;
+  size_t next_game;
+  size_t next_data;
+  long next_file;
+  size_t next_byte;
+  ExplorerEntry *entries;
+  size_t count;
+  bool done;
+  int error;
+  int error_number;
+  long index;
+  long line;
+  char move[FAILURE_MOVE_SIZE];
+  bool out_of_memory;
+  volatile int stop;
+} Collection;
+
+bool map_pgn_files (Collection *collection);
+void collect_entries (Collection *collection, int threads);
+void close_collection (Collection *collection);
+size_t aggregate_entries (ExplorerEntry *entries, size_t count);
+bool write_explorer (const char *path, const ExplorerEntry *entries, size_t count);
+bool open_explorer (Explorer *explorer, const char *path);
+void close_explorer (Explorer *explorer);
+size_t explore (const Explorer *explorer, const unsigned char *position, const ExplorerEntry **first);
+
+#endif
@@ -2,7 +2,67 @@
 # https://guides.rubygems.org/gems-with-extensions/
 
 require 'mkmf'
+require 'fileutils'
+require 'rbconfig'
+require 'tmpdir'
 
-$CFLAGS += ' -std=c99'
+$CFLAGS += ' -std=c99 -fno-semantic-interposition'
+# Counters of Chess.stats: ruby extconf.rb --enable-stats
+$defs << '-DCHESS_STATS' if enable_config('stats', false)
+# Programs built by MakefileC, and the generator of tables.h (see depend), not
+# part of the extension
+$srcs = Dir[File.join(__dir__, '*.c')].map { |f| File.basename(f) } - %w[gen_tables.c uci.c valgrind.c]
+$cleanfiles.push('tables.h', 'gen_tables')
+
+# Optimized builds, selected at install time with the CHESS_BUILD environment
+# variable:
+#
+#   CHESS_BUILD=lto gem install chess   # link time optimization
+#   CHESS_BUILD=pgo gem install chess   # LTO and profile-guided optimization
+#
+# The pgo build compiles the extension instrumented, runs pgo_training.rb
+# (the games of test/pgn_collection and perft) and compiles it again with the
+# profile, so it needs GCC and the test collection of the source tree. `rake
+# bench:pgo` compares it with the default build.
+build = ENV.fetch('CHESS_BUILD', 'default')
+abort "CHESS_BUILD must be default, lto or pgo, not #{build}" unless %w[default lto pgo].include?(build)
+collection = File.expand_path('../../test/pgn_collection', __dir__)
+if build == 'pgo' && !File.directory?(collection)
+  warn "#{collection} not found, building with lto and no profile"
+  build = 'lto'
+end
+if build == 'pgo' && !try_compile("#if !defined(__GNUC__) || defined(__clang__)\n#error\n#endif\nint main(void) { return 0; }")
+  warn 'The pgo build needs GCC, building with lto and no profile'
+  build = 'lto'
+end
+if build != 'default'
+  $CFLAGS += ' -flto=auto'
+  $LDFLAGS += ' -flto=auto'
+end
+
+if build == 'pgo'
+  profile = File.expand_path('pgo-profile')
+  FileUtils.rm_rf(profile)
+  base_cflags = $CFLAGS
+  base_ldflags = $LDFLAGS
+  # The training replays the games on a single thread, atomic counters keep
+  # the profile right if the workload ever uses more.
+  $CFLAGS = "#{base_cflags} -fprofile-generate=#{profile} -fprofile-update=atomic"
+  $LDFLAGS = "#{base_ldflags} -fprofile-generate=#{profile}"
+  create_makefile('chess/chess')
+  make = ENV.fetch('MAKE', 'make')
+  abort 'Instrumented build failed' unless system(make)
+  Dir.mktmpdir do |dir|
+    FileUtils.mkdir_p(File.join(dir, 'chess'))
+    FileUtils.cp("chess.#{RbConfig::CONFIG['DLEXT']}", File.join(dir, 'chess'))
+    training = [RbConfig.ruby, "-I#{dir}", "-I#{File.expand_path('../../lib', __dir__)}",
+                File.join(__dir__, 'pgo_training.rb'), collection]
+    abort 'Training of the instrumented build failed' unless system(*training)
+  end
+  abort 'Cleaning of the instrumented build failed' unless system(make, 'clean')
+  # Functions the training never runs are optimized as usual.
+  $CFLAGS = "#{base_cflags} -fprofile-use=#{profile} -fprofile-correction -fprofile-partial-training -Wno-missing-profile"
+  $LDFLAGS = "#{base_ldflags} -fprofile-use=#{profile}"
+end
 
 create_makefile('chess/chess')
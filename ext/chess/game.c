@@ -5,17 +5,15 @@
  * This code is under LICENSE LGPLv3
  */
 
-#include "game.h"
+// strtok_r is POSIX
+#define _POSIX_C_SOURCE 200809L
 
-static Board STARTING_BOARD;
+#include "game.h"
 
-// Initialize the library.
-void
-init_chess_library ()
-{
-  init_board (&STARTING_BOARD);
-  precalculate_all_xray ();
-}
+static void free_variations (Variations *list);
+static void prune_variations (Game *g);
+static void push_variation (Variations *list, Variation *v);
+static Variation* copy_variation (const Variation *v, Variation *parent);
 
 // Initialize the Game struct.
 Game*
@@ -24,29 +22,86 @@ init_game ()
   Game *g = NEW_GAME;
   g->current = 0;
   g->result = IN_PROGRESS;
+  g->history = NULL;
+  g->shared = 0;
+  g->variations.items = NULL;
+  g->variations.count = 0;
   return g;
 }
 
+// Drop a reference to a history, freeing its plies and its parent if it was
+// the last one. Copies of a game can be freed by different threads.
+static void
+release_history (History *h)
+{
+  while (h && __atomic_sub_fetch (&h->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+      History *parent = h->parent;
+      for (int i = 0; i < 3 * h->size; i++)
+        free (h->plies[i]);
+      free (h);
+      h = parent;
+    }
+}
+
 // Free memory of a game.
 void
 free_game (Game *g)
 {
-  for (int i = 0; i < g->current; i++)
+  for (int i = g->shared; i < g->current; i++)
     {
       free (g->boards[i]);
       free (g->moves[i]);
       free (g->coord_moves[i]);
     }
+  release_history (g->history);
+  free_variations (&g->variations);
   free (g);
 }
 
+// Returns a copy of the game that shares its plies. The plies owned by the
+// game move to a new history shared by both, so no board or move is copied.
+// The variations are copied.
+Game*
+copy_game (Game *g)
+{
+  if (g->current > g->shared)
+    {
+      int size = g->current - g->shared;
+      History *h = (History *) STATS_MALLOC (sizeof (History) + 3 * size * sizeof (void *));
+      h->parent = g->history;
+      h->refs = 1;
+      h->size = size;
+      memcpy (h->plies, g->boards + g->shared, size * sizeof (void *));
+      memcpy (h->plies + size, g->moves + g->shared, size * sizeof (void *));
+      memcpy (h->plies + 2 * size, g->coord_moves + g->shared, size * sizeof (void *));
+      g->history = h;
+      g->shared = g->current;
+    }
+  Game *copy = NEW_GAME;
+  memcpy (copy->boards, g->boards, g->current * sizeof (Board *));
+  memcpy (copy->moves, g->moves, g->current * sizeof (char *));
+  memcpy (copy->coord_moves, g->coord_moves, g->current * sizeof (char *));
+  copy->current = g->current;
+  copy->result = g->result;
+  copy->history = g->history;
+  copy->shared = g->shared;
+  if (copy->history)
+    __atomic_add_fetch (&copy->history->refs, 1, __ATOMIC_RELAXED);
+  copy->variations.items = NULL;
+  copy->variations.count = 0;
+  for (int i = 0; i < g->variations.count; i++)
+    push_variation (&copy->variations, copy_variation (g->variations.items[i], NULL));
+  return copy;
+}
+
 // Returns the last board of the game.
 Board*
 current_board (Game *g)
 {
   if (g->current > 0)
     return g->boards[g->current-1];
-  return &STARTING_BOARD;
+  return (Board *) &STARTING_BOARD;
 }
 
 // Returns the board at i-th position. If i is negative returns the starting
@@ -55,7 +110,7 @@ Board*
 get_board (Game *g, int index)
 {
   if (index < 0)
-    return &STARTING_BOARD;
+    return (Board *) &STARTING_BOARD;
   if (index < g->current)
     return g->boards[index];
   return NULL;
@@ -79,56 +134,54 @@ current_coord_move (Game *g)
   return 0;
 }
 
-// Returns true if the move from-to is legal. Add the new board on the game.
+// Returns true if the move from-to is legal on board. Sets the new board, the
+// move done with its check or checkmate suffix and, if the move ends the
+// game, the result.
 bool
-apply_move (Game *g, int from, int to, char promote_in)
+play_move (Board *board, int from, int to, char promote_in, Board **new_board, char **move_done, unsigned short *result)
 {
-  if (g->current >= BUFFER_SIZE) return FALSE;
-  if (g->result != IN_PROGRESS && g->result != DRAW) return FALSE;
-  Board *board = current_board (g);
-  if (promote_in && invalid_promotion (board, from, to)) return FALSE;
-  Board *new_board = NEW_BOARD;
-  char capture = 0;
-  char *move_done = castling (board, castling_type (board, from, to), new_board);
-  if (!move_done) // If move is not a castling
+  Board *b = NEW_BOARD;
+  if (!make_move (board, from, to, promote_in, b, move_done))
     {
-      if (!try_move (board, from, to, promote_in, new_board, &move_done, &capture))
-        {
-          free (new_board);
-          return FALSE;
-        }
+      free (b);
+      return FALSE;
     }
-  // Ok move is legal, update the game
-  update_castling (new_board, from, to);
-  update_en_passant (new_board, from, to);
-  if (new_board->active_color)
-    new_board->fullmove_number++;
-  new_board->active_color = !new_board->active_color;
-  if (capture || toupper (board->placement[from]) == 'P')
-    new_board->halfmove_clock = 0;
-  else
-    new_board->halfmove_clock++;
-  g->boards[g->current] = new_board;
-  g->moves[g->current] = move_done;
-  g->coord_moves[g->current] = ft_to_coord_move (from, to, promote_in);
-  g->current++;
   // Test check or checkmate of opponent king
-  if (king_in_check (new_board, new_board->active_color))
+  if (king_in_check (b, b->active_color))
     {
-      if (king_in_checkmate (new_board, new_board->active_color))
+      if (king_in_checkmate (b, b->active_color))
         {
-          strcat (move_done, "#");
-          g->result = !new_board->active_color;
+          strcat (*move_done, "#");
+          *result = !b->active_color;
         }
       else
-        strcat (move_done, "+");
+        strcat (*move_done, "+");
     }
   // Set game result to DRAW if insufficient material
-  else if (insufficient_material (new_board))
-    g->result = DRAW;
+  else if (insufficient_material (b))
+    *result = DRAW;
   // Test stalemate
-  else if (stalemate (new_board, new_board->active_color))
-    g->result = DRAW;
+  else if (stalemate (b, b->active_color))
+    *result = DRAW;
+  *new_board = b;
+  return TRUE;
+}
+
+// Returns true if the move from-to is legal. Add the new board on the game.
+bool
+apply_move (Game *g, int from, int to, char promote_in)
+{
+  if (g->current >= BUFFER_SIZE) return FALSE;
+  if (g->result != IN_PROGRESS && g->result != DRAW) return FALSE;
+  Board *new_board;
+  char *move_done;
+  if (!play_move (current_board (g), from, to, promote_in, &new_board, &move_done, &g->result))
+    return FALSE;
+  // Ok move is legal, update the game
+  g->boards[g->current] = new_board;
+  g->moves[g->current] = move_done;
+  g->coord_moves[g->current] = ft_to_coord_move (from, to, promote_in);
+  g->current++;
   return TRUE;
 }
 
@@ -140,6 +193,13 @@ rollback (Game *g)
     {
       g->result = IN_PROGRESS;
       g->current--;
+      prune_variations (g);
+      // A shared ply stays in its history
+      if (g->current < g->shared)
+        {
+          g->shared = g->current;
+          return;
+        }
       free (g->boards[g->current]);
       free (g->moves[g->current]);
       free (g->coord_moves[g->current]);
@@ -156,7 +216,7 @@ threefold_repetition (Game *g)
   char turn;
   char *fen, *castling, *ep;
   char* s[g->current + 1];
-  s[0] = (char *) malloc (104); // Max size: 71 placement + 1 space + 1 active + 1 space + 4 castling + 1 space + 2 ep + 1 space + 10 halfmove + 1 space + 10 fullmove + 1 NUL = 104.
+  s[0] = (char *) STATS_MALLOC (104); // Max size: 71 placement + 1 space + 1 active + 1 space + 4 castling + 1 space + 2 ep + 1 space + 10 halfmove + 1 space + 10 fullmove + 1 NUL = 104.
   strcpy (s[0], "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -");
   bool found = FALSE;
   int i, j;
@@ -166,7 +226,7 @@ threefold_repetition (Game *g)
       for (j = 0; fen[j] != ' '; j++)
         placement[j] = fen[j];
       placement[j] = '\0';
-      s[i+1] = (char *) malloc (104);
+      s[i+1] = (char *) STATS_MALLOC (104);
       turn = g->boards[i]->active_color ? 'b' : 'w';
       castling = castling_to_s (g->boards[i]->castling);
       ep = en_passant_to_s (g->boards[i]->en_passant);
@@ -190,6 +250,65 @@ threefold_repetition (Game *g)
   return found;
 }
 
+// Returns true if fen is a well formed FEN string (each rank of the placement
+// must describe 8 squares).
+bool
+valid_fen (const char *fen)
+{
+  const char *c = fen;
+  for (int rank = 0; rank < 8; rank++)
+    {
+      int files = 0;
+      for (; *c && *c != '/' && *c != ' '; c++)
+        {
+          if (*c >= '1' && *c <= '8')
+            files += *c - '0';
+          else if (strchr ("PRNBQKprnbqk", *c))
+            files++;
+          else
+            return FALSE;
+        }
+      if (files != 8 || (rank < 7 && *c++ != '/'))
+        return FALSE;
+    }
+  // Active color
+  if (*c++ != ' ' || (*c != 'w' && *c != 'b'))
+    return FALSE;
+  c++;
+  // Castling
+  if (*c++ != ' ')
+    return FALSE;
+  if (*c == '-')
+    c++;
+  else
+    {
+      const char *c0 = c;
+      for (const char *order = "KQkq"; *order; order++)
+        if (*c == *order)
+          c++;
+      if (c == c0)
+        return FALSE;
+    }
+  // En passant
+  if (*c++ != ' ')
+    return FALSE;
+  if (*c == '-')
+    c++;
+  else if (c[0] >= 'a' && c[0] <= 'h' && c[1] >= '1' && c[1] <= '8')
+    c += 2;
+  else
+    return FALSE;
+  // Halfmove clock and fullmove number
+  for (int i = 0; i < 2; i++)
+    {
+      if (*c++ != ' ' || !isdigit (*c))
+        return FALSE;
+      while (isdigit (*c))
+        c++;
+    }
+  return *c == '\0';
+}
+
 /*
  * Set the game position by FEN string.
  A FEN string is composed of 6 parts separated by " " (space).
@@ -204,9 +323,17 @@ void
 set_fen (Game *g, const char *fen)
 {
   Board *board = NEW_BOARD;
+  parse_fen (fen, board);
+  set_board (g, board);
+}
+
+// Sets the board to the position of the FEN string, see set_fen.
+void
+parse_fen (const char *fen, Board *board)
+{
   int i = 0, j, k, square;
-  char *pch;
-  char *s = (char *) malloc (sizeof (char) * (strlen (fen) + 1));
+  char *pch, *save;
+  char *s = (char *) STATS_MALLOC (sizeof (char) * (strlen (fen) + 1));
   strcpy (s, fen);
   // Init board
   memset (board->placement, '\0', 64);
@@ -222,7 +349,7 @@ set_fen (Game *g, const char *fen)
   board->queens[BLACK]  = 0x0;
   board->king[WHITE]    = 0x0;
   board->king[BLACK]    = 0x0;
-  pch = strtok (s, " /");
+  pch = strtok_r (s, " /", &save);
   while (pch != NULL)
     {
       if (i < 8)
@@ -328,18 +455,26 @@ set_fen (Game *g, const char *fen)
           board->fullmove_number = atoi (pch);
         }
       i++;
-      pch = strtok (NULL, " /");
+      pch = strtok_r (NULL, " /", &save);
     }
   set_occupied (board);
+  set_scores (board);
+  free (s);
+}
+
+// Appends the board to the game as a position set by FEN. The game takes the
+// ownership of the board.
+void
+set_board (Game *g, Board *board)
+{
   if (g->current >= BUFFER_SIZE)
     {
       free (board);
-      free (s);
       return;
     }
   g->boards[g->current] = board;
-  g->moves[g->current] = (char *) malloc (11);
-  g->coord_moves[g->current] = (char *) malloc (11);
+  g->moves[g->current] = (char *) STATS_MALLOC (11);
+  g->coord_moves[g->current] = (char *) STATS_MALLOC (11);
   strcpy (g->moves[g->current], "SET BY FEN");
   strcpy (g->coord_moves[g->current], "SET BY FEN");
   g->current++;
@@ -350,82 +485,452 @@ set_fen (Game *g, const char *fen)
   else
     if (stalemate (board, board->active_color) || insufficient_material (board))
       g->result = DRAW;
+}
 
-  free (s);
+
+// Returns the game serialized in a compact binary format and its size. The
+// format is a version byte, a flags byte (bit 0 set if the game starts from a
+// FEN, bits 1-2 the result), the starting FEN (a length byte followed by the
+// string) if any and one byte for each move: its index in the list of legal
+// moves of the position. A promotion done without specifying the piece is
+// prefixed by BINARY_DEFAULT_PROMOTION, so that its notation is kept. Returns
+// NULL if the game can not be serialized (a position set by FEN after the
+// first move).
+unsigned char*
+dump_game (Game *g, size_t *size)
+{
+  int start = g->current > 0 && strcmp (g->coord_moves[0], "SET BY FEN") == 0;
+  char *fen = start ? to_fen (g->boards[0]) : NULL;
+  size_t fen_size = fen ? strlen (fen) : 0;
+  unsigned char *data = (unsigned char *) STATS_MALLOC (3 + fen_size + 2 * g->current);
+  size_t n = 0;
+  data[n++] = BINARY_VERSION;
+  data[n++] = (fen ? 1 : 0) | g->result << 1;
+  if (fen)
+    {
+      data[n++] = fen_size;
+      memcpy (data + n, fen, fen_size);
+      n += fen_size;
+      free (fen);
+    }
+  int moves[MAX_MOVES];
+  for (int i = start; i < g->current; i++)
+    {
+      // A position set by FEN after the first move has no move to encode
+      const char *coord = g->coord_moves[i];
+      int from = coord_to_square (coord);
+      int to = coord_to_square (coord + 2);
+      if (strcmp (coord, "SET BY FEN") == 0 || from < 0 || from > 63 || to < 0 || to > 63)
+        {
+          free (data);
+          return NULL;
+        }
+      Board *board = get_board (g, i - 1);
+      int promotion = coord[4] == '=' ? char_to_promotion (coord[5]) : 0;
+      if (!promotion && toupper (board->placement[from]) == 'P' && (to < A2 || to > H7))
+        {
+          promotion = char_to_promotion ('Q');
+          data[n++] = BINARY_DEFAULT_PROMOTION;
+        }
+      int m = MOVE (from, to, promotion);
+      int count = legal_moves (board, moves);
+      int k = 0;
+      while (k < count && moves[k] != m)
+        k++;
+      if (k == count)
+        {
+          free (data);
+          return NULL;
+        }
+      data[n++] = k;
+    }
+  *size = n;
+  return data;
 }
 
+// Reads the header of a game in the binary format of dump_game: stores in
+// board the starting position and in result the result of the game. Returns
+// the offset of the first move, 0 if the header is not valid.
+size_t
+load_game_header (const unsigned char *data, size_t size, Board *board, int *result)
+{
+  if (size < 2 || data[0] != BINARY_VERSION)
+    return 0;
+  *result = (data[1] >> 1) & 3;
+  if (!(data[1] & 1))
+    {
+      init_board (board);
+      return 2;
+    }
+  if (size < 3 || size < 3 + (size_t) data[2])
+    return 0;
+  char fen[256];
+  memcpy (fen, data + 3, data[2]);
+  fen[data[2]] = '\0';
+  if (!valid_fen (fen))
+    return 0;
+  Game *g = init_game ();
+  set_fen (g, fen);
+  COPY_BOARD (board, current_board (g));
+  free_game (g);
+  return 3 + data[2];
+}
 
+// Returns the game deserialized from the binary format of dump_game. Returns
+// NULL if data is not valid.
+Game*
+load_game (const unsigned char *data, size_t size)
+{
+  Board board;
+  int result;
+  size_t n = load_game_header (data, size, &board, &result);
+  if (!n)
+    return NULL;
+  Game *g = init_game ();
+  if (data[1] & 1)
+    {
+      Board *first = NEW_BOARD;
+      COPY_BOARD (first, &board);
+      set_board (g, first);
+    }
+  int moves[MAX_MOVES];
+  for (; n < size; n++)
+    {
+      bool default_promotion = data[n] == BINARY_DEFAULT_PROMOTION;
+      n += default_promotion;
+      int count = legal_moves (current_board (g), moves);
+      int m = n < size && data[n] < count ? moves[data[n]] : 0;
+      char promote_in = default_promotion ? '\0' : promotion_to_char (MOVE_PROMOTION (m));
+      if (!m || !apply_move (g, MOVE_FROM (m), MOVE_TO (m), promote_in))
+        {
+          free_game (g);
+          return NULL;
+        }
+    }
+  if (g->result == IN_PROGRESS)
+    g->result = result;
+  return g;
+}
+
+// Variations
 
-///////////////////////////////////
-// MAIN (only for internal test) //
-///////////////////////////////////
+// Returns the number of moves of a line, the main line of the game if NULL.
 int
-main ()
+line_size (Game *g, Variation *line)
 {
-  // Valgrind run
-  init_chess_library ();
-  int from, to;
+  return line ? line->size : g->current;
+}
 
-  for (int i = 0; i < 1000; i++)
+// Returns the board after the move at index of a line, the main line of the
+// game if NULL. If index is negative returns the board before the first move
+// of the line.
+Board*
+line_board (Game *g, Variation *line, int index)
+{
+  if (!line)
+    return get_board (g, index);
+  if (index < 0)
+    return line_board (g, line->parent, line->ply - 1);
+  return line->boards[index];
+}
+
+// Returns the variations branching from a line, the main line of the game if
+// NULL.
+Variations*
+line_variations (Game *g, Variation *line)
+{
+  return line ? &line->variations : &g->variations;
+}
+
+// Frees a variation, its plies and its variations.
+static void
+free_variation (Variation *v)
+{
+  for (int i = 0; i < v->variations.count; i++)
+    free_variation (v->variations.items[i]);
+  free (v->variations.items);
+  for (int i = 0; i < v->size; i++)
     {
-      Game *g = init_game ();
-      Board *board;
-      char *fen;
-
-      // 1. e4 a6 2. Bc4 a5 3. Qh5 a4 4. Qxf7#
-      board = current_board (g);
-      get_coord (board, 'P', NULL, "e4", '\0', &from, &to);
-      pseudo_legal_move (board, from, to);
-      apply_move (g, from, to, 0);
-      fen = to_fen (board);
-      free (fen);
+      free (v->boards[i]);
+      free (v->moves[i]);
+      free (v->coord_moves[i]);
+    }
+  free (v->boards);
+  free (v->moves);
+  free (v->coord_moves);
+  free (v);
+}
 
-      board = current_board (g);
-      get_coord (board, 'P', NULL, "a6", '\0', &from, &to);
-      pseudo_legal_move (board, from, to);
-      apply_move (g, from, to, '\0');
-      fen = to_fen (current_board (g));
-      free (fen);
+// Frees the variations of a list.
+static void
+free_variations (Variations *list)
+{
+  for (int i = 0; i < list->count; i++)
+    free_variation (list->items[i]);
+  free (list->items);
+  list->items = NULL;
+  list->count = 0;
+}
 
-      board = current_board (g);
-      get_coord (board, 'B', NULL, "c4", '\0', &from, &to);
-      pseudo_legal_move (board, from, to);
-      apply_move (g, from, to, '\0');
-      fen = to_fen (current_board (g));
-      free (fen);
+// Frees the variations of the main line that replace a move no more in it.
+static void
+prune_variations (Game *g)
+{
+  Variations *list = &g->variations;
+  int n = 0;
+  for (int i = 0; i < list->count; i++)
+    {
+      if (list->items[i]->ply >= g->current)
+        free_variation (list->items[i]);
+      else
+        list->items[n++] = list->items[i];
+    }
+  list->count = n;
+}
 
-      board = current_board (g);
-      get_coord (board, 'P', NULL, "a5", '\0', &from, &to);
-      pseudo_legal_move (board, from, to);
-      apply_move (g, from, to, '\0');
-      fen = to_fen (current_board (g));
-      free (fen);
+// Appends a variation to a list.
+static void
+push_variation (Variations *list, Variation *v)
+{
+  list->items = (Variation **) realloc (list->items, (list->count + 1) * sizeof (Variation *));
+  list->items[list->count++] = v;
+}
 
-      board = current_board (g);
-      get_coord (board, 'Q', NULL, "h5", '\0', &from, &to);
-      pseudo_legal_move (board, from, to);
-      apply_move (g, from, to, '\0');
-      fen = to_fen (current_board (g));
-      free (fen);
+// Grows the plies of a variation to hold at least size moves.
+static void
+reserve_plies (Variation *v, int size)
+{
+  if (size <= v->capacity)
+    return;
+  int capacity = v->capacity ? v->capacity : 8;
+  while (capacity < size)
+    capacity *= 2;
+  v->boards = (Board **) realloc (v->boards, capacity * sizeof (Board *));
+  v->moves = (char **) realloc (v->moves, capacity * sizeof (char *));
+  v->coord_moves = (char **) realloc (v->coord_moves, capacity * sizeof (char *));
+  v->capacity = capacity;
+}
 
-      board = current_board (g);
-      get_coord (board, 'P', NULL, "a4", '\0', &from, &to);
-      pseudo_legal_move (board, from, to);
-      apply_move (g, from, to, '\0');
-      fen = to_fen (current_board (g));
-      free (fen);
+// Returns a copy of a string.
+static char*
+copy_string (const char *s)
+{
+  char *copy = (char *) STATS_MALLOC (strlen (s) + 1);
+  strcpy (copy, s);
+  return copy;
+}
 
-      board = current_board (g);
-      get_coord (board, 'Q', NULL, "f7", '\0', &from, &to);
-      pseudo_legal_move (board, from, to);
-      apply_move (g, from, to, '\0');
-      fen = to_fen (current_board (g));
-      free (fen);
+// Returns a deep copy of a variation for the copy of its game.
+static Variation*
+copy_variation (const Variation *v, Variation *parent)
+{
+  Variation *copy = (Variation *) STATS_MALLOC (sizeof (Variation));
+  *copy = *v;
+  copy->parent = parent;
+  copy->capacity = 0;
+  copy->boards = NULL;
+  copy->moves = NULL;
+  copy->coord_moves = NULL;
+  reserve_plies (copy, v->size);
+  for (int i = 0; i < v->size; i++)
+    {
+      copy->boards[i] = NEW_BOARD;
+      COPY_BOARD (copy->boards[i], v->boards[i]);
+      copy->moves[i] = copy_string (v->moves[i]);
+      copy->coord_moves[i] = copy_string (v->coord_moves[i]);
+    }
+  copy->variations.items = NULL;
+  copy->variations.count = 0;
+  for (int i = 0; i < v->variations.count; i++)
+    push_variation (&copy->variations, copy_variation (v->variations.items[i], copy));
+  return copy;
+}
+
+// Returns a new empty variation, alternative to the move at index ply of a
+// line (the main line of the game if parent is NULL). NULL if there is no
+// such move or it is the position set by FEN that starts the game.
+Variation*
+add_variation (Game *g, Variation *parent, int ply)
+{
+  if (ply < 0 || ply >= line_size (g, parent))
+    return NULL;
+  if (!parent && ply == 0 && g->current > 0 && strcmp (g->coord_moves[0], "SET BY FEN") == 0)
+    return NULL;
+  Variation *v = (Variation *) STATS_MALLOC (sizeof (Variation));
+  v->parent = parent;
+  v->ply = ply;
+  v->size = 0;
+  v->capacity = 0;
+  v->boards = NULL;
+  v->moves = NULL;
+  v->coord_moves = NULL;
+  v->result = IN_PROGRESS;
+  v->variations.items = NULL;
+  v->variations.count = 0;
+  push_variation (line_variations (g, parent), v);
+  return v;
+}
 
-      // board = current_board (g);
-      // printf("%s\n", print_board (board));
+// Returns true if the move from-to is legal at the end of the variation. Add
+// the new board on the variation.
+bool
+variation_apply_move (Game *g, Variation *v, int from, int to, char promote_in)
+{
+  if (v->size >= BUFFER_SIZE) return FALSE;
+  if (v->result != IN_PROGRESS && v->result != DRAW) return FALSE;
+  Board *new_board;
+  char *move_done;
+  if (!play_move (line_board (g, v, v->size - 1), from, to, promote_in, &new_board, &move_done, &v->result))
+    return FALSE;
+  reserve_plies (v, v->size + 1);
+  v->boards[v->size] = new_board;
+  v->moves[v->size] = move_done;
+  v->coord_moves[v->size] = ft_to_coord_move (from, to, promote_in);
+  v->size++;
+  return TRUE;
+}
 
-      free_game (g);
+// Takes the ownership of the plies of the main line from index on, copying
+// the ones shared with the copies of the game.
+static void
+own_plies (Game *g, int index)
+{
+  for (int i = index; i < g->shared; i++)
+    {
+      Board *board = NEW_BOARD;
+      COPY_BOARD (board, g->boards[i]);
+      g->boards[i] = board;
+      g->moves[i] = copy_string (g->moves[i]);
+      g->coord_moves[i] = copy_string (g->coord_moves[i]);
     }
-  return 0;
+  if (index < g->shared)
+    g->shared = index;
+}
+
+// Makes a variation the continuation of its parent line. The moves of the
+// parent line it replaces, and their variations, become the variation, which
+// stays among the variations of the parent line. Returns false if the
+// variation is empty or the main line would be too long.
+bool
+promote_variation (Game *g, Variation *v)
+{
+  Variation *parent = v->parent;
+  int k = v->ply;
+  int tail = line_size (g, parent) - k;
+  int size = v->size;
+  if (size == 0 || (!parent && k + size > BUFFER_SIZE))
+    return FALSE;
+  Board **boards = (Board **) STATS_MALLOC ((tail + 1) * sizeof (Board *));
+  char **moves = (char **) STATS_MALLOC ((tail + 1) * sizeof (char *));
+  char **coord_moves = (char **) STATS_MALLOC ((tail + 1) * sizeof (char *));
+  unsigned short result;
+  // Swap the moves
+  if (parent)
+    {
+      memcpy (boards, parent->boards + k, tail * sizeof (Board *));
+      memcpy (moves, parent->moves + k, tail * sizeof (char *));
+      memcpy (coord_moves, parent->coord_moves + k, tail * sizeof (char *));
+      reserve_plies (parent, k + size);
+      memcpy (parent->boards + k, v->boards, size * sizeof (Board *));
+      memcpy (parent->moves + k, v->moves, size * sizeof (char *));
+      memcpy (parent->coord_moves + k, v->coord_moves, size * sizeof (char *));
+      parent->size = k + size;
+      result = parent->result;
+      parent->result = v->result;
+    }
+  else
+    {
+      own_plies (g, k);
+      memcpy (boards, g->boards + k, tail * sizeof (Board *));
+      memcpy (moves, g->moves + k, tail * sizeof (char *));
+      memcpy (coord_moves, g->coord_moves + k, tail * sizeof (char *));
+      memcpy (g->boards + k, v->boards, size * sizeof (Board *));
+      memcpy (g->moves + k, v->moves, size * sizeof (char *));
+      memcpy (g->coord_moves + k, v->coord_moves, size * sizeof (char *));
+      g->current = k + size;
+      result = g->result;
+      g->result = v->result;
+    }
+  free (v->boards);
+  free (v->moves);
+  free (v->coord_moves);
+  v->boards = boards;
+  v->moves = moves;
+  v->coord_moves = coord_moves;
+  v->size = tail;
+  v->capacity = tail + 1;
+  v->result = result;
+  // Swap the variations after the branch: the ones of the parent line move to
+  // the variation, the ones of the variation to the parent line
+  Variations *list = line_variations (g, parent);
+  Variations from_variation = v->variations;
+  v->variations.items = NULL;
+  v->variations.count = 0;
+  int n = 0;
+  for (int i = 0; i < list->count; i++)
+    {
+      Variation *child = list->items[i];
+      if (child->ply > k)
+        {
+          child->parent = v;
+          child->ply -= k;
+          push_variation (&v->variations, child);
+        }
+      else
+        list->items[n++] = child;
+    }
+  list->count = n;
+  for (int i = 0; i < from_variation.count; i++)
+    {
+      Variation *child = from_variation.items[i];
+      child->parent = parent;
+      child->ply += k;
+      push_variation (list, child);
+    }
+  free (from_variation.items);
+  return TRUE;
+}
+
+// Removes a variation from its parent line and frees it.
+void
+remove_variation (Game *g, Variation *v)
+{
+  Variations *list = line_variations (g, v->parent);
+  int n = 0;
+  for (int i = 0; i < list->count; i++)
+    if (list->items[i] != v)
+      list->items[n++] = list->items[i];
+  list->count = n;
+  free_variation (v);
+}
+
+// Returns the share of a game in the memory of its history: each segment is
+// divided evenly among the references to it.
+size_t
+history_memsize (const History *h)
+{
+  size_t size = 0;
+  for (; h; h = h->parent)
+    {
+      size_t segment = sizeof (History) + 3 * h->size * sizeof (void *);
+      for (int i = 0; i < h->size; i++)
+        segment += sizeof (Board) + strlen (h->plies[h->size + i]) + 1 + strlen (h->plies[2 * h->size + i]) + 1;
+      size += segment / __atomic_load_n (&h->refs, __ATOMIC_RELAXED);
+    }
+  return size;
+}
+
+// Returns the memory used by the variations of a list.
+size_t
+variations_memsize (const Variations *list)
+{
+  size_t size = list->count * sizeof (Variation *);
+  for (int i = 0; i < list->count; i++)
+    {
+      const Variation *v = list->items[i];
+      size += sizeof (Variation) + 3 * v->capacity * sizeof (void *) + variations_memsize (&v->variations);
+      for (int j = 0; j < v->size; j++)
+        size += sizeof (Board) + strlen (v->moves[j]) + 1 + strlen (v->coord_moves[j]) + 1;
+    }
+  return size;
 }
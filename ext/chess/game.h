@@ -8,13 +8,53 @@
 #ifndef GAME_H
 #define GAME_H
 
-#define NEW_GAME (Game*) malloc (sizeof (Game))
+#define NEW_GAME (Game*) STATS_MALLOC (sizeof (Game))
 
 #define BUFFER_SIZE 1024
 
+#define BINARY_VERSION 1
+#define BINARY_DEFAULT_PROMOTION 0xff
+
 #include "common.h"
 #include "board.h"
 
+// Plies of a game shared with its copies (see copy_game): the boards and the
+// moves, stored as size boards, size moves and size coord moves. They are
+// immutable and freed, with the parent, by the last game that references them.
+typedef struct History
+{
+  struct History *parent;
+  int refs;
+  int size;
+  void *plies[];
+} History;
+
+typedef struct Variation Variation;
+
+// The variations branching from a line of moves.
+typedef struct
+{
+  Variation **items;
+  int count;
+} Variations;
+
+// A line of moves alternative to the move at index ply of its parent line,
+// the main line of the game if parent is NULL: its first move is played on
+// the board before that move, which is not copied. Its plies are its own.
+struct Variation
+{
+  Variation *parent;
+  int ply;
+  int size;
+  int capacity;
+  Board **boards;
+  char **moves;
+  char **coord_moves;
+  unsigned short result;
+  Variations variations;
+};
+
+// The plies before shared are owned by history, the others by the game.
 typedef struct
 {
   Board* boards[BUFFER_SIZE];
@@ -22,21 +62,41 @@ typedef struct
   char* coord_moves[BUFFER_SIZE];
   int current;
   unsigned short result;
+  History *history;
+  int shared;
+  Variations variations;
 } Game;
 
 
 #include "special.h"
 
-void init_chess_library ();
 Game* init_game ();
 void free_game (Game *g);
+Game* copy_game (Game *g);
 Board* current_board (Game *g);
 Board* get_board (Game *g, int index);
 char* current_move (Game *g);
 char* current_coord_move (Game *g);
+bool play_move (Board *board, int from, int to, char promote_in, Board **new_board, char **move_done, unsigned short *result);
 bool apply_move (Game *g, int from, int to, char promote_in);
 void rollback (Game *g);
 bool threefold_repetition (Game *g);
+bool valid_fen (const char *fen);
 void set_fen (Game *g, const char *fen);
+void parse_fen (const char *fen, Board *board);
+void set_board (Game *g, Board *board);
+unsigned char* dump_game (Game *g, size_t *size);
+size_t load_game_header (const unsigned char *data, size_t size, Board *board, int *result);
+Game* load_game (const unsigned char *data, size_t size);
+// Variations
+int line_size (Game *g, Variation *line);
+Board* line_board (Game *g, Variation *line, int index);
+Variations* line_variations (Game *g, Variation *line);
+Variation* add_variation (Game *g, Variation *parent, int ply);
+bool variation_apply_move (Game *g, Variation *v, int from, int to, char promote_in);
+bool promote_variation (Game *g, Variation *v);
+void remove_variation (Game *g, Variation *v);
+size_t history_memsize (const History *h);
+size_t variations_memsize (const Variations *list);
 
 #endif
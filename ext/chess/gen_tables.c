@@ -0,0 +1,87 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+// Generates tables.h, the attack tables of bitboard.c, at build time:
+//
+//   gen_tables > tables.h
+//
+// The tables are const arrays, so they are in the read-only data of the
+// library: nothing to compute when it is loaded, and one copy shared by all
+// the processes that use it.
+
+#include <stdio.h>
+#include <stdint.h>
+
+typedef uint64_t bboard;
+
+// The directions of bitboard.c as file and rank steps.
+static const int FILE_STEP[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static const int RANK_STEP[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+
+static const int KNIGHT_FILE_STEP[8] = { 1, 2, 2, 1, -1, -2, -2, -1 };
+static const int KNIGHT_RANK_STEP[8] = { 2, 1, -1, -2, -2, -1, 1, 2 };
+
+// Returns the squares reached from a square with up to max steps of (df, dr).
+static bboard
+ray (int square, int df, int dr, int max)
+{
+  bboard b = 0;
+  int f = square % 8 + df, r = square / 8 + dr;
+  for (int i = 0; i < max && f >= 0 && f < 8 && r >= 0 && r < 8; i++, f += df, r += dr)
+    b |= 1ULL << (r * 8 + f);
+  return b;
+}
+
+static void
+print_squares (const bboard table[64], const char *indent)
+{
+  for (int i = 0; i < 64; i++)
+    printf ("%s0x%016llX%s", i % 4 ? " " : indent, (unsigned long long) table[i],
+            i == 63 ? "\n" : i % 4 == 3 ? ",\n" : ",");
+}
+
+static void
+print_table (const char *comment, const char *name, const bboard table[64])
+{
+  printf ("\n// %s\nstatic const bboard %s[64] =\n{\n", comment, name);
+  print_squares (table, "  ");
+  printf ("};\n");
+}
+
+int
+main (void)
+{
+  bboard white_pawn[64], black_pawn[64], knight[64], king[64], rays[8][64];
+  for (int i = 0; i < 64; i++)
+    {
+      white_pawn[i] = ray (i, -1, 1, 1) | ray (i, 1, 1, 1);
+      black_pawn[i] = ray (i, -1, -1, 1) | ray (i, 1, -1, 1);
+      knight[i] = king[i] = 0;
+      for (int j = 0; j < 8; j++)
+        {
+          knight[i] |= ray (i, KNIGHT_FILE_STEP[j], KNIGHT_RANK_STEP[j], 1);
+          king[i] |= ray (i, FILE_STEP[j], RANK_STEP[j], 1);
+          rays[j][i] = ray (i, FILE_STEP[j], RANK_STEP[j], 7);
+        }
+    }
+
+  printf ("// Generated by gen_tables.c, do not edit.\n");
+  print_table ("Squares attacked by a white pawn.", "ALL_XRAY_ATTACK_WHITE_PAWN", white_pawn);
+  print_table ("Squares attacked by a black pawn.", "ALL_XRAY_ATTACK_BLACK_PAWN", black_pawn);
+  print_table ("Squares attacked by a knight.", "ALL_XRAY_KNIGHT", knight);
+  print_table ("Squares attacked by a king.", "ALL_XRAY_KING", king);
+  printf ("\n// Squares from a square to the edge of the board, by direction.\n"
+          "static const bboard RAYS[8][64] =\n{\n");
+  for (int j = 0; j < 8; j++)
+    {
+      printf ("  {\n");
+      print_squares (rays[j], "    ");
+      printf ("  }%s\n", j == 7 ? "" : ",");
+    }
+  printf ("};\n");
+  return 0;
+}
@@ -0,0 +1,34 @@
+# Training workload of the profile-guided build (CHESS_BUILD=pgo, see
+# extconf.rb): it runs the extension compiled with -fprofile-generate on the
+# operations that matter, so the final build is optimized for them.
+#
+#   ruby -I<dir with chess/chess.so> -Ilib ext/chess/pgo_training.rb test/pgn_collection
+
+require 'chess'
+
+# The collection is UTF-8 whatever the locale of the install.
+Encoding.default_external = Encoding::UTF_8
+
+collection = ARGV.fetch(0)
+files = Dir[File.join(collection, '**', '*.pgn')].sort
+valid = files.grep(%r{/valid/})
+
+# Replay the collection natively, and through the Ruby API that parses PGN
+# and moves in SAN and coordinate notation.
+Chess::Database.validate(collection, threads: 1)
+valid.each do |file|
+  game = Chess::Game.load_pgn(file)
+  replay = Chess::Game.new(game.coord_moves)
+  replay.each do |board|
+    board.generate_all_moves
+    board.to_fen
+  end
+  replay.threefold_repetition?
+rescue Chess::IllegalMoveError, Chess::InvalidPgnFormatError
+  next
+end
+
+# Move generation in depth.
+Chess::Game.new.board.perft(4)
+Chess::Game.new(%w[e4 c5 Nf3 d6 d4 cxd4 Nxd4 Nf6 Nc3 a6]).board.perft(3)
+Chess::Game.new.set_fen!('r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1').board.perft(3)
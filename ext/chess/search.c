@@ -0,0 +1,386 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+// clock_gettime and threads are POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <time.h>
+#include "search.h"
+#include "eval.h"
+#include "book.h"
+#include "bitbase.h"
+
+// Move ordering scores.
+#define HASH_MOVE_SCORE 1000000
+#define CAPTURE_SCORE 100000
+#define PROMOTION_SCORE 90000
+#define KILLER_SCORE 80000
+
+// A helper thread of a parallel search.
+typedef struct
+{
+  Board *board;
+  Search search;
+  pthread_t thread;
+} Helper;
+
+// Initializes the search with the given limits and transposition table. Zero
+// means no limit.
+void
+init_search (Search *search, int max_depth, unsigned long long max_nodes, long time_ms, TranspositionTable *table)
+{
+  memset (search, 0, sizeof (Search));
+  search->max_depth = max_depth;
+  search->max_nodes = max_nodes;
+  search->time_ms = time_ms;
+  search->table = table;
+}
+
+// Milliseconds of a monotonic clock.
+static long long
+now_ms (void)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Milliseconds elapsed since the start of the search.
+long
+elapsed_ms (Search *search)
+{
+  return (long) (now_ms () - search->start_ms);
+}
+
+// Counts a node and returns true if the search must stop. The clock is read
+// every 1024 nodes.
+static bool
+must_stop (Search *search)
+{
+  search->nodes++;
+  if (search->max_nodes && search->nodes >= search->max_nodes)
+    search->stop = 1;
+  else if (search->time_ms && (search->nodes & 1023) == 0 && elapsed_ms (search) >= search->time_ms)
+    search->stop = 1;
+  return search->stop;
+}
+
+// Returns the type (1 pawn ... 6 king) of the piece captured by the move, 0 if
+// the move is not a capture.
+static int
+captured_type (Board *board, int move)
+{
+  int from = MOVE_FROM (move);
+  int to = MOVE_TO (move);
+  if (board->placement[to])
+    return piece_to_nibble (board->placement[to]) & 7;
+  if (toupper (board->placement[from]) == 'P' && (from & 7) != (to & 7))
+    return 1; // En passant
+  return 0;
+}
+
+// Gives a score to each move: the hash move first, then captures ordered by
+// most valuable victim and least valuable attacker, promotions and killer
+// moves. Helpers of a parallel search (id > 0) shuffle the other moves in a
+// different way each, so that they explore different parts of the tree.
+static void
+score_moves (Board *board, int *moves, int *scores, int n, int hash_move, const int *killers, int id)
+{
+  for (int i = 0; i < n; i++)
+    {
+      int move = moves[i];
+      int victim = captured_type (board, move);
+      if (move == hash_move)
+        scores[i] = HASH_MOVE_SCORE;
+      else if (victim)
+        scores[i] = CAPTURE_SCORE + 16 * victim - (piece_to_nibble (board->placement[MOVE_FROM (move)]) & 7);
+      else if (MOVE_PROMOTION (move))
+        scores[i] = PROMOTION_SCORE + MOVE_PROMOTION (move);
+      else if (killers && move == killers[0])
+        scores[i] = KILLER_SCORE;
+      else if (killers && move == killers[1])
+        scores[i] = KILLER_SCORE - 1;
+      else
+        scores[i] = id ? (int) (((unsigned int) move * (2654435761u + 2 * id)) >> 26) : 0;
+    }
+}
+
+// Moves the best scored move from index i onwards to index i and returns it.
+static int
+pick_move (int *moves, int *scores, int n, int i)
+{
+  int best = i;
+  for (int j = i + 1; j < n; j++)
+    if (scores[j] > scores[best])
+      best = j;
+  int move = moves[best];
+  int score = scores[best];
+  moves[best] = moves[i];
+  scores[best] = scores[i];
+  moves[i] = move;
+  scores[i] = score;
+  return move;
+}
+
+static bool
+play (Board *board, int move, Board *new_board)
+{
+  return make_move (board, MOVE_FROM (move), MOVE_TO (move), promotion_to_char (MOVE_PROMOTION (move)), new_board, NULL);
+}
+
+// Searches only captures and promotions until the position is quiet, so that
+// the static evaluation is not taken in the middle of an exchange.
+static int
+quiesce (Board *board, int alpha, int beta, int ply, Search *search)
+{
+  if (must_stop (search))
+    return 0;
+  int stand_pat = evaluate (board);
+  if (stand_pat >= beta || ply >= MAX_PLY - 1)
+    return stand_pat;
+  if (stand_pat > alpha)
+    alpha = stand_pat;
+  int moves[MAX_MOVES];
+  int scores[MAX_MOVES];
+  int n = legal_moves (board, moves);
+  int noisy = 0;
+  for (int i = 0; i < n; i++)
+    if (MOVE_PROMOTION (moves[i]) || captured_type (board, moves[i]))
+      moves[noisy++] = moves[i];
+  score_moves (board, moves, scores, noisy, 0, NULL, search->id);
+  Board new_board;
+  for (int i = 0; i < noisy; i++)
+    {
+      int move = pick_move (moves, scores, noisy, i);
+      if (!play (board, move, &new_board))
+        continue;
+      int score = -quiesce (&new_board, -beta, -alpha, ply + 1, search);
+      if (search->stop)
+        return 0;
+      if (score >= beta)
+        return score;
+      if (score > alpha)
+        alpha = score;
+    }
+  return alpha;
+}
+
+// Mate scores are stored in the transposition table as distance from the
+// position instead of distance from the root.
+static int
+score_to_table (int score, int ply)
+{
+  if (score >= MATE_SCORE - MAX_PLY)
+    return score + ply;
+  if (score <= -MATE_SCORE + MAX_PLY)
+    return score - ply;
+  return score;
+}
+
+static int
+score_from_table (int score, int ply)
+{
+  if (score >= MATE_SCORE - MAX_PLY)
+    return score - ply;
+  if (score <= -MATE_SCORE + MAX_PLY)
+    return score + ply;
+  return score;
+}
+
+// Returns true if the position at ply already occurred in the search path or
+// in the history since the last capture or pawn move.
+static bool
+repetition (Board *board, int ply, Search *search)
+{
+  int first = ply - (int) board->halfmove_clock;
+  for (int i = ply - 4; i >= first; i -= 2)
+    {
+      if (i >= 0)
+        {
+          if (search->keys[i] == search->keys[ply])
+            return TRUE;
+        }
+      else if (search->history_size + i >= 0)
+        {
+          if (search->history[search->history_size + i] == search->keys[ply])
+            return TRUE;
+        }
+      else
+        break;
+    }
+  return FALSE;
+}
+
+// Negamax alpha-beta search. Returns the score of the position from the point
+// of view of the active color. At the root the best move is stored in
+// search->root_move.
+static int
+negamax (Board *board, int depth, int alpha, int beta, int ply, Search *search)
+{
+  if (must_stop (search))
+    return 0;
+  search->keys[ply] = polyglot_key (board);
+  if (ply > 0)
+    {
+      if (board->halfmove_clock >= 100 || insufficient_material (board) || repetition (board, ply, search))
+        return 0;
+      // Endings in the bitbases: the draws are exact, the wins are taken when
+      // the material changes, otherwise the search goes on to find the mate
+      int result = probe_bitbase (board);
+      if (result == DRAW)
+        return 0;
+      if (result != IN_PROGRESS && board->halfmove_clock == 0)
+        return ((result == WHITE_WON) == (board->active_color == WHITE) ? KNOWN_WIN_SCORE : -KNOWN_WIN_SCORE) + evaluate (board);
+      if (ply >= MAX_PLY - 1)
+        return evaluate (board);
+    }
+  int in_check = king_in_check (board, board->active_color);
+  if (in_check)
+    depth++;
+  if (depth <= 0)
+    return quiesce (board, alpha, beta, ply, search);
+  int hash_move = 0;
+  TranspositionProbe probe;
+  if (search->table && probe_table (search->table, search->keys[ply], &probe))
+    {
+      hash_move = probe.move;
+      if (ply > 0 && probe.depth >= depth)
+        {
+          int score = score_from_table (probe.score, ply);
+          if (probe.bound == EXACT_BOUND
+              || (probe.bound == LOWER_BOUND && score >= beta)
+              || (probe.bound == UPPER_BOUND && score <= alpha))
+            return score;
+        }
+    }
+  if (ply == 0 && search->depth > 0)
+    hash_move = search->best_move;
+  int moves[MAX_MOVES];
+  int scores[MAX_MOVES];
+  int n = legal_moves (board, moves);
+  if (n == 0)
+    return in_check ? -MATE_SCORE + ply : 0;
+  score_moves (board, moves, scores, n, hash_move, search->killers[ply], search->id);
+  int original_alpha = alpha;
+  int best = -INFINITE_SCORE;
+  int best_move = 0;
+  Board new_board;
+  for (int i = 0; i < n; i++)
+    {
+      int move = pick_move (moves, scores, n, i);
+      if (!play (board, move, &new_board))
+        continue;
+      int score = -negamax (&new_board, depth - 1, -beta, -alpha, ply + 1, search);
+      if (search->stop)
+        return 0;
+      if (score > best)
+        {
+          best = score;
+          best_move = move;
+          if (ply == 0)
+            search->root_move = move;
+        }
+      if (score > alpha)
+        alpha = score;
+      if (alpha >= beta)
+        {
+          if (!captured_type (board, move) && move != search->killers[ply][0])
+            {
+              search->killers[ply][1] = search->killers[ply][0];
+              search->killers[ply][0] = move;
+            }
+          break;
+        }
+    }
+  if (search->table)
+    {
+      int bound = best >= beta ? LOWER_BOUND : best > original_alpha ? EXACT_BOUND : UPPER_BOUND;
+      store_table (search->table, search->keys[ply], bound == UPPER_BOUND ? 0 : best_move,
+                   score_to_table (best, ply), depth, bound);
+    }
+  return best;
+}
+
+// Searches the position with iterative deepening until one of the limits is
+// reached and returns the best move found, 0 if there are no legal moves. The
+// best move is the one of the last completed iteration; search->depth and
+// search->score are the depth and the score of that iteration. Helpers of a
+// parallel search with odd id start from depth 2, so that half of them is one
+// ply ahead of the main search.
+int
+search (Board *board, Search *search)
+{
+  search->start_ms = now_ms ();
+  int moves[MAX_MOVES];
+  int n = legal_moves (board, moves);
+  if (n == 0)
+    return 0;
+  search->best_move = moves[0];
+  int max_depth = search->max_depth > 0 && search->max_depth < MAX_PLY - 1 ? search->max_depth : MAX_PLY - 1;
+  for (int depth = 1 + (search->id & 1); depth <= max_depth; depth++)
+    {
+      search->root_move = 0;
+      int score = negamax (board, depth, -INFINITE_SCORE, INFINITE_SCORE, 0, search);
+      if (search->stop)
+        {
+          // Better than nothing if the first iteration did not complete
+          if (search->depth == 0 && search->root_move)
+            search->best_move = search->root_move;
+          break;
+        }
+      search->best_move = search->root_move;
+      search->score = score;
+      search->depth = depth;
+      if (search->report && search->id == 0)
+        search->report (search);
+      if (n == 1 || score >= MATE_SCORE - MAX_PLY || score <= -MATE_SCORE + MAX_PLY)
+        break;
+    }
+  return search->best_move;
+}
+
+static void*
+helper_search (void *data)
+{
+  Helper *helper = (Helper *) data;
+  search (helper->board, &helper->search);
+  return NULL;
+}
+
+// Lazy SMP: searches the position with the main search and threads - 1 helper
+// threads sharing the transposition table. The helpers have no limits and only
+// fill the table; they are stopped when the main search ends, whose best move
+// is returned. Without a table the search is single threaded.
+int
+parallel_search (Board *board, Search *main_search, int threads)
+{
+  if (main_search->table)
+    new_generation (main_search->table);
+  if (threads < 2 || !main_search->table)
+    return search (board, main_search);
+  Helper *helpers = (Helper *) malloc ((threads - 1) * sizeof (Helper));
+  int started = 0;
+  if (helpers)
+    for (; started < threads - 1; started++)
+      {
+        init_search (&helpers[started].search, 0, 0, 0, main_search->table);
+        helpers[started].search.id = started + 1;
+        helpers[started].search.history = main_search->history;
+        helpers[started].search.history_size = main_search->history_size;
+        helpers[started].board = board;
+        if (pthread_create (&helpers[started].thread, NULL, helper_search, helpers + started))
+          break;
+      }
+  int move = search (board, main_search);
+  for (int i = 0; i < started; i++)
+    helpers[i].search.stop = 1;
+  for (int i = 0; i < started; i++)
+    pthread_join (helpers[i].thread, NULL);
+  free (helpers);
+  return move;
+}
@@ -0,0 +1,54 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "common.h"
+#include "board.h"
+#include "transposition.h"
+
+#define MAX_PLY 64
+#define INFINITE_SCORE 32000
+#define MATE_SCORE 31000
+// Score of a won ending found in the bitbases, plus the evaluation
+#define KNOWN_WIN_SCORE 20000
+#define MAX_THREADS 256
+
+// State of a search. The limits are set by init_search, zero means no limit.
+// The search can be stopped from another thread setting stop. table is the
+// transposition table, NULL to search without. id is 0 for the main search and
+// the number of the helper in a parallel search. history are the keys of the
+// positions played before the root, oldest first, used to detect repetitions.
+// If set, report is called by the main search after each completed iteration.
+typedef struct Search
+{
+  int max_depth;
+  unsigned long long max_nodes;
+  long time_ms;
+  TranspositionTable *table;
+  int id;
+  const bboard *history;
+  int history_size;
+  void (*report) (struct Search *search);
+  long long start_ms;
+  volatile int stop;
+  unsigned long long nodes;
+  int depth;
+  int best_move;
+  int score;
+  int root_move;
+  int killers[MAX_PLY][2];
+  bboard keys[MAX_PLY];
+} Search;
+
+void init_search (Search *search, int max_depth, unsigned long long max_nodes, long time_ms, TranspositionTable *table);
+long elapsed_ms (Search *search);
+int search (Board *board, Search *search);
+int parallel_search (Board *board, Search *main_search, int threads);
+
+#endif
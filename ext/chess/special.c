@@ -99,49 +99,57 @@ castling (Board *board, int castling_type, Board *new_board)
   switch (castling_type)
     {
     case WHITE_SHORT_CASTLING:
-      memcpy (new_board, board, sizeof (Board));
+      COPY_BOARD (new_board, board);
       new_board->king[WHITE] ^= 0x50;
       new_board->rooks[WHITE] ^= 0xa0;
       new_board->placement[E1] = '\0';
       new_board->placement[F1] = 'R';
       new_board->placement[G1] = 'K';
       new_board->placement[H1] = '\0';
+      move_piece_score (new_board, 'K', E1, G1);
+      move_piece_score (new_board, 'R', H1, F1);
       new_board->castling ^= new_board->castling & 0x1100;
       move = (char *) malloc (5);
       strcpy (move, "O-O");
       break;
     case WHITE_LONG_CASTLING:
-      memcpy (new_board, board, sizeof (Board));
+      COPY_BOARD (new_board, board);
       new_board->king[WHITE] ^= 0x14;
       new_board->rooks[WHITE] ^= 0x09;
       new_board->placement[E1] = '\0';
       new_board->placement[D1] = 'R';
       new_board->placement[C1] = 'K';
       new_board->placement[A1] = '\0';
+      move_piece_score (new_board, 'K', E1, C1);
+      move_piece_score (new_board, 'R', A1, D1);
       new_board->castling ^= new_board->castling & 0x1100;
       move = (char *) malloc (7);
       strcpy (move, "O-O-O");
       break;
     case BLACK_SHORT_CASTLING:
-      memcpy (new_board, board, sizeof (Board));
+      COPY_BOARD (new_board, board);
       new_board->king[BLACK] ^= 0x5000000000000000;
       new_board->rooks[BLACK] ^= 0xa000000000000000;
       new_board->placement[E8] = '\0';
       new_board->placement[F8] = 'r';
       new_board->placement[G8] = 'k';
       new_board->placement[H8] = '\0';
+      move_piece_score (new_board, 'k', E8, G8);
+      move_piece_score (new_board, 'r', H8, F8);
       new_board->castling ^= new_board->castling & 0x0011;
       move = (char *) malloc (5);
       strcpy (move, "O-O");
       break;
     case BLACK_LONG_CASTLING:
-      memcpy (new_board, board, sizeof (Board));
+      COPY_BOARD (new_board, board);
       new_board->king[BLACK] ^= 0x1400000000000000;
       new_board->rooks[BLACK] ^= 0x0900000000000000;
       new_board->placement[E8] = '\0';
       new_board->placement[D8] = 'r';
       new_board->placement[C8] = 'k';
       new_board->placement[A8] = '\0';
+      move_piece_score (new_board, 'k', E8, C8);
+      move_piece_score (new_board, 'r', A8, D8);
       new_board->castling ^= new_board->castling & 0x0011;
       move = (char *) malloc (7);
       strcpy (move, "O-O-O");
@@ -179,6 +187,19 @@ have_en_passant (Board *board, int from, int to)
   return 0;
 }
 
+// Returns true if a pawn of the active color stands next to the pawn that can
+// be captured en passant (pins are not considered).
+bool
+en_passant_capturable (Board *board)
+{
+  int ep = board->en_passant;
+  if (board->active_color == WHITE && ep >= A6 && ep <= H6 && (board->pawns[BLACK] & 1ULL << (ep - 8)))
+    return (xray_attack_black_pawn (ep) & board->pawns[WHITE]) != 0;
+  if (board->active_color == BLACK && ep >= A3 && ep <= H3 && (board->pawns[WHITE] & 1ULL << (ep + 8)))
+    return (xray_attack_white_pawn (ep) & board->pawns[BLACK]) != 0;
+  return FALSE;
+}
+
 // Returns true if a pawn must be promoted (a pawn is on the edges).
 bool
 require_a_promotion (Board *board)
@@ -205,5 +226,7 @@ promote (Board *board, int square, char promote_in)
     }
   *(get_bitboard (board, square)) ^= 1ULL << square;
   *(get_piece_bitboard (board, promote_in)) ^= 1ULL << square;
+  remove_piece_score (board, board->placement[square], square);
+  add_piece_score (board, promote_in, square);
   board->placement[square] = promote_in;
 }
@@ -17,6 +17,7 @@ int castling_type (Board *board, int from, int to);
 char* castling (Board *board, int castling_type, Board *new_board);
 void update_en_passant (Board *board, int from, int to);
 int have_en_passant (Board *board, int from, int to);
+bool en_passant_capturable (Board *board);
 bool require_a_promotion (Board *board);
 void promote (Board *board, int square, char promote_in);
 
@@ -0,0 +1,36 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+#include "stats.h"
+
+uint64_t chess_stats[STATS];
+
+// Returns the name of a counter.
+const char*
+stat_name (int stat)
+{
+  static const char *names[STATS] = {
+    "try_move", "all_xray", "king_in_check", "king_in_checkmate", "stalemate",
+    "get_notation", "malloc_calls", "malloc_bytes", "board_copies"
+  };
+  return names[stat];
+}
+
+// Returns the value of a counter. Safe to call while other threads count.
+uint64_t
+get_stat (int stat)
+{
+  return __atomic_load_n (&chess_stats[stat], __ATOMIC_RELAXED);
+}
+
+// Sets all the counters to zero.
+void
+reset_stats (void)
+{
+  for (int i = 0; i < STATS; i++)
+    __atomic_store_n (&chess_stats[i], 0, __ATOMIC_RELAXED);
+}
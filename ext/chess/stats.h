@@ -0,0 +1,45 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+// Counters of the hot paths of the library, compiled in only if CHESS_STATS is
+// defined (ruby extconf.rb --enable-stats). Otherwise COUNT does nothing.
+
+#define STAT_TRY_MOVE 0
+#define STAT_ALL_XRAY 1
+#define STAT_KING_IN_CHECK 2
+#define STAT_KING_IN_CHECKMATE 3
+#define STAT_STALEMATE 4
+#define STAT_GET_NOTATION 5
+#define STAT_MALLOC_CALLS 6
+#define STAT_MALLOC_BYTES 7
+#define STAT_BOARD_COPIES 8
+#define STATS 9
+
+#ifdef CHESS_STATS
+#define STATS_ENABLED 1
+#define COUNT(stat, n) ((void) __atomic_fetch_add (&chess_stats[stat], (n), __ATOMIC_RELAXED))
+#else
+#define STATS_ENABLED 0
+#define COUNT(stat, n) ((void) 0)
+#endif
+
+// malloc counting calls and bytes, and memcpy of a board counting the copies.
+#define STATS_MALLOC(size) (COUNT (STAT_MALLOC_CALLS, 1), COUNT (STAT_MALLOC_BYTES, (size)), malloc (size))
+#define COPY_BOARD(dst, src) (COUNT (STAT_BOARD_COPIES, 1), memcpy ((dst), (src), sizeof (Board)))
+
+extern uint64_t chess_stats[STATS];
+
+const char* stat_name (int stat);
+uint64_t get_stat (int stat);
+void reset_stats (void);
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+#include "transposition.h"
+
+#define ENTRY_MOVE(d) ((int) ((d) & 0xffff))
+#define ENTRY_SCORE(d) ((int) (int16_t) (((d) >> 16) & 0xffff))
+#define ENTRY_DEPTH(d) ((int) (((d) >> 32) & 0xff))
+#define ENTRY_BOUND(d) ((int) (((d) >> 40) & 0x3))
+#define ENTRY_GENERATION(d) ((unsigned char) (((d) >> 48) & 0xff))
+
+// Returns a new table of at most size_mb megabytes (at least one cluster),
+// NULL if the memory can not be allocated. The caller holds the only
+// reference.
+TranspositionTable*
+new_table (size_t size_mb)
+{
+  size_t clusters = 1;
+  size_t max_clusters = (size_mb << 20) / (CLUSTER_SIZE * sizeof (TranspositionEntry));
+  while (clusters * 2 <= max_clusters)
+    clusters *= 2;
+  TranspositionTable *table = (TranspositionTable *) malloc (sizeof (TranspositionTable));
+  if (!table)
+    return NULL;
+  table->entries = (TranspositionEntry *) calloc (clusters * CLUSTER_SIZE, sizeof (TranspositionEntry));
+  if (!table->entries)
+    {
+      free (table);
+      return NULL;
+    }
+  table->mask = clusters - 1;
+  table->size_mb = size_mb;
+  table->generation = 0;
+  table->refs = 1;
+  return table;
+}
+
+// Adds a reference to the table. Not thread safe: the callers must serialize
+// retain_table and release_table.
+void
+retain_table (TranspositionTable *table)
+{
+  table->refs++;
+}
+
+// Removes a reference to the table and frees it when it was the last one.
+void
+release_table (TranspositionTable *table)
+{
+  if (--table->refs > 0)
+    return;
+  free (table->entries);
+  free (table);
+}
+
+// Removes all the entries.
+void
+clear_table (TranspositionTable *table)
+{
+  memset ((void *) table->entries, 0, (table->mask + 1) * CLUSTER_SIZE * sizeof (TranspositionEntry));
+  table->generation = 0;
+}
+
+// Starts a new search generation: entries of older searches are replaced
+// first.
+void
+new_generation (TranspositionTable *table)
+{
+  table->generation++;
+}
+
+// Looks for the key in the table. Returns true and fills probe if found.
+bool
+probe_table (TranspositionTable *table, bboard key, TranspositionProbe *probe)
+{
+  TranspositionEntry *cluster = table->entries + (key & table->mask) * CLUSTER_SIZE;
+  for (int i = 0; i < CLUSTER_SIZE; i++)
+    {
+      uint64_t data = cluster[i].data;
+      if ((cluster[i].check ^ data) == key && data)
+        {
+          probe->move = ENTRY_MOVE (data);
+          probe->score = ENTRY_SCORE (data);
+          probe->depth = ENTRY_DEPTH (data);
+          probe->bound = ENTRY_BOUND (data);
+          return TRUE;
+        }
+    }
+  return FALSE;
+}
+
+// Stores a search result. The entry of the same key is overwritten, otherwise
+// the entry replaced is the one of the oldest generation and smallest depth.
+void
+store_table (TranspositionTable *table, bboard key, int move, int score, int depth, int bound)
+{
+  TranspositionEntry *cluster = table->entries + (key & table->mask) * CLUSTER_SIZE;
+  TranspositionEntry *replace = cluster;
+  int worst = 0x7fffffff;
+  for (int i = 0; i < CLUSTER_SIZE; i++)
+    {
+      uint64_t data = cluster[i].data;
+      if ((cluster[i].check ^ data) == key)
+        {
+          // Keep the move of a previous search if this one has none
+          if (!move)
+            move = ENTRY_MOVE (data);
+          replace = cluster + i;
+          break;
+        }
+      int age = (unsigned char) (table->generation - ENTRY_GENERATION (data));
+      int value = data ? ENTRY_DEPTH (data) - 8 * age : -0x7fffffff;
+      if (value < worst)
+        {
+          worst = value;
+          replace = cluster + i;
+        }
+    }
+  if (depth < 0)
+    depth = 0;
+  uint64_t data = (uint64_t) (move & 0xffff)
+    | (uint64_t) (uint16_t) score << 16
+    | (uint64_t) (depth & 0xff) << 32
+    | (uint64_t) bound << 40
+    | (uint64_t) table->generation << 48;
+  replace->data = data;
+  replace->check = key ^ data;
+}
@@ -0,0 +1,64 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <stdint.h>
+#include "common.h"
+#include "board.h"
+
+#define DEFAULT_HASH_MB 16
+#define MAX_HASH_MB 4096
+#define CLUSTER_SIZE 4
+
+// Bounds of a stored score.
+#define EXACT_BOUND 1
+#define LOWER_BOUND 2
+#define UPPER_BOUND 3
+
+// An entry of the transposition table. data packs the move (bits 0-15), the
+// score (bits 16-31), the depth (bits 32-39), the bound (bits 40-41) and the
+// generation (bits 48-55). check is key ^ data: the two words are written
+// without locks, so a probe that reads an entry while another thread is
+// storing it sees a check that does not match and ignores the entry.
+typedef struct
+{
+  volatile uint64_t check;
+  volatile uint64_t data;
+} TranspositionEntry;
+
+// A fixed size table of clusters of CLUSTER_SIZE entries, the number of
+// clusters is a power of two. The table is shared by concurrent searches; refs
+// counts the searches using it, the owner included.
+typedef struct
+{
+  TranspositionEntry *entries;
+  size_t mask;
+  size_t size_mb;
+  unsigned char generation;
+  int refs;
+} TranspositionTable;
+
+// A probed entry, unpacked.
+typedef struct
+{
+  int move;
+  int score;
+  int depth;
+  int bound;
+} TranspositionProbe;
+
+TranspositionTable* new_table (size_t size_mb);
+void retain_table (TranspositionTable *table);
+void release_table (TranspositionTable *table);
+void clear_table (TranspositionTable *table);
+void new_generation (TranspositionTable *table);
+bool probe_table (TranspositionTable *table, bboard key, TranspositionProbe *probe);
+void store_table (TranspositionTable *table, bboard key, int move, int score, int depth, int bound);
+
+#endif
@@ -0,0 +1,304 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+// A chess engine speaking the Universal Chess Interface protocol on stdin and
+// stdout, built on the move generator and the search of the library. Compiled
+// by MakefileC as chess-uci; it is not part of the Ruby extension (see
+// extconf.rb).
+
+// Threads are POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <time.h>
+#include "game.h"
+#include "search.h"
+#include "book.h"
+
+#define LINE_SIZE 16384
+
+// State of the engine. The search runs in its own thread, so that stop,
+// isready and quit are answered while searching. An infinite search holds its
+// bestmove until stop.
+static Board board;
+static bboard history[BUFFER_SIZE];
+static int history_size;
+static Search current_search;
+static pthread_t search_thread;
+static bool searching;
+static bool infinite;
+static TranspositionTable *table;
+static int threads = 1;
+
+// Writes the move in UCI notation (e2e4, e7e8q) in s.
+static void
+move_to_uci (int move, char *s)
+{
+  s[0] = square_to_file (MOVE_FROM (move));
+  s[1] = square_to_rank (MOVE_FROM (move));
+  s[2] = square_to_file (MOVE_TO (move));
+  s[3] = square_to_rank (MOVE_TO (move));
+  s[4] = tolower (promotion_to_char (MOVE_PROMOTION (move)));
+  s[5] = '\0';
+}
+
+// Returns the legal move of the board written in UCI notation, 0 if the move
+// is not legal.
+static int
+uci_to_move (Board *board, const char *s)
+{
+  if (strlen (s) < 4)
+    return 0;
+  int from = coord_to_square (s);
+  int to = coord_to_square (s + 2);
+  int promotion = s[4] ? char_to_promotion (s[4]) : 0;
+  int moves[MAX_MOVES];
+  int n = legal_moves (board, moves);
+  for (int i = 0; i < n; i++)
+    if (moves[i] == MOVE (from, to, promotion))
+      return moves[i];
+  return 0;
+}
+
+// Prints the result of a completed iteration.
+static void
+report (Search *search)
+{
+  char move[6];
+  move_to_uci (search->best_move, move);
+  long time = elapsed_ms (search);
+  unsigned long long nps = time > 0 ? search->nodes * 1000 / time : search->nodes;
+  if (search->score >= MATE_SCORE - MAX_PLY)
+    printf ("info depth %d score mate %d", search->depth, (MATE_SCORE - search->score + 1) / 2);
+  else if (search->score <= -MATE_SCORE + MAX_PLY)
+    printf ("info depth %d score mate -%d", search->depth, (MATE_SCORE + search->score) / 2);
+  else
+    printf ("info depth %d score cp %d", search->depth, search->score);
+  printf (" nodes %llu nps %llu time %ld pv %s\n", search->nodes, nps, time, move);
+  fflush (stdout);
+}
+
+static void*
+run_search (void *data)
+{
+  int best = parallel_search (&board, &current_search, threads);
+  // The search also ends by itself on a mate or a single legal move
+  struct timespec pause = { 0, 1000000 };
+  while (infinite && !current_search.stop)
+    nanosleep (&pause, NULL);
+  if (best)
+    {
+      char move[6];
+      move_to_uci (best, move);
+      printf ("bestmove %s\n", move);
+    }
+  else
+    printf ("bestmove 0000\n");
+  fflush (stdout);
+  return NULL;
+}
+
+// Waits for the bestmove of the running search, if any.
+static void
+wait_search (void)
+{
+  if (!searching)
+    return;
+  pthread_join (search_thread, NULL);
+  searching = FALSE;
+}
+
+// Stops the running search, if any, and waits for its bestmove.
+static void
+stop_search (void)
+{
+  if (searching)
+    current_search.stop = 1;
+  wait_search ();
+}
+
+// position [startpos | fen <fen>] [moves <move>...]
+static void
+set_position (char *args)
+{
+  char *moves = strstr (args, "moves");
+  if (moves)
+    *(moves - 1) = '\0';
+  Board new_board;
+  if (strncmp (args, "fen ", 4) == 0)
+    {
+      bool valid = valid_fen (args + 4);
+      if (valid)
+        {
+          parse_fen (args + 4, &new_board);
+          valid = valid_position (&new_board);
+        }
+      // An invalid position keeps the previous one
+      if (!valid)
+        {
+          printf ("info string invalid fen\n");
+          return;
+        }
+      memcpy (&board, &new_board, sizeof (Board));
+    }
+  else
+    init_board (&board);
+  history_size = 0;
+  if (!moves)
+    return;
+  for (char *s = strtok (moves + 5, " \n"); s; s = strtok (NULL, " \n"))
+    {
+      int move = uci_to_move (&board, s);
+      if (!move || !make_move (&board, MOVE_FROM (move), MOVE_TO (move), promotion_to_char (MOVE_PROMOTION (move)), &new_board, NULL))
+        {
+          printf ("info string illegal move %s\n", s);
+          break;
+        }
+      if (history_size < BUFFER_SIZE)
+        history[history_size++] = polyglot_key (&board);
+      memcpy (&board, &new_board, sizeof (Board));
+    }
+}
+
+// go [depth <n>] [nodes <n>] [movetime <ms>] [wtime <ms>] [btime <ms>]
+//    [winc <ms>] [binc <ms>] [movestogo <n>] [infinite]
+static void
+go (char *args)
+{
+  int depth = 0;
+  unsigned long long nodes = 0;
+  long movetime = 0;
+  long clock[2] = { 0, 0 };
+  long increment[2] = { 0, 0 };
+  long moves_to_go = 30;
+  infinite = FALSE;
+  char *s = strtok (args, " \n");
+  while (s)
+    {
+      char *value = strtok (NULL, " \n");
+      if (strcmp (s, "depth") == 0 && value)
+        depth = atoi (value);
+      else if (strcmp (s, "nodes") == 0 && value)
+        nodes = strtoull (value, NULL, 10);
+      else if (strcmp (s, "movetime") == 0 && value)
+        movetime = atol (value);
+      else if (strcmp (s, "wtime") == 0 && value)
+        clock[WHITE] = atol (value);
+      else if (strcmp (s, "btime") == 0 && value)
+        clock[BLACK] = atol (value);
+      else if (strcmp (s, "winc") == 0 && value)
+        increment[WHITE] = atol (value);
+      else if (strcmp (s, "binc") == 0 && value)
+        increment[BLACK] = atol (value);
+      else if (strcmp (s, "movestogo") == 0 && value)
+        moves_to_go = atol (value) > 0 ? atol (value) : 1;
+      else
+        {
+          // A flag without value (infinite, ponder)
+          if (strcmp (s, "infinite") == 0)
+            infinite = TRUE;
+          s = value;
+          continue;
+        }
+      s = strtok (NULL, " \n");
+    }
+  // Time management: an equal share of the clock plus half of the increment
+  int color = board.active_color;
+  if (!movetime && clock[color] > 0)
+    {
+      movetime = clock[color] / moves_to_go + increment[color] / 2;
+      if (movetime > clock[color] / 2)
+        movetime = clock[color] / 2;
+      if (movetime < 1)
+        movetime = 1;
+    }
+  if (!table)
+    table = new_table (DEFAULT_HASH_MB);
+  init_search (&current_search, depth, nodes, movetime, table);
+  current_search.history = history;
+  current_search.history_size = history_size;
+  current_search.report = report;
+  searching = pthread_create (&search_thread, NULL, run_search, NULL) == 0;
+  if (!searching)
+    {
+      // Nobody could send stop
+      infinite = FALSE;
+      run_search (NULL);
+    }
+}
+
+// setoption name <name> value <value>
+static void
+set_option (char *args)
+{
+  char *name = strstr (args, "name ");
+  char *value = strstr (args, " value ");
+  if (!name || !value)
+    return;
+  *value = '\0';
+  name += 5;
+  value += 7;
+  if (strcmp (name, "Hash") == 0 && atoi (value) > 0 && atoi (value) <= MAX_HASH_MB)
+    {
+      if (table)
+        release_table (table);
+      table = new_table (atoi (value));
+    }
+  else if (strcmp (name, "Threads") == 0 && atoi (value) > 0 && atoi (value) <= MAX_THREADS)
+    threads = atoi (value);
+}
+
+int
+main (void)
+{
+  init_board (&board);
+  char line[LINE_SIZE];
+  while (fgets (line, LINE_SIZE, stdin))
+    {
+      line[strcspn (line, "\r\n")] = '\0';
+      if (strcmp (line, "uci") == 0)
+        {
+          printf ("id name chess\n");
+          printf ("id author Enrico Pilotto\n");
+          printf ("option name Hash type spin default %d min 1 max %d\n", DEFAULT_HASH_MB, MAX_HASH_MB);
+          printf ("option name Threads type spin default 1 min 1 max %d\n", MAX_THREADS);
+          printf ("uciok\n");
+        }
+      else if (strcmp (line, "isready") == 0)
+        printf ("readyok\n");
+      else if (strcmp (line, "ucinewgame") == 0)
+        {
+          wait_search ();
+          if (table)
+            clear_table (table);
+        }
+      else if (strncmp (line, "setoption ", 10) == 0)
+        {
+          wait_search ();
+          set_option (line + 10);
+        }
+      else if (strncmp (line, "position ", 9) == 0)
+        {
+          wait_search ();
+          set_position (line + 9);
+        }
+      else if (strncmp (line, "go", 2) == 0 && (line[2] == ' ' || line[2] == '\0'))
+        {
+          wait_search ();
+          go (line + 2);
+        }
+      else if (strcmp (line, "stop") == 0)
+        stop_search ();
+      else if (strcmp (line, "quit") == 0)
+        break;
+      fflush (stdout);
+    }
+  stop_search ();
+  if (table)
+    release_table (table);
+  return 0;
+}
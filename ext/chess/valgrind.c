@@ -0,0 +1,115 @@
+/*
+ * chess - a fast library to play chess in Ruby
+ *
+ * Copyright (c) 2011-2018, Enrico Pilotto <epilotto@gmx.com>
+ * This code is under LICENSE LGPLv3
+ */
+
+// Compiled by MakefileC as the chess binary; it is not part of the Ruby
+// extension (see extconf.rb).
+
+#include "game.h"
+
+///////////////////////////////////
+// MAIN (only for internal test) //
+///////////////////////////////////
+int
+main ()
+{
+  // Valgrind run
+  int from, to;
+
+  for (int i = 0; i < 1000; i++)
+    {
+      Game *g = init_game ();
+      Board *board;
+      char *fen;
+
+      // 1. e4 a6 2. Bc4 a5 3. Qh5 a4 4. Qxf7#
+      board = current_board (g);
+      get_coord (board, 'P', NULL, "e4", '\0', &from, &to);
+      pseudo_legal_move (board, from, to);
+      apply_move (g, from, to, 0);
+      fen = to_fen (board);
+      free (fen);
+
+      board = current_board (g);
+      get_coord (board, 'P', NULL, "a6", '\0', &from, &to);
+      pseudo_legal_move (board, from, to);
+      apply_move (g, from, to, '\0');
+      fen = to_fen (current_board (g));
+      free (fen);
+
+      board = current_board (g);
+      get_coord (board, 'B', NULL, "c4", '\0', &from, &to);
+      pseudo_legal_move (board, from, to);
+      apply_move (g, from, to, '\0');
+      fen = to_fen (current_board (g));
+      free (fen);
+
+      board = current_board (g);
+      get_coord (board, 'P', NULL, "a5", '\0', &from, &to);
+      pseudo_legal_move (board, from, to);
+      apply_move (g, from, to, '\0');
+      fen = to_fen (current_board (g));
+      free (fen);
+
+      board = current_board (g);
+      get_coord (board, 'Q', NULL, "h5", '\0', &from, &to);
+      pseudo_legal_move (board, from, to);
+      apply_move (g, from, to, '\0');
+      fen = to_fen (current_board (g));
+      free (fen);
+
+      board = current_board (g);
+      get_coord (board, 'P', NULL, "a4", '\0', &from, &to);
+      pseudo_legal_move (board, from, to);
+      apply_move (g, from, to, '\0');
+      fen = to_fen (current_board (g));
+      free (fen);
+
+      board = current_board (g);
+      get_coord (board, 'Q', NULL, "f7", '\0', &from, &to);
+      pseudo_legal_move (board, from, to);
+      apply_move (g, from, to, '\0');
+      fen = to_fen (current_board (g));
+      free (fen);
+
+      // board = current_board (g);
+      // printf("%s\n", print_board (board));
+
+      // Copies share the plies: roll back and play on both, free in any order
+      Game *copy = copy_game (g);
+      rollback (g);
+      rollback (copy);
+      rollback (copy);
+      board = current_board (copy);
+      get_coord (board, 'P', NULL, "a4", '\0', &from, &to);
+      apply_move (copy, from, to, '\0');
+      Game *copy2 = copy_game (copy);
+
+      // Variations: 1... c5 2. Nf3 with 2. Nc3, promoted, copied and pruned
+      Variation *v = add_variation (copy2, NULL, 1);
+      board = line_board (copy2, v, -1);
+      get_coord (board, 'P', NULL, "c5", '\0', &from, &to);
+      variation_apply_move (copy2, v, from, to, '\0');
+      board = line_board (copy2, v, 0);
+      get_coord (board, 'N', NULL, "f3", '\0', &from, &to);
+      variation_apply_move (copy2, v, from, to, '\0');
+      Variation *nested = add_variation (copy2, v, 1);
+      board = line_board (copy2, nested, -1);
+      get_coord (board, 'N', NULL, "c3", '\0', &from, &to);
+      variation_apply_move (copy2, nested, from, to, '\0');
+      promote_variation (copy2, v);
+      Game *copy3 = copy_game (copy2);
+      remove_variation (copy3, line_variations (copy3, NULL)->items[0]);
+      rollback (copy2);
+      rollback (copy2);
+      free_game (copy3);
+      rollback (copy);
+      free_game (copy);
+      free_game (g);
+      free_game (copy2);
+    }
+  return 0;
+}
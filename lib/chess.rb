@@ -1,8 +1,13 @@
 require 'chess/chess' # this is the compiled ruby extension (chess.so or chess.bundle)
+require_relative 'chess/book'
+require_relative 'chess/database'
 require_relative 'chess/exceptions'
+require_relative 'chess/explorer'
 require_relative 'chess/game'
 require_relative 'chess/gnuchess'
 require_relative 'chess/pgn'
+require_relative 'chess/uci'
+require_relative 'chess/variation'
 require_relative 'chess/version'
 
 # While development to require 'chess' from irb run with `irb -I lib:ext`
@@ -0,0 +1,39 @@
+module Chess
+  # This class rappresents a Polyglot opening book.
+  class Book
+    # Opens a Polyglot opening book. With a block, yields the book and closes
+    # it when the block returns.
+    # @param [String] path The path of the `.bin` book.
+    # @return [Book]
+    # @raise [InvalidBinaryFormatError]
+    def self.open(path)
+      book = new(path)
+      return book unless block_given?
+
+      begin
+        yield book
+      ensure
+        book.close
+      end
+    end
+
+    # Picks a book move of the position of the board at random, with a
+    # probability proportional to its weight. Moves with weight 0 are never
+    # picked.
+    # @param [Board] board The board to look up.
+    # @param [Random] random The random number generator.
+    # @return [String, nil] The short algebraic chess notation of the move or
+    #   `nil` if the position is not in the book.
+    def random_move(board, random: Random)
+      moves = entries(board)
+      total = moves.sum { |m| m[:weight] }
+      return nil if total.zero?
+
+      r = random.rand(total)
+      moves.each do |m|
+        r -= m[:weight]
+        return m[:move] if r.negative?
+      end
+    end
+  end
+end
@@ -0,0 +1,101 @@
+require 'etc'
+
+module Chess
+  # Tools for collections of games.
+  module Database
+    # A game that failed the validation.
+    # @!attribute [r] path
+    #   @return [String] The path of the PGN file.
+    # @!attribute [r] game
+    #   @return [Integer] The number of the game in the file, from 1 (0 if the
+    #     file has no games).
+    # @!attribute [r] ply
+    #   @return [Integer, nil] The ply of the move that failed, from 1, `nil`
+    #     if the failure is not about a move.
+    # @!attribute [r] move
+    #   @return [String, nil] The move or the token that failed.
+    # @!attribute [r] reason
+    #   @return [Symbol] The reason of the failure, one of `:unreadable_file`,
+    #     `:invalid_pgn`, `:illegal_move`, `:wrong_check`, `:wrong_checkmate`,
+    #     `:wrong_result`, `:not_checkmate`, `:wrong_winner`, `:not_stalemate`,
+    #     `:not_threefold_repetition`, `:not_fifty_move_rule`,
+    #     `:not_insufficient_material`, `:not_illegal_move` and
+    #     `:not_invalid_pgn`.
+    Failure = Struct.new(:path, :game, :ply, :move, :reason) do
+      def to_s
+        "#{path}: game #{game}#{", ply #{ply} (#{move})" if ply}: #{reason}"
+      end
+    end
+
+    # The result of {Database.validate}.
+    # @!attribute [r] games
+    #   @return [Integer] The number of games replayed.
+    # @!attribute [r] plies
+    #   @return [Integer] The number of plies played.
+    # @!attribute [r] seconds
+    #   @return [Float] The time taken.
+    # @!attribute [r] failures
+    #   @return [Hash{String => Array<Failure>}] The failures grouped by
+    #     category, the name of the directory of the files.
+    Report = Struct.new(:games, :plies, :seconds, :failures) do
+      # @return [Float]
+      def games_per_second
+        seconds.positive? ? games / seconds : 0.0
+      end
+
+      # @return [Float]
+      def plies_per_second
+        seconds.positive? ? plies / seconds : 0.0
+      end
+
+      # Returns true if no game failed.
+      # @return [Boolean]
+      def success?
+        failures.empty?
+      end
+
+      def to_s
+        lines = [format('%d games, %d plies in %.2fs (%.0f games/s, %.0f plies/s)',
+                        games, plies, seconds, games_per_second, plies_per_second)]
+        failures.each do |category, list|
+          lines << "#{category}: #{list.size} failures"
+          lines.concat(list.map { |failure| "  #{failure}" })
+        end
+        lines.join("\n")
+      end
+    end
+
+    # Replays the games of PGN collections on a pool of native threads and
+    # checks that they are valid: the moves must be legal and the check (`+`)
+    # and checkmate (`#`) suffixes right. The games must also end as the
+    # directories in the paths of their files say, as in the test collection:
+    # games in a `checkmate` directory (`white_won`, `black_won`) must end with
+    # a checkmate, in a `stalemate`, `threefold_repetition`, `fifty_move_rule`
+    # or `insufficient_material` directory with that draw, while a file in an
+    # `illegal` or `invalid` directory must have a game with an illegal move or
+    # that is not valid PGN. In the other directories the result of a game
+    # decided on the board must match the one of the PGN.
+    # @param [String, Array<String>] paths The PGN files and the directories
+    #   to search for `.pgn` files.
+    # @param [Integer] threads The number of threads.
+    # @return [Report]
+    # @example
+    #   report = Chess::Database.validate('test/pgn_collection')
+    #   puts report
+    def self.validate(paths, threads: Etc.nprocessors)
+      files = Array(paths).flat_map do |path|
+        path = path.to_s
+        File.directory?(path) ? Dir[File.join(path, '**', '*.pgn')].sort : [path]
+      end
+      start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      games, plies, failures = validate_files(files, threads)
+      seconds = Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+      failures = failures.sort_by { |failure| failure.first(3) }.map do |file, game, ply, move, reason|
+        Failure.new(files[file], game, ply.zero? ? nil : ply, move, reason)
+      end
+      Report.new(games, plies, seconds, failures.group_by { |failure| File.basename(File.dirname(failure.path)) })
+    end
+
+    private_class_method :validate_files
+  end
+end
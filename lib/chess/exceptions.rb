@@ -10,8 +10,8 @@ module Chess
 
   # This exception will be raised when a malformed PGN file is loaded.
   class InvalidPgnFormatError < StandardError
-    def initialize
-      super('Invalid PGN format')
+    def initialize(msg = 'Invalid PGN format')
+      super
     end
   end
 
@@ -22,4 +22,20 @@ module Chess
       super("Invalid FEN string '#{fen_string}'")
     end
   end
+
+  # This exception will be raised when loading an invalid binary game.
+  class InvalidBinaryFormatError < StandardError
+    def initialize(msg = 'Invalid binary format')
+      super
+    end
+  end
+
+  # This exception will be raised when a UCI engine exits or does not speak
+  # the UCI protocol.
+  class UCIError < StandardError
+  end
+
+  # This exception will be raised when a UCI engine does not answer in time.
+  class UCITimeoutError < UCIError
+  end
 end
@@ -0,0 +1,58 @@
+require 'etc'
+
+module Chess
+  # This class rappresents an opening explorer built from game collections.
+  class Explorer
+    # Builds an explorer file indexing all positions of the games, and returns
+    # the explorer. Games are parsed and replayed by a pool of native threads
+    # without holding the GVL, each PGN file split in chunks where a game
+    # starts.
+    # @param [String] path The path of the explorer file to write.
+    # @param [Array<String,Game>] sources The games to index: {Game} objects,
+    #   paths of PGN files (`.pgn`, one or more games each) or paths of binary
+    #   collections. A binary collection is a sequence of games in the format
+    #   of {Game#to_binary}, each prefixed by its size as 16 bits little endian
+    #   integer.
+    # @param [Integer] threads The number of threads used to replay the games.
+    # @param [Integer] max_plies If set, index only the first `max_plies` plies
+    #   of each game.
+    # @return [Explorer]
+    # @raise [InvalidPgnFormatError]
+    # @raise [IllegalMoveError]
+    # @raise [InvalidBinaryFormatError]
+    # @note Games without a result are not indexed. The games of a PGN file
+    #   start from the position of their FEN tag, if any.
+    def self.build(path, sources, threads: Etc.nprocessors, max_plies: nil)
+      games = []
+      pgns = []
+      sources.each do |source|
+        if source.is_a?(Chess::Game)
+          games << source.to_binary
+        elsif File.extname(source).casecmp?('.pgn')
+          pgns << source.to_s
+        else
+          games.concat(load_collection(source))
+        end
+      end
+      write(path, [collect(games, pgns, max_plies, threads)])
+      return new(path)
+    end
+
+    # Returns the games of a binary collection.
+    def self.load_collection(path)
+      data = File.binread(path)
+      games = []
+      offset = 0
+      while offset < data.bytesize
+        size = data.unpack1('v', offset: offset)
+        raise InvalidBinaryFormatError.new if size.nil? || offset + 2 + size > data.bytesize
+
+        games << data.byteslice(offset + 2, size)
+        offset += 2 + size
+      end
+      games
+    end
+
+    private_class_method :collect, :write, :load_collection
+  end
+end
@@ -16,9 +16,18 @@ module Chess
     # @raise [IllegalMoveError]
     # @raise [BadNotationError]
     def self.load_pgn(file)
-      pgn = Chess::Pgn.new(file)
+      from_pgn(Chess::Pgn.new(file))
+    end
+
+    # Creates a new game from a {Pgn}, with its variations.
+    # @param [Pgn] pgn The PGN to load.
+    # @return [Game]
+    # @raise [IllegalMoveError]
+    # @raise [BadNotationError]
+    def self.from_pgn(pgn)
       game = Chess::Game.new
       pgn.moves.each { |m| game.move(m) }
+      game.send(:add_pgn_variations, [], pgn.variations)
       unless game.over?
         case pgn.result
         when '1-0'
@@ -130,21 +139,76 @@ module Chess
       return self.result != '*'
     end
 
-    # Returns the PGN rappresenting the game.
+    # Returns the PGN rappresenting the game, with its variations.
     # @return [Chess::Pgn]
     def pgn
       pgn = Chess::Pgn.new
       pgn.moves = self.moves
+      pgn.variations = self.variations.map(&:to_pgn)
       pgn.result = self.result
       return pgn
     end
 
+    # Adds a variation that replaces the move at index `ply` of the main line.
+    # @param [Integer] ply The index of the move to replace.
+    # @param [Array<String>] moves The moves of the new variation.
+    # @return [Variation]
+    # @raise [IllegalMoveError]
+    # @raise [BadNotationError]
+    # @example
+    #   game = Chess::Game.new(%w[e4 e5 Nf3])
+    #   game.add_variation(1, %w[c5 Nf3 d6])
+    def add_variation(ply, moves = [])
+      add_variation_to([], ply, moves)
+    end
+
+    # Returns the variations that branch from the main line.
+    # @return [Array<Variation>]
+    def variations
+      Array.new(variation_info([])[4]) { |i| Variation.new(self, [i]) }
+    end
+
+    # Calls the block for each variation of the game, depth first.
+    # @yield [variation]
+    # @return [Enumerator] Returns an enumerator if no block is given.
+    def each_variation(&block)
+      return enum_for(:each_variation) unless block
+
+      variations.each do |variation|
+        yield variation
+        variation.each_variation(&block)
+      end
+      self
+    end
+
     private
 
-    # Expand the short algebraic chess notation string `notation` in a hash like this:
+    def add_variation_to(path, ply, moves)
+      variation = Variation.new(self, path + [variation_add(path, ply)])
+      begin
+        moves.each { |m| variation.move(m) }
+      rescue StandardError
+        variation.remove!
+        raise
+      end
+      variation
+    end
+
+    def add_pgn_variations(path, variations)
+      variations.each do |pgn_variation|
+        variation = add_variation_to(path, pgn_variation.ply, pgn_variation.moves)
+        add_pgn_variations(variation.path, pgn_variation.variations)
+      end
+    end
+
+    # Expand the short algebraic chess notation string `notation`, a move on
+    # `board` (the current board of the game if nil), in a hash like this:
     #
     #     Ngxe2 ==> { name: 'N', dis: 'g', from: nil, to: 'e2', promotion: nil }
-    def expand_move(notation)
+    #
+    # The board is needed only by castling moves, so it is looked up only for
+    # them.
+    def expand_move(notation, board = nil)
       if (match = notation.match(MOVE_REGEXP))
         expand = {
           name: match[1] || 'P',    # Piece name [RNBQK]
@@ -155,20 +219,23 @@ module Chess
         expand[:from] = match[2] if match[2] && match[2].size == 2
 
         # Support UCI protocol (Lichess)
-        uci_to_coord = uci_castling_to_coord(expand[:from], expand[:to])
-        expand[:to] = uci_to_coord if uci_to_coord
+        if %w[e1 e8].include?(expand[:from])
+          uci_to_coord = uci_castling_to_coord(expand[:from], expand[:to], board || self.board)
+          expand[:to] = uci_to_coord if uci_to_coord
+        end
 
         return expand
       end
 
+      board ||= self.board
       # Castling notation
       if SHORT_CASTLING_REGEXP.match?(notation)
-        return { name: 'K', dis: nil, from: 'e8', to: 'g8', promotion: nil } if self.board.active_color # black king short castling
+        return { name: 'K', dis: nil, from: 'e8', to: 'g8', promotion: nil } if board.active_color # black king short castling
 
         return { name: 'K', dis: nil, from: 'e1', to: 'g1', promotion: nil } # white king short castling
       end
       if LONG_CASTLING_REGEXP.match?(notation)
-        return { name: 'K', dis: nil, from: 'e8', to: 'c8', promotion: nil } if self.board.active_color # black king long castling
+        return { name: 'K', dis: nil, from: 'e8', to: 'c8', promotion: nil } if board.active_color # black king long castling
 
         return { name: 'K', dis: nil, from: 'e1', to: 'c1', promotion: nil } # white king long castling
       end
@@ -178,11 +245,11 @@ module Chess
 
     # Support Castling notation valid in UCI (Universal Chess Interface)
     # protocol (Lichess)
-    def uci_castling_to_coord(from, to)
-      if from == 'e1' && self.board['e1'] == 'K'
+    def uci_castling_to_coord(from, to, board)
+      if from == 'e1' && board['e1'] == 'K'
         return 'g1' if to == 'h1' # UCI protocol (Lichess) white king short castling
         return 'c1' if to == 'a1' # UCI protocol (Lichess) white king long castling
-      elsif from == 'e8' && self.board['e8'] == 'k'
+      elsif from == 'e8' && board['e8'] == 'k'
         return 'g8' if to == 'h8' # UCI protocol (Lichess) black king short castling
         return 'c8' if to == 'a8' # UCI protocol (Lichess) black king long castling
       end
@@ -5,6 +5,9 @@ module Chess
   #
   # To use this module, extend a game object with {Chess::Gnuchess}.
   # @note Gnuchess binary have to be installed.
+  # @see Board#best_move Board#best_move for the built-in engine, that needs no
+  #   external binary.
+  # @see UCI::Pool UCI::Pool to keep UCI engines running between moves.
   # @example
   #   g = Chess::Game.new
   #   g.extend Chess::Gnuchess
@@ -2,7 +2,17 @@ module Chess
   # Rappresents a game in PGN (Portable Game Notation) format.
   class Pgn
     # Array that include PGN standard tags.
-    TAGS = %w[event site date round white black result].freeze
+    TAGS = Ractor.make_shareable(%w[event site date round white black result])
+
+    # A variation of a PGN, see {Chess::Variation}.
+    # @!attribute [rw] ply
+    #   @return [Integer] The index of the move replaced by the variation in
+    #     its parent line.
+    # @!attribute [rw] moves
+    #   @return [Array<String>] The moves in short algebraic chess notation.
+    # @!attribute [rw] variations
+    #   @return [Array<Variation>] The variations of the variation.
+    Variation = Struct.new(:ply, :moves, :variations)
 
     # The name of the tournament or match event.
     # @return [String]
@@ -32,12 +42,16 @@ module Chess
     # The array with all moves done in short algebraic chess notation.
     # @return [Array<String>]
     attr_accessor :moves
+    # The variations of the moves, the ones in parentheses in the PGN.
+    # @return [Array<Variation>]
+    attr_accessor :variations
 
     # @param [String] filename The path of the PGN file.
     # @param [Boolean] check_moves If true check if the moves are legal.
     # @raise [InvalidPgnFormatError]
     # @raise [IllegalMoveError]
     def initialize(filename = nil, check_moves: false)
+      @variations = []
       self.load(filename, check_moves: check_moves) if filename
       @date = '??'
     end
@@ -69,12 +83,8 @@ module Chess
       raise Chess::InvalidPgnFormatError.new if game_index.nil?
 
       game = fen[game_index..].strip
-      @moves = game.tr("\n", ' ').split(/\d+\./).collect(&:strip)[1..].map(&:split).flatten
-      @moves.delete_at(@moves.size - 1) if @moves.last.match?(/(0-1)|(1-0)|(1\/2)|(1\/2-1\/2)|(\*)/)
-      @moves.each do |m|
-        raise Chess::InvalidPgnFormatError.new if m !~ MOVE_REGEXP && m !~ SHORT_CASTLING_REGEXP && m !~ LONG_CASTLING_REGEXP
-      end
-      Chess::Game.new(@moves) if check_moves
+      @moves, @variations = parse_movetext(game)
+      Chess::Game.from_pgn(self) if check_moves
       return self
     end
 
@@ -86,11 +96,7 @@ module Chess
         s << "[#{t.capitalize} \"#{tag}\"]\n"
       end
       s << "\n"
-      m = []
-      @moves.each_with_index do |move, i|
-        m << "#{(i / 2) + 1}. " if i.even?
-        m << "#{move} "
-      end
+      m = movetext(@moves, @variations || [], 0)
       m << @result unless @result.nil?
       s << m.join.gsub(/(.{1,78})(?: +|$)\n?|(.{78})/, "\\1\\2\n")
       return s.join
@@ -102,6 +108,89 @@ module Chess
       File.write(filename, self.to_s)
     end
 
+    private
+
+    # Returns the moves of the main line and its variations. Move numbers and
+    # NAGs are skipped, a variation in parentheses replaces the move before.
+    def parse_movetext(movetext)
+      return parse_main_line(movetext) unless movetext.match?(/[()]/)
+
+      lines = [[[], []]]
+      movetext.scan(/[()]|[^\s()]+/).each do |token|
+        case token
+        when '('
+          moves, variations = lines.last
+          raise Chess::InvalidPgnFormatError.new if moves.empty?
+
+          variation = Variation.new(moves.size - 1, [], [])
+          variations << variation
+          lines << [variation.moves, variation.variations]
+        when ')'
+          raise Chess::InvalidPgnFormatError.new if lines.size == 1
+
+          lines.pop
+        when /^\$\d+$/
+          next
+        else
+          move = token.sub(/^\d+\.+/, '')
+          lines.last.first << move unless move.empty?
+        end
+      end
+      raise Chess::InvalidPgnFormatError.new if lines.size > 1
+
+      moves, variations = lines.first
+      finish_movetext(moves, variations)
+    end
+
+    # Fast path of parse_movetext for a movetext without variations, the most
+    # common one: the same tokens without the scan.
+    def parse_main_line(movetext)
+      moves = movetext.gsub(/(?<!\S)\d+\.+/, ' ').split
+      moves.reject! { |move| move.match?(/^\$\d+$/) } if movetext.include?('$')
+      finish_movetext(moves, [])
+    end
+
+    def finish_movetext(moves, variations)
+      moves.delete_at(moves.size - 1) if moves.last&.match?(/(0-1)|(1-0)|(1\/2)|(1\/2-1\/2)|(\*)/)
+      check_moves_format(moves, variations)
+      return moves, variations
+    end
+
+    def check_moves_format(moves, variations)
+      moves.each do |m|
+        raise Chess::InvalidPgnFormatError.new if m !~ MOVE_REGEXP && m !~ SHORT_CASTLING_REGEXP && m !~ LONG_CASTLING_REGEXP
+      end
+      variations.each { |variation| check_moves_format(variation.moves, variation.variations) }
+    end
+
+    # Returns the tokens of the moves of a line starting at the ply start, with
+    # its variations after the moves they replace. Variations without moves
+    # are skipped.
+    def movetext(moves, variations, start)
+      m = []
+      number = true
+      moves.each_with_index do |move, i|
+        ply = start + i
+        if ply.even?
+          m << "#{(ply / 2) + 1}. "
+        elsif number
+          m << "#{(ply / 2) + 1}... "
+        end
+        m << "#{move} "
+        number = false
+        variations.select { |variation| variation.ply == i && !variation.moves.empty? }.each do |variation|
+          m << '('
+          m.concat(movetext(variation.moves, variation.variations, ply))
+          m[-1] = m[-1].rstrip
+          m << ') '
+          number = true
+        end
+      end
+      m
+    end
+
+    public
+
     # # @!visibility private
     # alias old_date= date=
 
@@ -0,0 +1,258 @@
+require 'etc'
+require 'io/wait'
+
+module Chess
+  # Clients of chess engines speaking the Universal Chess Interface protocol.
+  module UCI
+    # Seconds given to an engine to answer a `stop` or a `quit` command.
+    GRACE_PERIOD = 1
+
+    # A long-lived UCI engine process. Positions are sent as `position ...
+    # moves ...` commands built from the coordinate moves of the game, so that
+    # the engine keeps its state between the moves of the same game.
+    # @example
+    #   engine = Chess::UCI::Engine.new('stockfish')
+    #   g = Chess::Game.new
+    #   g.move(engine.best_move(g, movetime: 100))
+    #   engine.close
+    class Engine
+      # @return [Integer] The process id of the engine.
+      attr_reader :pid
+      # @return [String, nil] The name of the engine.
+      attr_reader :name
+      # @return [Array<String>] The `info` lines sent by the engine during the
+      #   last search.
+      attr_reader :info
+
+      # Starts the engine and waits until it is ready.
+      # @param [String, Array<String>] command The command that runs the engine.
+      # @param [Hash] options The UCI options to set (`setoption`).
+      # @param [Numeric] timeout Seconds to wait for the engine to start.
+      # @raise [UCIError] If the engine does not start.
+      def initialize(command, options: {}, timeout: 10)
+        @io = IO.popen(command, 'r+', err: File::NULL)
+        @pid = @io.pid
+        @buffer = +''
+        @info = []
+        @position = nil
+        write('uci')
+        read_until(timeout) do |line|
+          @name = line.delete_prefix('id name ') if line.start_with?('id name ')
+          line == 'uciok'
+        end
+        options.each { |name, value| write("setoption name #{name} value #{value}") }
+        ready(timeout)
+      rescue StandardError
+        close if @io
+        raise
+      end
+
+      # Asks the engine the best move of the current position of the game. If
+      # the engine does not answer in time it is asked to stop and its move is
+      # returned.
+      # @param [Game] game The game.
+      # @param [Integer] depth The search depth.
+      # @param [Integer] movetime The search time in milliseconds.
+      # @param [Numeric] timeout Seconds to wait for the answer.
+      # @return [String, nil] The move in coordinate notation, `nil` if there
+      #   are no legal moves.
+      # @raise [UCITimeoutError] If the engine does not answer even after the
+      #   stop.
+      # @raise [UCIError] If the engine exits.
+      def best_move(game, depth: nil, movetime: nil, timeout: 10)
+        position = position_command(game)
+        unless continuation?(position)
+          write('ucinewgame')
+          ready(timeout)
+        end
+        @position = position
+        write(position)
+        write(['go', depth && "depth #{depth}", movetime && "movetime #{movetime}"].compact.join(' '))
+        @info = []
+        line = begin
+          read_bestmove(timeout)
+        rescue UCITimeoutError
+          write('stop')
+          read_bestmove(GRACE_PERIOD)
+        end
+        move = line.split[1]
+        move.nil? || move == '(none)' || move == '0000' ? nil : move
+      end
+
+      # Returns the UCI `position` command of the current position of the game.
+      # @param [Game] game The game.
+      # @return [String]
+      def position_command(game)
+        moves = game.coord_moves
+        start = moves.rindex('SET BY FEN')
+        position = start ? "fen #{game[start].to_fen}" : 'startpos'
+        moves = moves[(start ? start + 1 : 0)..].map { |m| m.delete('=').downcase }
+        moves.empty? ? "position #{position}" : "position #{position} moves #{moves.join(' ')}"
+      end
+
+      # Quits the engine, killing it if it does not exit in time.
+      def close
+        return if @io.closed?
+
+        begin
+          write('quit')
+          deadline = now + GRACE_PERIOD
+          loop do
+            remaining = deadline - now
+            break Process.kill('KILL', @pid) if remaining <= 0 || !@io.wait_readable(remaining)
+
+            @io.readpartial(4096)
+          end
+        rescue EOFError, IOError, SystemCallError, UCIError
+          nil
+        end
+        @io.close
+      end
+
+      # @return [Boolean] True if the engine has been closed.
+      def closed?
+        @io.closed?
+      end
+
+      private
+
+      # True if the position follows the last one sent to the engine.
+      def continuation?(position)
+        return false unless @position
+        return true if position == @position
+
+        position.start_with?(@position.include?(' moves ') ? "#{@position} " : "#{@position} moves ")
+      end
+
+      def ready(timeout)
+        write('isready')
+        read_until(timeout) { |line| line == 'readyok' }
+      end
+
+      def read_bestmove(timeout)
+        read_until(timeout) do |line|
+          @info << line if line.start_with?('info')
+          line.start_with?('bestmove')
+        end
+      end
+
+      def write(command)
+        @io.puts(command)
+        @io.flush
+      rescue IOError, SystemCallError
+        raise UCIError, 'The engine has exited'
+      end
+
+      # Reads lines until the block returns true and returns that line.
+      def read_until(timeout)
+        deadline = now + timeout
+        loop do
+          while (i = @buffer.index("\n"))
+            line = @buffer.slice!(0..i).strip
+            return line if yield(line)
+          end
+          remaining = deadline - now
+          raise UCITimeoutError, 'The engine does not answer' if remaining <= 0 || !@io.wait_readable(remaining)
+
+          @buffer << @io.readpartial(4096)
+        end
+      rescue EOFError, IOError, SystemCallError
+        raise UCIError, 'The engine has exited'
+      end
+
+      def now
+        Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      end
+    end
+
+    # A pool of long-lived UCI engine processes shared by threads. Each request
+    # borrows an idle engine; an engine that fails is closed and restarted at
+    # the next request.
+    # @example
+    #   Chess::UCI::Pool.open('stockfish', size: 4) do |pool|
+    #     games.map { |g| Thread.new { pool.best_move(g, movetime: 100) } }.map(&:value)
+    #   end
+    class Pool
+      # @return [Integer] The number of engines.
+      attr_reader :size
+
+      # Starts a pool of engines. With a block, yields the pool and closes it
+      # when the block returns.
+      # @return [Pool]
+      def self.open(command, **)
+        pool = new(command, **)
+        return pool unless block_given?
+
+        begin
+          yield pool
+        ensure
+          pool.close
+        end
+      end
+
+      # Starts the engines.
+      # @param [String, Array<String>] command The command that runs an engine.
+      # @param [Integer] size The number of engines.
+      # @param [Hash] options The UCI options of the engines.
+      # @param [Numeric] timeout Default seconds to wait for an idle engine and
+      #   for its answer.
+      # @raise [UCIError] If an engine does not start.
+      def initialize(command, size: Etc.nprocessors, options: {}, timeout: 10)
+        @command = command
+        @size = size
+        @options = options
+        @timeout = timeout
+        @idle = Queue.new
+        size.times { @idle << start_engine }
+      rescue StandardError
+        @idle.pop.close until @idle.empty?
+        raise
+      end
+
+      # Borrows an idle engine for the block. If the block does not complete
+      # normally (it raises, or it is left with break or throw) the engine may
+      # be in the middle of a command, so it is closed and restarted by the
+      # next borrower.
+      # @param [Numeric] timeout Seconds to wait for an idle engine.
+      # @raise [UCITimeoutError] If all engines stay busy.
+      def with_engine(timeout: @timeout)
+        engine = @idle.pop(timeout: timeout)
+        raise UCITimeoutError, 'No engine available' if engine.nil?
+
+        completed = false
+        begin
+          engine = start_engine if engine.closed?
+          result = yield engine
+          completed = true
+          result
+        ensure
+          engine.close unless completed
+          @idle.closed? ? engine.close : @idle.push(engine)
+        end
+      end
+
+      # Asks an idle engine the best move of the current position of the game.
+      # @see Engine#best_move
+      # @return [String, nil] The move in coordinate notation.
+      def best_move(game, depth: nil, movetime: nil, timeout: @timeout)
+        with_engine(timeout: timeout) do |engine|
+          engine.best_move(game, depth: depth, movetime: movetime, timeout: timeout)
+        end
+      end
+
+      # Quits the engines, waiting for the busy ones at most the timeout.
+      def close
+        return if @idle.closed?
+
+        @size.times { @idle.pop(timeout: @timeout)&.close }
+        @idle.close
+      end
+
+      private
+
+      def start_engine
+        Engine.new(@command, options: @options)
+      end
+    end
+  end
+end
@@ -13,7 +13,7 @@ module Chess
   module UTF8Notation
     # Map a piece identifier character with the corresponding UTF8 chess
     # character
-    UTF8_MAP = {
+    UTF8_MAP = Ractor.make_shareable({
       'P' => '♙',
       'R' => '♖',
       'N' => '♘',
@@ -26,7 +26,7 @@ module Chess
       'b' => '♝',
       'q' => '♛',
       'k' => '♚'
-    }.freeze
+    })
 
     # Replace the piece identifier characters with UTF8 chess characters.
     # @return [String]
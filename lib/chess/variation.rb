@@ -0,0 +1,170 @@
+module Chess
+  # A line of moves alternative to a move of the main line of a {Game}, or of
+  # another variation. The variations of a game form a tree: each one starts
+  # from the position before the move it replaces and can have its own
+  # variations. The boards of a variation are stored in its game and only its
+  # own moves take memory.
+  #
+  # A variation is identified by its {path}, so a variation object refers to
+  # another variation once a variation before it in the same line is removed.
+  # @example
+  #   game = Chess::Game.new(%w[e4 e5 Nf3 Nc6])
+  #   sicilian = game.add_variation(1, %w[c5 Nf3])
+  #   sicilian.add_variation(1, %w[Nc3])
+  #   sicilian.moves # => ["c5", "Nf3"]
+  #   sicilian.promote!
+  #   game.moves # => ["e4", "c5", "Nf3"]
+  #   sicilian.moves # => ["e5", "Nf3", "Nc6"]
+  class Variation
+    # @return [Game] The game of the variation.
+    attr_reader :game
+    # @return [Array<Integer>] The indexes of the variation and of its parents
+    #   in the {variations} of their lines, starting from the main line.
+    attr_reader :path
+
+    # @param [Game] game The game of the variation.
+    # @param [Array<Integer>] path The path of the variation.
+    def initialize(game, path)
+      @game = game
+      @path = path.freeze
+    end
+
+    # Returns the index, in the parent line, of the move that the variation
+    # replaces.
+    # @return [Integer]
+    def ply
+      info[0]
+    end
+
+    # Returns the moves of the variation in short algebraic chess notation.
+    # @return [Array<String>]
+    def moves
+      info[1]
+    end
+
+    # Returns the moves of the variation in coordinate chess notation.
+    # @return [Array<String>]
+    def coord_moves
+      info[2]
+    end
+
+    # Returns the result of the variation: `'*'` unless it ends with a
+    # checkmate or a draw.
+    # @return [String]
+    def result
+      info[3]
+    end
+
+    # Returns the number of moves of the variation.
+    # @return [Integer]
+    def size
+      moves.size
+    end
+
+    # Returns the board after the move at index, or before the first move of
+    # the variation if index is -1.
+    # @param [Integer] index
+    # @return [Board, nil]
+    def [](index)
+      @game.send(:variation_board, @path, index)
+    end
+
+    # Returns the board after the last move of the variation.
+    # @return [Board]
+    def board
+      self[size - 1]
+    end
+
+    # Returns the parent line: the variation this one branches from, `nil` if
+    # it branches from the main line of the game.
+    # @return [Variation, nil]
+    def parent
+      @path.size > 1 ? Variation.new(@game, @path[0..-2]) : nil
+    end
+
+    # Returns the variations that branch from this one.
+    # @return [Array<Variation>]
+    def variations
+      Array.new(info[4]) { |i| Variation.new(@game, @path + [i]) }
+    end
+
+    # Adds a variation that replaces the move at index ply of this one.
+    # @param [Integer] ply The index of the move to replace.
+    # @param [Array<String>] moves The moves of the new variation.
+    # @return [Variation]
+    # @raise [IllegalMoveError]
+    # @raise [BadNotationError]
+    def add_variation(ply, moves = [])
+      @game.send(:add_variation_to, @path, ply, moves)
+    end
+
+    # Makes a move at the end of the variation.
+    # @param [String] notation The move in short algebraic or coordinate chess
+    #   notation, as in {Game#move}.
+    # @return [String] Returns the move in short algebraic chess notation.
+    # @raise [IllegalMoveError]
+    # @raise [BadNotationError]
+    def move(notation)
+      expand = @game.send(:expand_move, notation, board)
+      if expand[:from]
+        @game.send(:variation_move, @path, nil, expand[:from], expand[:to], expand[:promotion])
+      else
+        @game.send(:variation_move, @path, expand[:name], expand[:dis], expand[:to], expand[:promotion])
+      end
+    rescue IllegalMoveError
+      raise IllegalMoveError.new("Illegal move '#{notation}'")
+    end
+    alias << move
+
+    # Makes the variation the continuation of its parent line. The moves it
+    # replaces, with their variations, become this variation. The variations
+    # of the parent line that branch after it move into it, so its {path} can
+    # change.
+    # @return [Variation] Returns `self`.
+    # @raise [ArgumentError] if the variation has no moves.
+    def promote!
+      @path = (@path[0..-2] + [@game.send(:variation_promote, @path)]).freeze
+      self
+    end
+
+    # Removes the variation, with its variations, from its parent line.
+    # @return [Game] Returns the game.
+    def remove!
+      @game.send(:variation_remove, @path)
+    end
+
+    # Calls the block for each variation of this one and of its variations,
+    # depth first.
+    # @yield [variation]
+    # @return [Enumerator] Returns an enumerator if no block is given.
+    def each_variation(&block)
+      return enum_for(:each_variation) unless block
+
+      variations.each do |variation|
+        yield variation
+        variation.each_variation(&block)
+      end
+      self
+    end
+
+    # Returns the variation as a {Pgn::Variation}.
+    # @return [Pgn::Variation]
+    def to_pgn
+      Pgn::Variation.new(ply, moves, variations.map(&:to_pgn))
+    end
+
+    def ==(other)
+      other.is_a?(Variation) && other.game.equal?(@game) && other.path == @path
+    end
+
+    def inspect
+      "#<#{self.class} #{@path.inspect} #{moves.join(' ')}>"
+    end
+
+    private
+
+    def info
+      @game.send(:variation_info, @path)
+    end
+  end
+end
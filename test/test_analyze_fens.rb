@@ -0,0 +1,93 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  def test_analyze_fens_matches_game
+    game = Chess::Game.load_pgn(File.join(__dir__, 'pgn_collection/valid/0001.pgn'))
+    boards = []
+    game.each { |board| boards << board }
+    results = Chess.analyze_fens(boards.map(&:to_fen))
+
+    assert_equal boards.size, results.size
+    boards.each_with_index do |board, i|
+      expected = {
+        legal_move_count: board.generate_all_moves.size,
+        check: board.check?,
+        checkmate: board.checkmate?,
+        stalemate: board.stalemate?,
+        fen: board.to_position.to_fen.split[0..3].join(' ') + " #{board.halfmove_clock} #{board.fullmove_number}",
+        polyglot_key: board.polyglot_key
+      }
+
+      assert_equal expected, results[i]
+    end
+  end
+
+  def test_analyze_fens_concurrent
+    fens = TestHelper.pgns('valid').sort.first(10).flat_map do |file|
+      game = Chess::Game.load_pgn(file)
+      boards = []
+      game.each { |board| boards << board.to_fen }
+      boards
+    end
+    expected = Chess.analyze_fens(fens)
+    threads = Array.new(4) { Thread.new { Array.new(5) { Chess.analyze_fens(fens) } } }
+
+    threads.each { |thread| thread.value.each { |results| assert_equal expected, results } }
+  end
+
+  def test_analyze_fens_terminal_positions
+    results = Chess.analyze_fens(
+      ['R5k1/5ppp/8/8/8/8/8/6K1 b - - 0 1', '7k/5Q2/6K1/8/8/8/8/8 b - - 0 1'],
+      fields: %i[checkmate stalemate legal_move_count]
+    )
+
+    assert_equal [
+      { checkmate: true, stalemate: false, legal_move_count: 0 },
+      { checkmate: false, stalemate: true, legal_move_count: 0 }
+    ], results
+    assert_equal %i[checkmate stalemate legal_move_count], results.first.keys
+  end
+
+  def test_analyze_fens_normalizes
+    fens = [
+      'rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1',
+      '4k3/8/8/8/8/8/8/R3K3 w KQkq - 3 20'
+    ]
+
+    assert_equal [
+      { fen: 'rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1' },
+      { fen: '4k3/8/8/8/8/8/8/R3K3 w Q - 3 20' }
+    ], Chess.analyze_fens(fens, fields: [:fen])
+  end
+
+  def test_analyze_fens_invalid
+    fens = [
+      'not a fen',
+      'rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0',
+      'rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1',
+      'rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1',
+      # Missing and extra kings
+      'rnbq1bnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQ - 0 1',
+      'rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBKKBNR w kq - 0 1',
+      # Pawn on the last rank
+      'P3k3/8/8/8/8/8/8/4K3 w - - 0 1',
+      # The side that has just moved is in check
+      '4k3/8/8/8/8/8/4R3/4K3 w - - 0 1',
+      'rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1'
+    ]
+    results = Chess.analyze_fens(fens, fields: [:check])
+
+    assert_equal [nil] * 8 + [{ check: false }], results
+  end
+
+  def test_analyze_fens_arguments
+    assert_empty Chess.analyze_fens([])
+    assert_equal [{}], Chess.analyze_fens([Chess::Game.new.board.to_fen], fields: [])
+    assert_equal [{ check: false }], Chess.analyze_fens([Chess::Game.new.board.to_fen], fields: %i[check check])
+    assert_raises(ArgumentError) { Chess.analyze_fens([], fields: [:hash]) }
+    assert_raises(ArgumentError) { Chess.analyze_fens([], depth: 1) }
+    assert_raises(TypeError) { Chess.analyze_fens([1]) }
+    assert_raises(TypeError) { Chess.analyze_fens('fen') }
+    assert_raises(ArgumentError) { Chess.analyze_fens(["fen\0"]) }
+  end
+end
@@ -0,0 +1,52 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  KNIGHT_STEPS = [[1, 2], [2, 1], [2, -1], [1, -2], [-1, -2], [-2, -1], [-2, 1], [-1, 2]].freeze
+  KING_STEPS = [[0, 1], [1, 1], [1, 0], [1, -1], [0, -1], [-1, -1], [-1, 0], [-1, 1]].freeze
+  ROOK_STEPS = [[0, 1], [1, 0], [0, -1], [-1, 0]].freeze
+  BISHOP_STEPS = [[1, 1], [1, -1], [-1, -1], [-1, 1]].freeze
+
+  # Slow reference for Board#check?: walks the board from the king of the
+  # side to move looking for an enemy piece that attacks it.
+  def reference_check?(board)
+    black = board.active_color
+    king = (0..63).find { |s| board[s] == (black ? 'k' : 'K') }
+    file = king % 8
+    rank = king / 8
+    enemy = lambda do |f, r|
+      piece = f.between?(0, 7) && r.between?(0, 7) && board[(r * 8) + f]
+      piece.upcase if piece && (piece == piece.upcase) == black
+    end
+    pawn_rank = black ? rank - 1 : rank + 1
+    return true if [-1, 1].any? { |df| enemy[file + df, pawn_rank] == 'P' }
+    return true if KNIGHT_STEPS.any? { |df, dr| enemy[file + df, rank + dr] == 'N' }
+    return true if KING_STEPS.any? { |df, dr| enemy[file + df, rank + dr] == 'K' }
+
+    { %w[R Q] => ROOK_STEPS, %w[B Q] => BISHOP_STEPS }.any? do |pieces, steps|
+      steps.any? do |df, dr|
+        f = file + df
+        r = rank + dr
+        while f.between?(0, 7) && r.between?(0, 7) && board[(r * 8) + f].nil?
+          f += df
+          r += dr
+        end
+        pieces.include?(enemy[f, r])
+      end
+    end
+  end
+
+  def test_check_matches_reference
+    files = TestHelper.pgns('valid').sort.first(30) + TestHelper.pgns('checkmate')
+    checks = 0
+    files.each do |file|
+      game = Chess::Game.new(Chess::Pgn.new(file).moves)
+      game.each do |board|
+        checks += 1 if board.check?
+
+        assert_equal reference_check?(board), board.check?, board.to_fen
+      end
+    end
+
+    assert_operator checks, :>, 50
+  end
+end
@@ -0,0 +1,76 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  def test_binary_round_trip
+    TestHelper.pgns('valid').first(50).each do |file|
+      game = Chess::Game.load_pgn(file)
+      data = game.to_binary
+      loaded = Chess::Game.from_binary(data)
+
+      assert_equal Encoding::BINARY, data.encoding
+      assert_operator data.bytesize, :<=, (game.moves.size * 2) + 2
+      assert_instance_of Chess::Game, loaded
+      assert_equal game.moves, loaded.moves
+      assert_equal game.board.to_fen, loaded.board.to_fen
+      assert_equal game.result, loaded.result
+    end
+  end
+
+  def test_binary_size
+    assert_equal "\x01\x06\x0d\x08\x0d".b, Chess::Game.new(%w[e4 e5 Nf3]).to_binary
+  end
+
+  def test_binary_default_promotion
+    game = Chess::Game.load_fen('8/P6k/8/8/8/8/8/K7 w - - 0 1')
+    game.move('a8')
+    loaded = Chess::Game.from_binary(game.to_binary)
+
+    assert_equal game.moves, loaded.moves
+    assert_equal 'Q', loaded.board['a8']
+  end
+
+  def test_binary_checkmate
+    game = Chess::Game.new(%w[f3 e5 g4 Qh4#])
+    loaded = Chess::Game.from_binary(game.to_binary)
+
+    assert_equal :black_won, loaded.status
+  end
+
+  def test_binary_from_fen
+    fen = 'r2qk3/8/2n5/8/8/8/p2B4/4K2R w K - 0 1'
+    game = Chess::Game.load_fen(fen)
+    game.moves = %w[O-O a1=N]
+    loaded = Chess::Game.from_binary(game.to_binary)
+
+    assert_equal fen, loaded[0].to_fen
+    assert_equal game.moves, loaded.moves
+    assert_equal game.board.to_fen, loaded.board.to_fen
+  end
+
+  def test_binary_fen_after_moves
+    game = Chess::Game.new(%w[e4 e5])
+    game.set_fen!('4k3/8/4K3/4P3/8/8/8/8 w - - 0 1')
+    game.move('Kd6')
+
+    assert_raises(RuntimeError) { game.to_binary }
+  end
+
+  def test_binary_empty_game
+    loaded = Chess::Game.from_binary(Chess::Game.new.to_binary)
+
+    assert_equal 0, loaded.size
+    assert_equal '*', loaded.result
+  end
+
+  def test_invalid_binary
+    assert_raises(Chess::InvalidBinaryFormatError) { Chess::Game.from_binary('') }
+    assert_raises(Chess::InvalidBinaryFormatError) { Chess::Game.from_binary("\x01\x06\xff".b) }
+    assert_raises(Chess::InvalidBinaryFormatError) { Chess::Game.from_binary("\x01\x07\x03abc".b) }
+  end
+
+  def test_truncated_promotion_escape
+    data = Chess::Game.new(%w[e4 e5]).to_binary + "\xff".b
+
+    assert_raises(Chess::InvalidBinaryFormatError) { Chess::Game.from_binary(data) }
+  end
+end
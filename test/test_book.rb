@@ -0,0 +1,128 @@
+require 'test_helper'
+require 'digest'
+require 'tmpdir'
+
+class ChessTest < Minitest::Test
+  # Reference keys of the Polyglot book format specification.
+  POLYGLOT_KEYS = {
+    [] => 0x463b96181691fc9c,
+    %w[e2e4] => 0x823c9b50fd114196,
+    %w[e2e4 d7d5] => 0x0756b94461c50fb0,
+    %w[e2e4 d7d5 e4e5] => 0x662fafb965db29d4,
+    %w[e2e4 d7d5 e4e5 f7f5] => 0x22a48b5a8e47ff78,
+    %w[e2e4 d7d5 e4e5 f7f5 e1e2] => 0x652a607ca3f242c1,
+    %w[e2e4 d7d5 e4e5 f7f5 e1e2 e8f7] => 0x00fdd303c946bdd9,
+    %w[a2a4 b7b5 h2h4 b5b4 c2c4] => 0x3c8123ea7b067637,
+    %w[a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a2] => 0x5c3f9b829b279560
+  }.freeze
+
+  # SHA-256 of the big endian keys of random_table_fens, computed with a
+  # separate implementation of the key on the Random64 array of the format
+  # description.
+  RANDOM_TABLE_DIGEST = 'f403ace5a5323343b0d9a775bb1cfaa7b7c42cf29e1fe89bb1ab9ffb2884a6e6'.freeze
+
+  def placement_fen(pieces, color = 'b', castling = '-', en_passant = '-')
+    rows = 7.downto(0).map do |rank|
+      (0..7).map { |file| pieces[(rank * 8) + file] || '1' }.join.gsub(/1+/) { |ones| ones.size.to_s }
+    end
+    "#{rows.join('/')} #{color} #{castling} #{en_passant} 0 1"
+  end
+
+  # Positions whose keys together use every number of the Random64 array:
+  # each piece on each square next to the two kings, black to move, then an en
+  # passant capture on each file and each castling right, white to move.
+  def random_table_fens
+    fens = %w[p P n N b B r R q Q k K].product((0..63).to_a).map do |piece, square|
+      kings = square < 32 ? { 63 => 'K', 61 => 'k' } : { 0 => 'K', 2 => 'k' }
+      kings.delete(kings.key(piece)) if piece.casecmp?('k')
+      placement_fen(kings.merge(square => piece))
+    end
+    fens += (0..7).map do |file|
+      pawns = { 32 + file => 'p', 32 + (file.zero? ? 1 : file - 1) => 'P' }
+      placement_fen({ 4 => 'K', 60 => 'k' }.merge(pawns), 'w', '-', "#{(97 + file).chr}6")
+    end
+    fens + %w[K Q k q].map do |right|
+      placement_fen({ 0 => 'R', 4 => 'K', 7 => 'R', 56 => 'r', 60 => 'k', 63 => 'r' }, 'w', right)
+    end
+  end
+
+  def polyglot_move(from, to, promotion = 0)
+    square = ->(s) { ((s[1].to_i - 1) * 8) + (s[0].ord - 'a'.ord) }
+    square[to] | (square[from] << 6) | (promotion << 12)
+  end
+
+  def write_book(path, entries)
+    data = entries.sort_by(&:first).map { |key, move, weight| [key, move, weight, 0].pack('Q>S>S>L>') }.join
+    File.binwrite(path, data)
+  end
+
+  def test_polyglot_keys
+    POLYGLOT_KEYS.each do |moves, key|
+      assert_equal key, Chess::Game.new(moves).board.polyglot_key, moves.join(' ')
+    end
+  end
+
+  def test_polyglot_random_table
+    keys = random_table_fens.map { |fen| Chess::Game.load_fen(fen).board.polyglot_key }
+
+    assert_equal RANDOM_TABLE_DIGEST, Digest::SHA256.hexdigest(keys.pack('Q>*'))
+  end
+
+  def test_book_entries
+    start = Chess::Game.new.board
+    castling = Chess::Game.new
+    castling.set_fen!('r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1')
+    Dir.mktmpdir do |dir|
+      path = File.join(dir, 'book.bin')
+      write_book(path, [
+                   [start.polyglot_key, polyglot_move('e2', 'e4'), 10],
+                   [start.polyglot_key, polyglot_move('d2', 'd4'), 5],
+                   [start.polyglot_key, polyglot_move('e2', 'e5'), 5], # illegal
+                   [castling.board.polyglot_key, polyglot_move('e1', 'h1'), 1],
+                   [castling.board.polyglot_key, polyglot_move('e1', 'a1'), 1],
+                   [1, polyglot_move('a2', 'a3'), 1]
+                 ])
+      Chess::Book.open(path) do |book|
+        assert_equal 6, book.size
+        assert_equal [{ move: 'e4', weight: 10 }, { move: 'd4', weight: 5 }].sort_by { |m| m[:move] },
+                     book.entries(start).sort_by { |m| m[:move] }
+        assert_equal %w[O-O O-O-O], book.entries(castling.board).map { |m| m[:move] }.sort
+        assert_empty book.entries(Chess::Game.new(%w[e4]).board)
+      end
+    end
+  end
+
+  def test_book_random_move
+    board = Chess::Game.new.board
+    Dir.mktmpdir do |dir|
+      path = File.join(dir, 'book.bin')
+      write_book(path, [
+                   [board.polyglot_key, polyglot_move('e2', 'e4'), 3],
+                   [board.polyglot_key, polyglot_move('d2', 'd4'), 1],
+                   [board.polyglot_key, polyglot_move('c2', 'c4'), 0]
+                 ])
+      book = Chess::Book.open(path)
+      random = Random.new(42)
+      picks = Array.new(4000) { book.random_move(board, random: random) }.tally
+
+      assert_equal %w[d4 e4], picks.keys.sort
+      assert_in_delta 3.0, picks['e4'].to_f / picks['d4'], 0.4
+      assert_nil book.random_move(Chess::Game.new(%w[e4]).board)
+      book.close
+
+      assert_equal 0, book.size
+      assert_nil book.random_move(board)
+    end
+  end
+
+  def test_book_errors
+    Dir.mktmpdir do |dir|
+      path = File.join(dir, 'book.bin')
+
+      assert_raises(Errno::ENOENT) { Chess::Book.open(path) }
+      File.binwrite(path, 'not a book')
+
+      assert_raises(Chess::InvalidBinaryFormatError) { Chess::Book.open(path) }
+    end
+  end
+end
@@ -0,0 +1,139 @@
+require 'test_helper'
+require 'tmpdir'
+
+class ChessTest < Minitest::Test
+  def write_pgns(dir, pgns)
+    pgns.each do |name, pgn|
+      path = File.join(dir, name)
+      FileUtils.mkdir_p(File.dirname(path))
+      File.write(path, pgn)
+    end
+  end
+
+  def test_database_validate_collection
+    report = Chess::Database.validate(TestHelper::PGN_COLLECTION, threads: 2)
+
+    assert_predicate report, :success?, report.to_s
+    assert_equal Dir[File.join(TestHelper::PGN_COLLECTION, '**/*.pgn')].size + 1, report.games
+    assert_operator report.plies, :>, 100_000
+    assert_operator report.games_per_second, :>, 0
+    assert_operator report.plies_per_second, :>, report.games_per_second
+  end
+
+  def test_database_validate_plies
+    files = TestHelper.pgns('valid').first(20)
+    report = Chess::Database.validate(files, threads: 3)
+
+    assert_predicate report, :success?
+    assert_equal 20, report.games
+    assert_equal(files.sum { |file| Chess::Game.new(Chess::Pgn.new(file).moves).moves.size }, report.plies)
+  end
+
+  def test_database_validate_pgn_format
+    Dir.mktmpdir do |dir|
+      write_pgns(dir, 'games.pgn' => <<~PGN)
+        [Event "Two games"]
+        [Result "1-0"]
+
+        1. e4 {best by test} e5 $1 2. Bc4 (2. Nf3 Nc6 (2... d6) 3. Bb5) 2... Nc6
+        3. Qh5 Nf6?? ; the queen is lost
+        4. Qxf7# 1-0
+
+        [Event "From a position"]
+        [FEN "4k3/8/4K3/4P3/8/8/8/8 w - - 0 1"]
+        [Result "*"]
+
+        1.Kd6 Kd8 2.e6 Ke8 3.e7 Kf7 4.Kd7 Kf6 5.e8=Q *
+      PGN
+      report = Chess::Database.validate(dir, threads: 1)
+
+      assert_predicate report, :success?, report.to_s
+      assert_equal 2, report.games
+      assert_equal 16, report.plies
+    end
+  end
+
+  # Every game starts from a FEN and plays one move, so the workers spend
+  # most of their time parsing FENs.
+  def test_database_validate_fen_games_threads
+    pgns = TestHelper.pgns('valid').sort.first(40).each_with_index.to_h do |file, i|
+      game = Chess::Game.new(Chess::Pgn.new(file).moves)
+      fens = []
+      game.each { |board| fens << board.to_fen }
+      games = fens[0...-1].each_with_index.map do |fen, ply|
+        "[FEN \"#{fen}\"]\n[Result \"*\"]\n\n#{game.moves[ply + 1]} *\n"
+      end
+      ["#{i}.pgn", games.join("\n")]
+    end
+    Dir.mktmpdir do |dir|
+      write_pgns(dir, pgns)
+      5.times do
+        report = Chess::Database.validate(dir, threads: 4)
+
+        assert_predicate report, :success?, report.to_s
+        assert_equal report.games, report.plies
+      end
+    end
+  end
+
+  def test_database_validate_failures
+    Dir.mktmpdir do |dir|
+      write_pgns(
+        dir,
+        'games/illegal.pgn' => "1. e4 e5 2. Nf4 *\n",
+        'games/invalid.pgn' => "1. e4 e5 2. Nf9 *\n",
+        'games/check.pgn' => "1. e4+ e5 *\n",
+        'games/checkmate.pgn' => "1. e4 e5 2. Qh5# *\n",
+        'games/result.pgn' => "[Result \"1-0\"]\n\n1. f3 e5 2. g4 Qh4# 1-0\n",
+        'games/empty.pgn' => '',
+        'games/comment.pgn' => "1. e4 {unterminated\n",
+        'checkmate/white_won/mate.pgn' => "1. f3 e5 2. g4 Qh4# 0-1\n",
+        'stalemate/game.pgn' => "1. e4 e5 *\n",
+        'threefold_repetition/game.pgn' => "1. Nf3 Nf6 2. Ng1 Ng8 3. Nf3 *\n",
+        'illegal/game.pgn' => "1. e4 e5 *\n",
+        'invalid/game.pgn' => "1. e4 e5 *\n"
+      )
+      report = Chess::Database.validate(dir, threads: 2)
+      reasons = report.failures.transform_values { |failures| failures.map { |f| [File.basename(f.path), f.game, f.ply, f.move, f.reason] } }
+
+      assert_equal 11, report.games
+      assert_equal [
+        ['check.pgn', 1, 1, 'e4+', :wrong_check],
+        ['checkmate.pgn', 1, 3, 'Qh5#', :wrong_checkmate],
+        ['comment.pgn', 1, nil, '{', :invalid_pgn],
+        ['empty.pgn', 0, nil, nil, :invalid_pgn],
+        ['illegal.pgn', 1, 3, 'Nf4', :illegal_move],
+        ['invalid.pgn', 1, nil, 'Nf9', :invalid_pgn],
+        ['result.pgn', 1, nil, nil, :wrong_result]
+      ], reasons['games']
+      assert_equal [['mate.pgn', 1, nil, nil, :wrong_winner]], reasons['white_won']
+      assert_equal [['game.pgn', 1, nil, nil, :not_stalemate]], reasons['stalemate']
+      assert_equal [['game.pgn', 1, nil, nil, :not_threefold_repetition]], reasons['threefold_repetition']
+      assert_equal [['game.pgn', 0, nil, nil, :not_illegal_move]], reasons['illegal']
+      assert_equal [['game.pgn', 0, nil, nil, :not_invalid_pgn]], reasons['invalid']
+      assert_match(/check.pgn: game 1, ply 1 \(e4\+\): wrong_check/, report.to_s)
+    end
+  end
+
+  def test_database_validate_too_long_game
+    Dir.mktmpdir do |dir|
+      moves = Array.new(1030) { |i| %w[Nf3 Nf6 Ng1 Ng8][i % 4] }
+      movetext = moves.each_slice(2).with_index(1).map { |pair, n| "#{n}. #{pair.join(' ')}" }.join("\n")
+      write_pgns(dir, 'long.pgn' => "#{movetext} *\n")
+      report = Chess::Database.validate(dir, threads: 1)
+      failure = report.failures.values.flatten.first
+
+      assert_equal [1025, 'Nf3', :illegal_move], [failure.ply, failure.move, failure.reason]
+      assert_equal 1024, report.plies
+    end
+  end
+
+  def test_database_validate_arguments
+    assert_equal 0, Chess::Database.validate([]).games
+    report = Chess::Database.validate('/nonexistent/file.pgn')
+
+    assert_equal :unreadable_file, report.failures['nonexistent'].first.reason
+    assert_raises(ArgumentError) { Chess::Database.validate([], threads: 0) }
+    assert_raises(TypeError) { Chess::Database.send(:validate_files, [1], 1) }
+  end
+end
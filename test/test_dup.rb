@@ -0,0 +1,39 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  def test_dup_game
+    game = Chess::Game.new(%w[e4 e5 Nf3 Nc6 Bb5])
+    copy = game.dup
+    copy.move('a6')
+    game.move('d6')
+
+    assert_equal %w[e4 e5 Nf3 Nc6 Bb5 d6], game.moves
+    assert_equal %w[e4 e5 Nf3 Nc6 Bb5 a6], copy.moves
+    assert_equal 'r1bqkbnr/1ppp1ppp/p1n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 0 4', copy.board.to_fen
+    assert_equal game[4].to_fen, copy[4].to_fen
+  end
+
+  def test_dup_rollback_and_free
+    game = Chess::Game.new(%w[e4 e5 Nf3 Nc6])
+    copies = Array.new(3) { |i| game.dup.tap { |copy| (i + 1).times { copy.rollback! } } }
+    copies.each { |copy| copy.move(copy.board.generate_all_moves.first) }
+    board = copies.last.dup[0]
+    game = copies = nil
+    GC.start
+
+    assert_equal 'rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1', board.to_fen
+  end
+
+  def test_clone_game
+    game = Chess::Game.load_fen('4k3/8/4K3/4P3/8/8/8/8 w - - 0 1')
+    game.move('Kd6')
+    game.freeze
+    copy = game.clone(freeze: false)
+    copy.move('Kd8')
+
+    assert_equal %w[SET\ BY\ FEN Kd6], game.moves
+    assert_equal 3, copy.size
+    assert_equal '*', copy.result
+    assert_predicate game.clone, :frozen?
+  end
+end
@@ -0,0 +1,57 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  def test_each_move
+    game = Chess::Game.new(%w[e4 e5 Nf3])
+    moves = game.each_move.to_a
+
+    assert_equal [['e4', 0], ['e5', 1], ['Nf3', 2]], moves
+    assert moves.all? { |m, _| m.frozen? }
+    assert_same game.each_move.first.first, game.each_move.first.first
+  end
+
+  def test_each_coord_move
+    game = Chess::Game.new(%w[e4 e5 Nf3])
+
+    assert_equal %w[e2e4 e7e5 g1f3], game.each_coord_move.to_a.map(&:first)
+    assert_equal 3, game.each_coord_move.size
+  end
+
+  def test_each_ply
+    game = Chess::Game.new(%w[e4 e5])
+    plies = game.each_ply.to_a.map(&:first)
+
+    assert_equal [(12 << 6) | 28, (52 << 6) | 36], plies
+  end
+
+  def test_each_ply_promotion_and_fen
+    game = Chess::Game.load_fen('8/P6k/8/8/8/8/8/K7 w - - 0 1')
+    game.move('a8=N')
+
+    assert_equal [nil, (48 << 6) | 56 | (1 << 12)], game.each_ply.to_a.map(&:first)
+  end
+
+  def test_each_fen
+    game = Chess::Game.new(%w[e4 e5])
+    fens = game.each_fen.to_a.map(&:first)
+
+    assert_equal [game[0].to_fen, game[1].to_fen], fens
+    assert fens.all?(&:frozen?)
+  end
+
+  def test_moves_cache_invalidation
+    game = Chess::Game.new(%w[e4 e5])
+    moves = game.moves
+    moves << 'Nf3'
+
+    assert_equal %w[e4 e5], game.moves
+    game.move('Nf3')
+
+    assert_equal %w[e4 e5 Nf3], game.moves
+    assert_equal %w[e2e4 e7e5 g1f3], game.coord_moves
+    game.rollback!
+
+    assert_equal %w[e4 e5], game.moves
+    assert_equal %w[e2e4 e7e5], game.coord_moves
+  end
+end
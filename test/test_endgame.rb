@@ -0,0 +1,136 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  # Returns a game set to the position with the given pieces ({ square =>
+  # piece }).
+  def endgame_game(pieces, color)
+    rows = 7.downto(0).map do |rank|
+      (0..7).map { |file| pieces[(rank * 8) + file] || '1' }.join.gsub(/1+/) { |s| s.size.to_s }
+    end
+    Chess::Game.load_fen("#{rows.join('/')} #{color} - - 0 1")
+  end
+
+  # Random positions with the kings and a piece of the strong color, the ones
+  # covered by the bitbases. The kings and the piece are on the given squares.
+  def random_endgames(piece, count, random, king: 0..63, weak_king: 0..63, piece_squares: 0..63)
+    games = []
+    while games.size < count
+      squares = [king.to_a.sample(random: random), weak_king.to_a.sample(random: random), piece_squares.to_a.sample(random: random)]
+      next if squares.uniq.size < 3 || (piece.casecmp?('p') && !squares[2].between?(8, 55))
+
+      game = endgame_game({ squares[0] => 'K', squares[1] => 'k', squares[2] => piece }, %w[w b].sample(random: random))
+      games << game if game.board.endgame_result
+    end
+    games
+  end
+
+  # Legal moves of the board, underpromotions included.
+  def endgame_moves(board)
+    board.generate_all_moves.flat_map { |m| m.include?('=Q') ? %w[Q R B N].map { |p| m.sub('=Q', "=#{p}") } : m }
+  end
+
+  def each_child(game)
+    endgame_moves(game.board).each do |move|
+      game.move(move)
+      begin
+        yield
+      ensure
+        game.rollback!
+      end
+    end
+  end
+
+  # The result computed from the results of the positions after each move.
+  def endgame_result_by_moves(game)
+    board = game.board
+    win = board.active_color ? '0-1' : '1-0'
+    return board.active_color ? '1-0' : '0-1' if board.checkmate?
+    return '1/2-1/2' if board.stalemate?
+
+    results = []
+    each_child(game) { results << (game.board.endgame_result || '1/2-1/2') }
+    return win if results.include?(win)
+    return '1/2-1/2' if results.include?('1/2-1/2')
+
+    results.first
+  end
+
+  # Brute force: true if the side to move mates in at most the given moves.
+  def forced_mate?(game, moves)
+    each_child(game) do
+      return true if game.board.checkmate?
+      next if moves == 1 || game.over?
+
+      refuted = false
+      each_child(game) do
+        unless forced_mate?(game, moves - 1)
+          refuted = true
+          break
+        end
+      end
+      return true unless refuted
+    end
+    false
+  end
+
+  def test_endgame_result_known_positions
+    {
+      '4k3/8/4K3/4P3/8/8/8/8 b - - 0 1' => '1-0',
+      '8/8/8/8/8/4k3/4p3/4K3 w - - 0 1' => '1/2-1/2',
+      '8/8/8/8/8/4k3/4p3/4K3 b - - 0 1' => '0-1',
+      '4k3/4P3/4K3/8/8/8/8/8 b - - 0 1' => '1/2-1/2',
+      '8/1P6/k7/8/K7/8/8/8 w - - 0 1' => '1-0',
+      '7k/8/8/8/8/8/8/K6Q b - - 0 1' => '1-0',
+      '8/8/8/8/8/8/7k/K6R b - - 0 1' => '1/2-1/2',
+      '8/8/8/8/8/1k6/8/qK6 w - - 0 1' => '1/2-1/2',
+      '8/8/8/8/8/2k5/8/2K1q3 w - - 0 1' => '0-1'
+    }.each do |fen, result|
+      assert_equal result, Chess::Game.load_fen(fen).board.endgame_result, fen
+    end
+  end
+
+  def test_endgame_result_not_covered
+    [
+      '8/8/8/8/8/8/8/4K2R w K - 0 1',
+      '4k3/8/8/8/8/8/8/4K3 w - - 0 1',
+      '4k3/8/8/8/8/8/8/3NK3 w - - 0 1',
+      '4k3/8/8/8/8/8/4P3/3QK3 w - - 0 1',
+      # Black in check with white to move
+      '4k3/8/8/8/8/8/4Q3/3K4 w - - 0 1'
+    ].each do |fen|
+      assert_nil Chess::Game.load_fen(fen).board.endgame_result, fen
+    end
+    assert_nil Chess::Game.new.board.endgame_result
+  end
+
+  def test_endgame_result_consistent_with_moves
+    random = Random.new(41)
+    %w[Q R P q r p].each do |piece|
+      random_endgames(piece, 40, random).each do |game|
+        assert_equal endgame_result_by_moves(game), game.board.endgame_result, game.board.to_fen
+      end
+    end
+  end
+
+  def test_endgame_result_matches_brute_force
+    random = Random.new(42)
+    mates = 0
+    { 'Q' => 0..63, 'R' => 0..63, 'P' => 48..55 }.each do |piece, squares|
+      random_endgames(piece, 60, random, king: 32..55, weak_king: 56..63, piece_squares: squares).each do |game|
+        next if game.board.active_color || !forced_mate?(game, 2)
+
+        assert_equal '1-0', game.board.endgame_result, game.board.to_fen
+        mates += 1
+      end
+    end
+
+    assert_operator mates, :>=, 10
+  end
+
+  def test_search_with_endgames
+    # b8=Q is stalemate
+    assert_equal 'b8=R', Chess::Game.load_fen('8/1P6/k7/8/K7/8/8/8 w - - 0 1').board.best_move(depth: 2)
+    # Only the opposition wins
+    assert_equal 'Ke5', Chess::Game.load_fen('8/4k3/8/3K4/4P3/8/8/8 w - - 0 1').board.best_move(depth: 2)
+  end
+end
@@ -0,0 +1,45 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  def evaluate_fen(fen)
+    game = Chess::Game.new
+    game.set_fen!(fen)
+    game.board.evaluate
+  end
+
+  def test_evaluate_starting_position
+    assert_equal 0, Chess::Game.new.board.evaluate
+    assert_operator Chess::Game.new(%w[e4 d5 exd5]).board.evaluate, :>, 80
+  end
+
+  def test_evaluate_incremental
+    TestHelper.pgns('valid').sort.first(20).each do |file|
+      Chess::Game.load_pgn(file).each do |board|
+        assert_equal evaluate_fen(board.to_fen), board.evaluate, board.to_fen
+      end
+    end
+  end
+
+  def test_evaluate_special_moves
+    game = Chess::Game.new
+    game.set_fen!('r3k2r/1P6/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1')
+    %w[exd6 O-O O-O-O Kg7 b8=N].each do |move|
+      game << move
+
+      assert_equal evaluate_fen(game.board.to_fen), game.board.evaluate
+    end
+  end
+
+  def test_evaluate_symmetric
+    assert_equal evaluate_fen('r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3'),
+                 -evaluate_fen('rnbqkb1r/pppp1ppp/5n2/4p3/4P3/2N5/PPPP1PPP/R1BQKBNR b KQkq - 2 3')
+  end
+
+  def test_evaluate_tapered
+    # In the endgame the king goes to the center
+    assert_operator evaluate_fen('4k3/8/8/8/3K4/8/8/8 w - - 0 1'), :>, evaluate_fen('4k3/8/8/8/8/8/8/K7 w - - 0 1')
+    # In the middlegame the king stays castled
+    assert_operator evaluate_fen('rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQ1RK1 w kq - 0 1'),
+                    :>, evaluate_fen('rnbqkbnr/pppppppp/8/8/3K4/8/PPPPPPPP/RNBQ1R2 w kq - 0 1')
+  end
+end
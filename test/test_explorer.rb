@@ -0,0 +1,176 @@
+require 'test_helper'
+require 'tmpdir'
+
+class ChessTest < Minitest::Test
+  def explorer_games
+    TestHelper.pgns('valid').sort.first(40).map { |file| Chess::Game.load_pgn(file) }
+  end
+
+  def expected_explorer(games)
+    stats = Hash.new { |h, k| h[k] = Hash.new { |hh, kk| hh[kk] = { white: 0, draws: 0, black: 0 } } }
+    games.each do |game|
+      key = { '1-0' => :white, '1/2-1/2' => :draws, '0-1' => :black }[game.result]
+      next unless key
+
+      replay = Chess::Game.new
+      game.moves.each do |move|
+        stats[replay.board.to_position][move][key] += 1
+        replay.move(move)
+      end
+    end
+    stats
+  end
+
+  def test_explorer_matches_games
+    games = explorer_games
+    expected = expected_explorer(games)
+    Dir.mktmpdir do |dir|
+      explorer = Chess::Explorer.build(File.join(dir, 'explorer.idx'), games, threads: 4)
+
+      assert_equal expected.values.sum(&:size), explorer.size
+      games.first(5).each do |game|
+        replay = Chess::Game.new
+        game.moves.each do |move|
+          moves = replay.board.explore(explorer)
+          stats = expected[replay.board.to_position]
+
+          assert_equal stats.keys.sort, moves.map { |m| m[:move] }.sort
+          moves.each do |m|
+            assert_equal stats[m[:move]], m.except(:move)
+          end
+          totals = moves.map { |m| m[:white] + m[:draws] + m[:black] }
+
+          assert_equal totals.sort.reverse, totals
+          replay.move(move)
+        end
+      end
+    end
+  end
+
+  def test_explorer_sources
+    files = TestHelper.pgns('valid').sort.first(10)
+    games = files.map { |file| Chess::Game.load_pgn(file) }
+    Dir.mktmpdir do |dir|
+      pgn = File.join(dir, 'games.pgn')
+      File.write(pgn, files.map { |file| File.read(file).strip }.join("\n\n"))
+      collection = File.join(dir, 'games.bin')
+      File.binwrite(collection, games.map { |g| b = g.to_binary; [b.bytesize].pack('v') + b }.join)
+      from_games = Chess::Explorer.build(File.join(dir, 'a.idx'), games)
+      from_pgn = Chess::Explorer.build(File.join(dir, 'b.idx'), [pgn], threads: 3)
+      from_collection = Chess::Explorer.build(File.join(dir, 'c.idx'), [collection], threads: 1)
+
+      assert_equal File.binread(File.join(dir, 'a.idx')), File.binread(File.join(dir, 'b.idx'))
+      assert_equal File.binread(File.join(dir, 'a.idx')), File.binread(File.join(dir, 'c.idx'))
+      assert_equal from_games.size, from_pgn.size
+      assert_equal from_games.size, from_collection.size
+    end
+  end
+
+  def test_explorer_pgn_chunks
+    files = TestHelper.pgns('valid').sort.first(100)
+    games = files.map { |file| Chess::Game.load_pgn(file) }
+    Dir.mktmpdir do |dir|
+      # Large enough to be split in chunks among the threads
+      pgn = File.join(dir, 'games.pgn')
+      File.write(pgn, files.map { |file| File.read(file).strip }.join("\n\n"))
+      [nil, 10].each do |max_plies|
+        Chess::Explorer.build(File.join(dir, 'a.idx'), games, threads: 1, max_plies: max_plies)
+        Chess::Explorer.build(File.join(dir, 'b.idx'), [pgn], threads: 4, max_plies: max_plies)
+
+        assert_equal File.binread(File.join(dir, 'a.idx')), File.binread(File.join(dir, 'b.idx'))
+      end
+    end
+  end
+
+  def test_explorer_pgn_fen
+    fen = '6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1'
+    Dir.mktmpdir do |dir|
+      pgn = File.join(dir, 'games.pgn')
+      File.write(pgn, %([Result "1-0"]\n[FEN "#{fen}"]\n\n1. Ra8# 1-0\n))
+      explorer = Chess::Explorer.build(File.join(dir, 'explorer.idx'), [pgn])
+
+      assert_equal [{ move: 'Ra8#', white: 1, draws: 0, black: 0 }], Chess::Game.load_fen(fen).board.explore(explorer)
+    end
+  end
+
+  def test_explorer_pgn_errors
+    valid = File.read(TestHelper.pgns('valid').min).strip
+    illegal = File.read(File.join(TestHelper::PGN_COLLECTION, 'illegal', '0001.pgn')).strip
+    Dir.mktmpdir do |dir|
+      path = File.join(dir, 'explorer.idx')
+      pgn = File.join(dir, 'games.pgn')
+      line = valid.lines.size + 11
+      File.write(pgn, "#{valid}\n\n#{illegal}\n")
+      error = assert_raises(Chess::IllegalMoveError) { Chess::Explorer.build(path, [pgn], threads: 2) }
+
+      assert_equal "Illegal move 'Nf4' in #{pgn} at line #{line}", error.message
+      File.write(pgn, "#{valid}\n\n[Result \"*\"]\n\n1. e4 { not closed\n")
+      error = assert_raises(Chess::InvalidPgnFormatError) { Chess::Explorer.build(path, [pgn]) }
+
+      assert_equal "Invalid PGN format in #{pgn} at line #{valid.lines.size + 4}", error.message
+      assert_raises(Errno::ENOENT) { Chess::Explorer.build(path, [File.join(dir, 'missing.pgn')]) }
+      assert_raises(ArgumentError) { Chess::Explorer.build(path, [pgn], threads: 0) }
+    end
+  end
+
+  def test_explorer_max_plies
+    games = explorer_games
+    Dir.mktmpdir do |dir|
+      explorer = Chess::Explorer.build(File.join(dir, 'explorer.idx'), games, max_plies: 2)
+      board = Chess::Game.new.board
+      first_moves = board.explore(explorer)
+
+      assert_equal games.count { |g| g.result != '*' }, first_moves.sum { |m| m[:white] + m[:draws] + m[:black] }
+      assert_empty Chess::Game.new(%w[e4 e5]).board.explore(explorer)
+    end
+  end
+
+  def test_explorer_errors
+    Dir.mktmpdir do |dir|
+      path = File.join(dir, 'explorer.idx')
+
+      assert_raises(Errno::ENOENT) { Chess::Explorer.new(path) }
+      File.binwrite(path, 'not an explorer')
+
+      assert_raises(Chess::InvalidBinaryFormatError) { Chess::Explorer.new(path) }
+      collection = File.join(dir, 'games.bin')
+      File.binwrite(collection, "\x03\x00\x01\x00\xff".b)
+
+      assert_raises(Chess::InvalidBinaryFormatError) { Chess::Explorer.build(path, [collection]) }
+      assert_raises(Errno::ENOENT) { Chess::Explorer.build(File.join(dir, 'missing/explorer.idx'), []) }
+    end
+  end
+
+  def test_explorer_too_many_moves
+    Dir.mktmpdir do |dir|
+      path = File.join(dir, 'explorer.idx')
+      game = Chess::Game.new(%w[e4])
+      game.resign(:black)
+      Chess::Explorer.build(path, [game])
+      data = File.binread(path)
+      entry_size = data.unpack1('@12V')
+      entry = data.byteslice(24, entry_size)
+      # More moves for the starting position than a position can have
+      entries = (1..300).map { |move| entry.dup.tap { |e| e[26, 2] = [move].pack('v') } }
+      File.binwrite(path, data.byteslice(0, 16) + [entries.size].pack('Q<') + entries.join)
+      explorer = Chess::Explorer.new(path)
+
+      assert_equal 300, explorer.size
+      assert_raises(Chess::InvalidBinaryFormatError) { Chess::Game.new.board.explore(explorer) }
+    end
+  end
+
+  def test_explorer_count_overflow
+    Dir.mktmpdir do |dir|
+      path = File.join(dir, 'explorer.idx')
+      Chess::Explorer.build(path, [Chess::Game.new(%w[e4 e5])])
+      data = File.binread(path)
+      entry_size, count = data.unpack('@12VQ<')
+      # A count whose size in bytes wraps around to the size of the entries
+      data[16, 8] = [count + (2**64 / (entry_size & -entry_size))].pack('Q<')
+      File.binwrite(path, data)
+
+      assert_raises(Chess::InvalidBinaryFormatError) { Chess::Explorer.new(path) }
+    end
+  end
+end
@@ -0,0 +1,48 @@
+require 'test_helper'
+require 'objspace'
+
+class ChessTest < Minitest::Test
+  def test_game_memsize
+    game = Chess::Game.new
+    empty = ObjectSpace.memsize_of(game)
+    game.moves = %w[e4 e5 Nf3 Nc6]
+
+    assert_operator empty, :>, 24 * 1024
+    assert_operator ObjectSpace.memsize_of(game), :>, empty
+  end
+
+  def test_game_memsize_shared_plies
+    empty = ObjectSpace.memsize_of(Chess::Game.new)
+    game = Chess::Game.load_pgn(File.join(__dir__, 'pgn_collection/valid/0001.pgn'))
+    plies = ObjectSpace.memsize_of(game) - empty
+    games = [game] + Array.new(9) { game.dup }
+    shared = games.sum { |g| ObjectSpace.memsize_of(g) - empty }
+
+    assert_operator plies, :>, 0
+    assert_operator shared, :<, plies * 2
+  end
+
+  def test_board_keeps_game_alive
+    board = Chess::Game.new(%w[e4 e5 Nf3]).board
+    GC.start
+    GC.compact if GC.respond_to?(:compact)
+    GC.start
+
+    assert_equal 'rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2', board.to_fen
+  end
+
+  def test_board_survives_rollback
+    game = Chess::Game.new(%w[e4 e5 Nf3])
+    board = game.board
+    first = game[0]
+    3.times { game.rollback! }
+    game.move('d4')
+
+    assert_equal 'rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2', board.to_fen
+    assert_equal 'rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1', first.to_fen
+  end
+
+  def test_board_type_check
+    assert_raises(TypeError) { Chess::Board.instance_method(:to_fen).bind_call(Chess::Game.new) }
+  end
+end
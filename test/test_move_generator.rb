@@ -34,6 +34,36 @@ class ChessTest < Minitest::Test
     assert_equal %w[Na3 Nc3 Nf3 Nh3 a3 a4 b3 b4 c3 c4 d3 d4 e3 e4 f3 f4 g3 g4 h3 h4], result
   end
 
+  def test_legal_moves
+    board = Chess::Game.load_fen('4k3/1P6/8/8/8/8/8/4K2R w K - 0 1').board
+    uci = board.legal_moves
+
+    assert_equal uci, board.legal_moves(format: :uci)
+    assert_equal %w[b7b8q b7b8r b7b8b b7b8n], uci.grep(/\Ab7/)
+    assert_includes uci, 'e1g1'
+    coord = ->(square) { "#{('a'.ord + (square % 8)).chr}#{(square / 8) + 1}" }
+    packed = board.legal_moves(format: :packed).map { |m| coord[(m >> 6) & 63] + coord[m & 63] + ' nbrq'[m >> 12].strip }
+
+    assert_equal uci, packed
+    assert_equal %w[O-O Rh8+ b8=Q+ b8=R+ b8=B b8=N], board.legal_moves(format: :san) & %w[O-O Rh8+ b8=Q+ b8=R+ b8=B b8=N]
+    assert_equal uci.size, board.legal_move_count
+    assert_raises(ArgumentError) { board.legal_moves(format: :lan) }
+  end
+
+  def test_each_legal_move
+    board = Chess::Game.new.board
+    yielded = []
+    board.each_legal_move(format: :san) do |move|
+      yielded << move
+      break if move == 'Nf3'
+    end
+
+    assert_equal %w[Na3 Nc3 Nf3], yielded
+    assert_equal 20, board.each_legal_move.size
+    assert_equal board.legal_moves(format: :packed), board.each_legal_move(format: :packed).to_a
+    assert_equal 0, Chess::Game.load_fen('k7/1Q6/1K6/8/8/8/8/8 b - - 0 1').board.legal_move_count
+  end
+
   def test_github_issue32
     game = Chess::Game.new
     game.moves = %w[f2f4 d7d6 d2d3 h7h5 b1d2 e7e5 f4f5 a7a5 c2c3 d8f6 d2c4 b7b6 c4d2 a8a6 d2f3 a6a7 f3e5 b6b5 h2h4]
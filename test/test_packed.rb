@@ -0,0 +1,46 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  def test_bitboards
+    bitboards = Chess::Game.new.board.bitboards
+
+    assert_equal 12, bitboards.size
+    assert_equal 0xff00, bitboards[0]
+    assert_equal 0x10, bitboards[5]
+    assert_equal 0x00ff000000000000, bitboards[6]
+    assert_equal 0x1000000000000000, bitboards[11]
+  end
+
+  def test_bitboards_match_placement
+    board = Chess::Game.new(%w[e4 d5 exd5 Qxd5 Nc3]).board
+    pieces = 'PNBRQKpnbrqk'
+    board.bitboards.each_with_index do |bitboard, i|
+      64.times do |square|
+        assert_equal board[square] == pieces[i], bitboard[square] == 1
+      end
+    end
+  end
+
+  def test_packed_bytes
+    board = Chess::Game.new(%w[e4]).board
+    packed = board.packed
+
+    assert_equal Encoding::BINARY, packed.encoding
+    assert_equal 64, packed.bytesize
+    assert_equal board.placement.join, packed
+  end
+
+  def test_packed_nibbles
+    packed = Chess::Game.new.board.packed(:nibbles)
+
+    assert_equal 32, packed.bytesize
+    assert_equal [0x24, 0x53, 0x36, 0x42], packed.bytes.first(4) # R N B Q K B N R
+    assert_equal [0x11] * 4, packed.bytes[4, 4]
+    assert_equal [0] * 16, packed.bytes[8, 16]
+    assert_equal [0xac, 0xdb, 0xbe, 0xca], packed.bytes.last(4) # r n b q k b n r
+  end
+
+  def test_packed_unknown_format
+    assert_raises(ArgumentError) { Chess::Game.new.board.packed(:bits) }
+  end
+end
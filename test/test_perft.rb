@@ -0,0 +1,31 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  # Reference values from https://www.chessprogramming.org/Perft_Results
+  PERFTS = {
+    'rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1' => [20, 400, 8902, 197_281],
+    'r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1' => [48, 2039, 97_862],
+    '8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1' => [14, 191, 2812, 43_238],
+    'r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1' => [6, 264, 9467],
+    'rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8' => [44, 1486, 62_379]
+  }.freeze
+
+  PERFTS.each_with_index do |(fen, nodes), i|
+    define_method :"test_perft_#{i + 1}" do
+      board = Chess::Game.load_fen(fen).board
+      nodes.each_with_index do |n, depth|
+        assert_equal n, board.perft(depth + 1)
+      end
+    end
+  end
+
+  def test_perft_depth_zero
+    assert_equal 1, Chess::Game.new.board.perft(0)
+  end
+
+  def test_castling_through_a_square_attacked_by_a_pawn
+    game = Chess::Game.load_fen('4k3/8/8/8/8/8/6p1/4K2R w K - 0 1')
+
+    refute_includes game.board.generate_moves('e1'), 'O-O'
+  end
+end
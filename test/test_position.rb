@@ -0,0 +1,97 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  def test_position_size
+    position = Chess::Game.new.board.to_position
+
+    assert_equal 26, position.to_binary.bytesize
+    assert_equal Encoding::BINARY, position.to_binary.encoding
+    assert_predicate position, :frozen?
+  end
+
+  def test_position_round_trip
+    game = Chess::Game.load_pgn(File.join(__dir__, 'pgn_collection/valid/0001.pgn'))
+    game.each do |board|
+      position = board.to_position
+      fen = board.to_fen.split[0..2].join(' ')
+
+      assert_equal fen, position.to_fen.split[0..2].join(' ')
+      assert_equal position, Chess::Position.from_binary(position.to_binary)
+      assert_equal position, position.to_board.to_position
+    end
+  end
+
+  def test_position_equality_and_hash
+    a = Chess::Game.new(%w[Nf3 Nf6 Ng1 Ng8]).board.to_position
+    b = Chess::Game.new.board.to_position
+    c = Chess::Game.new(%w[e4]).board.to_position
+
+    assert_equal a, b
+    assert a.eql?(b)
+    assert_equal a.hash, b.hash
+    refute_equal a, c
+    refute_equal a, a.to_fen
+    assert_equal 2, [a, b, c].uniq.size
+    assert_equal 1, { a => 1 }[b]
+  end
+
+  def test_position_ignores_clocks
+    g1 = Chess::Game.new
+    g1.set_fen!('4k3/8/8/8/8/8/8/4K2R w K - 12 40')
+    g2 = Chess::Game.new
+    g2.set_fen!('4k3/8/8/8/8/8/8/4K2R w K - 0 1')
+
+    assert_equal g1.board.to_position, g2.board.to_position
+  end
+
+  def test_position_canonical_en_passant
+    with_ep = Chess::Game.new(%w[e4]).board.to_position
+    without_ep = Chess::Game.new
+    without_ep.set_fen!('rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1')
+
+    assert_equal without_ep.board.to_position, with_ep
+    capturable = Chess::Game.new(%w[e4 a6 e5 d5]).board.to_position
+
+    assert_equal 'd6', capturable.to_fen.split[3]
+  end
+
+  def test_position_canonical_castling
+    g1 = Chess::Game.new
+    g1.set_fen!('4k3/8/8/8/8/8/8/4K3 w KQkq - 0 1')
+    g2 = Chess::Game.new
+    g2.set_fen!('4k3/8/8/8/8/8/8/4K3 w - - 0 1')
+
+    assert_equal g1.board.to_position, g2.board.to_position
+    assert_equal '-', g1.board.to_position.to_fen.split[2]
+  end
+
+  def test_position_to_board
+    position = Chess::Game.new(%w[e4 e5 Nf3]).board.to_position
+    board = position.to_board
+
+    assert_instance_of Chess::Board, board
+    assert_equal 'rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 0 1', board.to_fen
+  end
+
+  def test_position_invalid_binary
+    packed = Chess::Game.new.board.to_position.to_binary
+
+    assert_raises(Chess::InvalidBinaryFormatError) { Chess::Position.from_binary(packed[0, 25]) }
+    assert_raises(Chess::InvalidBinaryFormatError) { Chess::Position.from_binary("\x00".b * 26) }
+    invalid_piece = packed.dup
+    invalid_piece.setbyte(8, 0x77)
+
+    assert_raises(Chess::InvalidBinaryFormatError) { Chess::Position.from_binary(invalid_piece) }
+    non_canonical = packed.dup
+    non_canonical.setbyte(25, 20)
+
+    assert_raises(Chess::InvalidBinaryFormatError) { Chess::Position.from_binary(non_canonical) }
+    assert_raises(TypeError) { Chess::Position.new }
+  end
+
+  def test_position_is_shareable
+    skip unless defined?(Ractor)
+
+    assert Ractor.shareable?(Chess::Game.new.board.to_position)
+  end
+end
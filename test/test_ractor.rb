@@ -0,0 +1,40 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  def ractor_value(ractor)
+    ractor.respond_to?(:value) ? ractor.value : ractor.take
+  end
+
+  def test_games_in_ractors
+    experimental = Warning[:experimental]
+    Warning[:experimental] = false
+    files = TestHelper.pgns('valid').first(4)
+    ractors = files.map do |file|
+      Ractor.new(file) do |path|
+        game = Chess::Game.load_pgn(path)
+        [game.board.to_fen, game.moves, game.board.perft(1)]
+      end
+    end
+    ractors.zip(files).each do |ractor, file|
+      game = Chess::Game.load_pgn(file)
+
+      assert_equal [game.board.to_fen, game.moves, game.board.perft(1)], ractor_value(ractor)
+    end
+  ensure
+    Warning[:experimental] = experimental
+  end
+
+  def test_illegal_move_in_ractor
+    experimental = Warning[:experimental]
+    Warning[:experimental] = false
+    ractor = Ractor.new do
+      Chess::Game.new.move('e5')
+    rescue Chess::IllegalMoveError => e
+      e.message
+    end
+
+    assert_equal "Illegal move 'e5'", ractor_value(ractor)
+  ensure
+    Warning[:experimental] = experimental
+  end
+end
@@ -0,0 +1,130 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  def board_from_fen(fen)
+    game = Chess::Game.new
+    game.set_fen!(fen)
+    game.board
+  end
+
+  def test_best_move_mate_in_one
+    assert_equal 'Ra8#', board_from_fen('6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1').best_move
+    assert_equal 'Qxf7#', board_from_fen('r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4').best_move
+  end
+
+  def test_best_move_mate_in_two
+    board = board_from_fen('r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 10')
+
+    assert_equal 'Nf6+', board.best_move(depth: 4)
+  end
+
+  def test_best_move_wins_material
+    assert_equal 'Rxd5', board_from_fen('4k3/8/8/3q4/8/8/3R4/4K3 w - - 0 1').best_move(depth: 2)
+    assert_equal 'Kxh2', board_from_fen('7k/8/8/8/8/8/7r/6K1 w - - 0 1').best_move(depth: 1)
+  end
+
+  def test_best_move_without_legal_moves
+    assert_nil board_from_fen('rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3').best_move
+    assert_nil board_from_fen('7k/5Q2/6K1/8/8/8/8/8 b - - 0 1').best_move
+  end
+
+  def test_best_move_is_legal
+    game = Chess::Game.new
+    10.times do
+      move = game.board.best_move(nodes: 5_000)
+      game << move
+    end
+
+    assert_equal 10, game.size
+  end
+
+  def test_best_move_limits
+    board = Chess::Game.new.board
+
+    refute_nil board.best_move(nodes: 1)
+    start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    board.best_move(time_ms: 100)
+
+    assert_operator Process.clock_gettime(Process::CLOCK_MONOTONIC) - start, :<, 1
+    assert_raises(ArgumentError) { board.best_move(depth: 0) }
+    assert_raises(ArgumentError) { board.best_move(time_ms: -1) }
+    assert_raises(ArgumentError) { board.best_move(moves: 3) }
+  end
+
+  def test_best_move_interruptible
+    thread = Thread.new { Chess::Game.new.board.best_move(time_ms: 60_000) }
+    sleep 0.1
+    start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    thread.kill.join
+
+    assert_operator Process.clock_gettime(Process::CLOCK_MONOTONIC) - start, :<, 1
+  end
+
+  def measure
+    start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    yield
+    Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+  end
+
+  def test_engine_hash_mb
+    assert_equal 16, Chess::Engine.hash_mb
+    Chess::Engine.hash_mb = 1
+
+    assert_equal 1, Chess::Engine.hash_mb
+    assert_equal 'Nf6+', board_from_fen('r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 10').best_move(depth: 4)
+    assert_raises(ArgumentError) { Chess::Engine.hash_mb = 0 }
+    assert_raises(ArgumentError) { Chess::Engine.hash_mb = 4097 }
+  ensure
+    Chess::Engine.hash_mb = 16
+  end
+
+  def searched_nodes
+    nodes = Chess::Engine.nodes
+    yield
+    Chess::Engine.nodes - nodes
+  end
+
+  def test_engine_transposition_table_reuse
+    board = Chess::Game.new(%w[e4 e5 Nf3 Nc6 Bb5 a6]).board
+    Chess::Engine.clear
+    move = nil
+    first = searched_nodes { move = board.best_move(depth: 5) }
+    second = searched_nodes { assert_equal move, board.best_move(depth: 5) }
+
+    assert_operator second, :<, first / 4
+    Chess::Engine.clear
+    cleared = searched_nodes { board.best_move(depth: 5) }
+
+    assert_equal first, cleared
+  end
+
+  def test_engine_concurrent_searches
+    board = Chess::Game.new(%w[d4 d5 c4]).board
+    moves = Array.new(4) { Thread.new { board.best_move(depth: 4) } }.map(&:value)
+
+    moves.each do |move|
+      assert Chess::Game.new(%w[d4 d5 c4]).move(move)
+    end
+  end
+
+  def test_engine_threads
+    assert_equal 1, Chess::Engine.threads
+    Chess::Engine.threads = 4
+
+    assert_equal 4, Chess::Engine.threads
+    assert_equal 'Nf6+', board_from_fen('r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 10').best_move(depth: 4)
+    assert_nil board_from_fen('7k/5Q2/6K1/8/8/8/8/8 b - - 0 1').best_move
+    game = Chess::Game.new
+    6.times { game << game.board.best_move(time_ms: 20) }
+
+    assert_equal 6, game.size
+    thread = Thread.new { Chess::Game.new.board.best_move(time_ms: 60_000) }
+    sleep 0.1
+
+    assert_operator measure { thread.kill.join }, :<, 1
+    assert_raises(ArgumentError) { Chess::Engine.threads = 0 }
+    assert_raises(ArgumentError) { Chess::Engine.threads = 257 }
+  ensure
+    Chess::Engine.threads = 1
+  end
+end
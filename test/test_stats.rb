@@ -0,0 +1,35 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  def test_stats_keys
+    assert_nil Chess.reset_stats
+    stats = Chess.stats
+    skip 'counters not compiled in, build with --enable-stats' unless stats
+
+    assert_equal %i[try_move all_xray king_in_check king_in_checkmate stalemate get_notation malloc_calls malloc_bytes board_copies], stats.keys
+  end
+
+  def test_stats_count
+    Chess.reset_stats
+    skip 'counters not compiled in, build with --enable-stats' unless Chess.stats
+
+    game = Chess::Game.new(%w[e4 e5 Qh5 Nc6 Bc4 Nf6])
+    stats = Chess.stats
+
+    assert_equal 0, stats[:king_in_checkmate]
+    assert_operator stats[:try_move], :>=, 6
+    assert_operator stats[:get_notation], :>=, 6
+    assert_operator stats[:king_in_check], :>=, 6
+    assert_operator stats[:board_copies], :>=, 6
+    # The game, the boards and the coordinate moves
+    assert_operator stats[:malloc_calls], :>=, 13
+    assert_operator stats[:malloc_bytes], :>, stats[:malloc_calls]
+
+    game.move('Qxf7')
+
+    assert_equal 1, Chess.stats[:king_in_checkmate]
+    Chess.reset_stats
+
+    assert(Chess.stats.values.all?(&:zero?))
+  end
+end
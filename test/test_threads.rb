@@ -0,0 +1,73 @@
+require 'test_helper'
+require 'timeout'
+
+class ChessTest < Minitest::Test
+  THREADS = 8
+
+  def test_replay
+    pgn = TestHelper.pick_pgn('valid/0001.pgn')
+    expected = Chess::Game.new(pgn.moves)
+    game = Chess::Game.replay(expected.coord_moves)
+
+    assert_instance_of Chess::Game, game
+    assert_equal expected.moves, game.moves
+    assert_equal expected.board.to_fen, game.board.to_fen
+  end
+
+  def test_replay_promotion
+    game = Chess::Game.replay(%w[h2h4 g7g5 h4g5 h7h6 g5h6 f8g7 h6g7 g8f6 g7h8=N])
+
+    assert_equal 'N', game.board['h8']
+    assert_equal 'gxh8=N', game.moves.last
+  end
+
+  def test_replay_illegal_move
+    error = assert_raises(Chess::IllegalMoveError) { Chess::Game.replay(%w[e2e4 e7e5 e4e5]) }
+    assert_equal "Illegal move 'e4e5'", error.message
+  end
+
+  def test_replay_bad_notation
+    assert_raises(Chess::BadNotationError) { Chess::Game.replay(%w[e2e4 Nf6]) }
+  end
+
+  def test_replay_invalid_element
+    assert_raises(TypeError) { Chess::Game.replay(['e2e4', :e7e5]) }
+    assert_raises(ArgumentError) { Chess::Game.replay(%W[e2e4 e7e5\0]) }
+  end
+
+  def test_interrupt_perft
+    board = Chess::Game.new.board
+    start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    assert_raises(Timeout::Error) { Timeout.timeout(0.1) { board.perft(9) } }
+
+    assert_operator Process.clock_gettime(Process::CLOCK_MONOTONIC) - start, :<, 5
+    thread = Thread.new { board.perft(9) }
+    sleep 0.05
+    thread.kill
+
+    assert thread.join(5)
+    assert_equal 8902, board.perft(3)
+  end
+
+  def test_stress_threads
+    games = TestHelper.pgns('valid').first(40).map { |file| Chess::Game.load_pgn(file) }
+    board = Chess::Game.load_fen('r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1').board
+    expected_all_moves = games.map { |g| g.board.generate_all_moves }
+    threads = Array.new(THREADS) do |t|
+      Thread.new do
+        results = []
+        results << board.perft(2)
+        games.rotate(t).each do |g|
+          replayed = Chess::Game.replay(g.coord_moves)
+          results << (replayed.board.to_fen == g.board.to_fen)
+          results << (replayed.board.generate_all_moves == expected_all_moves[games.index(g)])
+        end
+        results
+      end
+    end
+    threads.map(&:value).each do |results|
+      assert_equal 2039, results.first
+      assert(results.drop(1).all?)
+    end
+  end
+end
@@ -0,0 +1,117 @@
+require 'test_helper'
+require 'open3'
+require 'timeout'
+require 'tmpdir'
+
+class ChessTest < Minitest::Test
+  SOURCES = File.expand_path('../ext/chess', __dir__)
+
+  # Builds chess-uci with MakefileC out of the source tree, so its objects do
+  # not mix with the ones of the extension.
+  def self.uci_engine
+    @uci_engine ||= begin
+      dir = Dir.mktmpdir('chess-uci')
+      Minitest.after_run { FileUtils.rm_rf(dir) }
+      files = Dir[File.join(SOURCES, '*.{c,h}')] - [File.join(SOURCES, 'tables.h')]
+      FileUtils.cp(files + [File.join(SOURCES, 'MakefileC')], dir)
+      output, status = Open3.capture2e('make', '-f', 'MakefileC', 'chess-uci', chdir: dir)
+      raise "make -f MakefileC chess-uci failed:\n#{output}" unless status.success?
+
+      File.join(dir, 'chess-uci')
+    end
+  end
+
+  def uci_session
+    Open3.popen2(self.class.uci_engine) do |stdin, stdout, thread|
+      stdin.sync = true
+      send = ->(command) { stdin.puts(command) }
+      expect = lambda do |pattern|
+        Timeout.timeout(30) do
+          loop do
+            line = stdout.gets or flunk "chess-uci exited waiting for #{pattern.inspect}"
+            break line.chomp if line.match?(pattern)
+          end
+        end
+      end
+      yield send, expect
+      send['quit']
+      stdin.close
+      assert_predicate thread.value, :success?
+    end
+  end
+
+  def test_uci_handshake
+    uci_session do |send, expect|
+      send['uci']
+
+      assert_equal 'uciok', expect[/\Auciok/]
+      send['isready']
+
+      assert_equal 'readyok', expect[/\Areadyok/]
+    end
+  end
+
+  def test_uci_mate_in_one
+    uci_session do |send, expect|
+      send['position fen 6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1']
+      send['go depth 3']
+
+      assert_equal 'bestmove a1a8', expect[/\Abestmove/]
+      send['position startpos moves f2f3 e7e5 g2g4']
+      send['go nodes 5000']
+
+      assert_equal 'bestmove d8h4', expect[/\Abestmove/]
+      send['position fen 6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1']
+      send['go movetime 100']
+
+      assert_equal 'bestmove a1a8', expect[/\Abestmove/]
+    end
+  end
+
+  def test_uci_stop_infinite_search
+    uci_session do |send, expect|
+      send['position startpos moves e2e4']
+      send['go infinite']
+      sleep 0.2
+      send['isready']
+
+      assert_equal 'readyok', expect[/\Areadyok/]
+      send['stop']
+
+      assert_match(/\Abestmove [a-h][1-8][a-h][1-8]\z/, expect[/\Abestmove/])
+    end
+  end
+
+  def test_uci_infinite_search_waits_for_stop
+    uci_session do |send, expect|
+      # Mate in one and a single legal move end the search by themselves
+      { '6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1' => 'a1a8', '7k/8/8/8/8/8/r7/7K w - - 0 1' => 'h1g1' }.each do |fen, move|
+        send["position fen #{fen}"]
+        send['go infinite']
+        sleep 0.2
+        send['isready']
+
+        assert_equal 'readyok', expect[/\A(readyok|bestmove)/]
+        send['stop']
+
+        assert_equal "bestmove #{move}", expect[/\Abestmove/]
+      end
+    end
+  end
+
+  def test_uci_invalid_fen_keeps_position
+    uci_session do |send, expect|
+      send['position fen 6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1']
+      send['position fen 6k1/5ppp/8/8 w - - 0 1 moves a1a2']
+
+      assert_equal 'info string invalid fen', expect[/\Ainfo string/]
+      # No king
+      send['position fen 8/5ppp/8/8/8/8/8/R5K1 w - - 0 1']
+
+      assert_equal 'info string invalid fen', expect[/\Ainfo string/]
+      send['go depth 3']
+
+      assert_equal 'bestmove a1a8', expect[/\Abestmove/]
+    end
+  end
+end
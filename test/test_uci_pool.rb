@@ -0,0 +1,111 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  STUB_ENGINE = [RbConfig.ruby, File.join(__dir__, 'uci_stub_engine.rb')].freeze
+
+  def test_uci_engine
+    engine = Chess::UCI::Engine.new(STUB_ENGINE)
+    game = Chess::Game.new
+
+    assert_equal 'Stub', engine.name
+    3.times { game.move(engine.best_move(game)) }
+
+    assert_equal %w[e4 e5 Nf3], game.moves
+    assert_equal "info string pid #{engine.pid} position startpos moves e2e4 e7e5", engine.info.last
+  ensure
+    engine&.close
+  end
+
+  def test_uci_position_command
+    engine = Chess::UCI::Engine.new(STUB_ENGINE)
+    game = Chess::Game.new
+
+    assert_equal 'position startpos', engine.position_command(game)
+    game.set_fen!('r3k3/1P6/8/8/8/8/8/4K2R w K - 0 1')
+    game << 'O-O'
+    game << 'Kd7'
+    game << 'bxa8=N'
+
+    assert_equal 'position fen r3k3/1P6/8/8/8/8/8/4K2R w K - 0 1 moves e1g1 e8d7 b7a8n', engine.position_command(game)
+  ensure
+    engine&.close
+  end
+
+  def test_uci_pool_reuses_engines
+    Chess::UCI::Pool.open(STUB_ENGINE, size: 2) do |pool|
+      games = Array.new(6) { Chess::Game.new }
+      pids = []
+      3.times do
+        threads = games.map do |game|
+          Thread.new do
+            pool.with_engine do |engine|
+              pids << engine.pid
+              game.move(engine.best_move(game))
+            end
+          end
+        end
+        threads.each(&:join)
+      end
+
+      assert_equal 2, pool.size
+      assert_equal 2, pids.uniq.size
+      games.each { |game| assert_equal %w[e4 e5 Nf3], game.moves }
+    end
+  end
+
+  def test_uci_pool_no_legal_moves
+    Chess::UCI::Pool.open(STUB_ENGINE, size: 1) do |pool|
+      game = Chess::Game.new(%w[e4 e5 Nf3 Nc6 Bb5 a6])
+
+      assert_nil pool.best_move(game)
+    end
+  end
+
+  def test_uci_pool_timeouts
+    Chess::UCI::Pool.open(STUB_ENGINE, size: 1, options: { 'Delay' => 300 }, timeout: 0.1) do |pool|
+      # A slow engine is stopped and its answer is used
+      assert_equal 'e2e4', pool.best_move(Chess::Game.new)
+      # No engine is available while the only one is busy
+      thread = Thread.new { pool.best_move(Chess::Game.new, timeout: 2) }
+      sleep 0.05
+
+      assert_raises(Chess::UCITimeoutError) { pool.best_move(Chess::Game.new) }
+      assert_equal 'e2e4', thread.value
+    end
+  end
+
+  def test_uci_pool_restarts_stuck_engines
+    Chess::UCI::Pool.open(STUB_ENGINE, size: 1, options: { 'Hang' => true }, timeout: 0.1) do |pool|
+      first = second = nil
+      pool.with_engine { |engine| first = engine.pid }
+
+      assert_raises(Chess::UCITimeoutError) { pool.best_move(Chess::Game.new) }
+      pool.with_engine { |engine| second = engine.pid }
+
+      refute_equal first, second
+    end
+  end
+
+  def test_uci_pool_restarts_interrupted_engines
+    Chess::UCI::Pool.open(STUB_ENGINE, size: 1) do |pool|
+      pids = []
+      pool.with_engine { |engine| pids << engine.pid }
+      pool.with_engine { |engine| pids << engine.pid }
+
+      assert_raises(RuntimeError) { pool.with_engine { raise 'interrupted' } }
+      pool.with_engine { |engine| pids << engine.pid }
+      pool.with_engine { |engine| break pids << engine.pid }
+      pool.with_engine { |engine| pids << engine.pid }
+
+      assert_equal 'e2e4', pool.best_move(Chess::Game.new)
+      assert_equal pids[0], pids[1]
+      refute_equal pids[1], pids[2]
+      refute_equal pids[3], pids[4]
+    end
+  end
+
+  def test_uci_engine_not_found
+    assert_raises(Errno::ENOENT) { Chess::UCI::Pool.new(['missing-uci-engine'], size: 1) }
+    assert_raises(Chess::UCIError) { Chess::UCI::Engine.new([RbConfig.ruby, '-e', 'exit']) }
+  end
+end
@@ -0,0 +1,155 @@
+require 'test_helper'
+
+class ChessTest < Minitest::Test
+  def test_add_variation
+    game = Chess::Game.new(%w[e4 e5 Nf3 Nc6])
+    sicilian = game.add_variation(1, %w[c5 Nf3])
+    sicilian << 'd6'
+    najdorf = sicilian.add_variation(2, %w[Nc6])
+
+    assert_equal %w[e4 e5 Nf3 Nc6], game.moves
+    assert_equal [sicilian], game.variations
+    assert_equal 1, sicilian.ply
+    assert_equal %w[c5 Nf3 d6], sicilian.moves
+    assert_equal %w[c7c5 g1f3 d7d6], sicilian.coord_moves
+    assert_equal game[0].to_fen, sicilian[-1].to_fen
+    assert_equal 'rnbqkbnr/pp2pppp/3p4/2p5/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 0 3', sicilian.board.to_fen
+    assert_equal [0, 0], najdorf.path
+    assert_equal sicilian, najdorf.parent
+    assert_equal sicilian[1].to_fen, najdorf[-1].to_fen
+    assert_equal [sicilian, najdorf], game.each_variation.to_a
+  end
+
+  def test_add_variation_errors
+    game = Chess::Game.new(%w[e4 e5])
+
+    assert_raises(ArgumentError) { game.add_variation(2, %w[Nf3]) }
+    assert_raises(Chess::IllegalMoveError) { game.add_variation(1, %w[c5 Qh8]) }
+    assert_empty game.variations
+    assert_raises(ArgumentError) { Chess::Game.load_fen('4k3/8/4K3/4P3/8/8/8/8 w - - 0 1').add_variation(0) }
+    assert_raises(IndexError) { Chess::Variation.new(game, [0]).moves }
+  end
+
+  def test_variation_result
+    game = Chess::Game.new(%w[f3 e5 g4 d6])
+    mate = game.add_variation(3, %w[Qh4#])
+
+    assert_equal '0-1', mate.result
+    assert_equal '*', game.result
+    assert_raises(Chess::IllegalMoveError) { mate.move('a3') }
+  end
+
+  def test_promote_variation
+    game = Chess::Game.new(%w[e4 e5 Nf3 Nc6 Bb5])
+    game.add_variation(4, %w[Bc4])
+    sicilian = game.add_variation(1, %w[c5 Nf3 d6])
+    sicilian.add_variation(2, %w[Nc6])
+    moves = game.moves
+    sicilian.promote!
+
+    refute_equal moves, game.moves
+    assert_equal %w[e4 c5 Nf3 d6], game.moves
+    assert_equal %w[e5 Nf3 Nc6 Bb5], sicilian.moves
+    assert_equal [[1, %w[e5 Nf3 Nc6 Bb5]], [3, %w[Nc6]]], game.variations.map { |v| [v.ply, v.moves] }
+    assert_equal [[3, %w[Bc4]]], sicilian.variations.map { |v| [v.ply, v.moves] }
+    assert_equal game[0].to_fen, sicilian.variations.first.parent[-1].to_fen
+    sicilian.promote!
+
+    assert_equal %w[e4 e5 Nf3 Nc6 Bb5], game.moves
+    assert_equal [[1, %w[c5 Nf3 d6]], [4, %w[Bc4]]], game.variations.map { |v| [v.ply, v.moves] }
+    assert_equal [[2, %w[Nc6]]], sicilian.variations.map { |v| [v.ply, v.moves] }
+    assert_raises(ArgumentError) { game.add_variation(0).promote! }
+  end
+
+  def test_promote_nested_variation
+    game = Chess::Game.new(%w[d4 d5])
+    line = game.add_variation(1, %w[Nf6 c4 e6])
+    nested = line.add_variation(1, %w[Nf3 g6])
+    nested.promote!
+
+    assert_equal %w[Nf6 Nf3 g6], line.moves
+    assert_equal %w[c4 e6], nested.moves
+    assert_equal 'rnbqkb1r/pppppp1p/5np1/8/3P4/5N2/PPP1PPPP/RNBQKB1R w KQkq - 0 3', line.board.to_fen
+  end
+
+  def test_remove_variation_and_rollback
+    game = Chess::Game.new(%w[e4 e5 Nf3])
+    game.add_variation(1, %w[c5])
+    game.add_variation(1, %w[e6])
+    game.add_variation(2, %w[Nc3])
+    game.variations.first.remove!
+
+    assert_equal [%w[e6], %w[Nc3]], game.variations.map(&:moves)
+    game.rollback!
+
+    assert_equal [%w[e6]], game.variations.map(&:moves)
+    game.rollback!
+
+    assert_empty game.variations
+  end
+
+  def test_variation_board_outlives_variation
+    game = Chess::Game.new(%w[e4 e5 Nf3])
+    variation = game.add_variation(1, %w[c5 Nf3])
+    board = variation.board
+    first = variation[0]
+    variation.remove!
+    nested = game.add_variation(2, %w[Nc3]).board
+    2.times { game.rollback! }
+    GC.start
+
+    assert_equal 'rnbqkbnr/pp1ppppp/8/2p5/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2', board.to_fen
+    assert_equal 'rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq c6 0 2', first.to_fen
+    assert_equal 'rnbqkbnr/pppp1ppp/8/4p3/4P3/2N5/PPPP1PPP/R1BQKBNR b KQkq - 1 2', nested.to_fen
+  end
+
+  def test_dup_variations
+    game = Chess::Game.new(%w[e4 e5])
+    game.add_variation(1, %w[c5])
+    copy = game.dup
+    copy.variations.first.move('Nf3')
+    copy.add_variation(0, %w[d4])
+
+    assert_equal [%w[c5]], game.variations.map(&:moves)
+    assert_equal [%w[c5 Nf3], %w[d4]], copy.variations.map(&:moves)
+  end
+
+  def test_variations_memsize
+    game = Chess::Game.new(%w[e4 e5])
+    size = ObjectSpace.memsize_of(game)
+    game.add_variation(1, %w[c5 Nf3 d6])
+
+    assert_operator ObjectSpace.memsize_of(game), :>, size
+  end
+
+  def test_pgn_variations
+    pgn = Chess::Pgn.new
+    pgn.load_from_string(<<~PGN)
+      [Result "*"]
+
+      1. e4 e5 (1... c5 2. Nf3 d6 $1 (2... Nc6 3. d4) 3. d4) 2. Nf3 {best} Nc6
+      3. Bb5 (3. Bc4 Bc5) *
+    PGN
+
+    assert_equal %w[e4 e5 Nf3 Nc6 Bb5], pgn.moves
+    assert_equal [1, %w[c5 Nf3 d6 d4]], [pgn.variations[0].ply, pgn.variations[0].moves]
+    assert_equal [2, %w[Nc6 d4]], [pgn.variations[0].variations[0].ply, pgn.variations[0].variations[0].moves]
+    assert_equal [4, %w[Bc4 Bc5]], [pgn.variations[1].ply, pgn.variations[1].moves]
+    game = Chess::Game.from_pgn(pgn)
+
+    assert_equal [%w[c5 Nf3 d6 d4], %w[Nc6 d4], %w[Bc4 Bc5]], game.each_variation.map(&:moves)
+    assert_match '1. e4 e5 (1... c5 2. Nf3 d6 (2... Nc6 3. d4) 3. d4) 2. Nf3 Nc6 3. Bb5 (3. Bc4 Bc5) *',
+                 game.pgn.to_s.tr("\n", ' ')
+    copy = Chess::Pgn.new
+    copy.load_from_string(game.pgn.to_s)
+
+    assert_equal pgn.variations, copy.variations
+  end
+
+  def test_pgn_invalid_variations
+    ['1. e4 (e5 *', '1. e4 e5) *', '1. (e4) e5 *', '1. e4 (1... e9) *'].each do |movetext|
+      assert_raises(Chess::InvalidPgnFormatError, movetext) { Chess::Pgn.new.load_from_string(movetext) }
+    end
+    assert_raises(Chess::IllegalMoveError) { Chess::Pgn.new.load_from_string('1. e4 e5 (1... e4) *', check_moves: true) }
+  end
+end
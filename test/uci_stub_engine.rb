@@ -0,0 +1,36 @@
+# A minimal UCI engine used as test double by test_uci_pool.rb. It answers the
+# moves of the Ruy Lopez and reports the position it has received. The options
+# Delay (milliseconds before answering go) and Hang (never answer go) simulate
+# slow and stuck engines.
+$stdout.sync = true
+MOVES = %w[e2e4 e7e5 g1f3 b8c6 f1b5 a7a6].freeze
+delay = 0
+hang = false
+position = nil
+
+$stdin.each_line do |line|
+  case line.strip
+  when 'uci'
+    puts 'id name Stub'
+    puts 'uciok'
+  when 'isready'
+    puts 'readyok'
+  when /\Asetoption name Delay value (\d+)/
+    delay = ::Regexp.last_match(1).to_i
+  when /\Asetoption name Hang value true/
+    hang = true
+  when 'ucinewgame'
+    puts 'info string new game'
+  when /\Aposition /
+    position = line.strip
+  when /\Ago/
+    next if hang
+
+    sleep(delay / 1000.0)
+    moves = position[/ moves (.*)/, 1].to_s.split
+    puts "info string pid #{Process.pid} #{position}"
+    puts "bestmove #{MOVES[moves.size] || '(none)'}"
+  when 'quit'
+    break
+  end
+end